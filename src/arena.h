@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace oorgen {
+
+// Bump-pointer arena. Memory is cut from big blocks and is never returned to the heap piece by piece:
+// all blocks are released together, when the arena is destroyed.
+// Generation creates a lot of short-living objects, so freed small pieces are kept in free lists
+// (one per size class) and are reused by later allocations of the same size class.
+// Everything, which was allocated in the arena, should be destroyed before it.
+class Arena {
+    public:
+        Arena () : cur(nullptr), end(nullptr) {
+            for (auto& i : free_lists)
+                i = nullptr;
+        }
+        Arena (const Arena&) = delete;
+        Arena& operator= (const Arena&) = delete;
+
+        void* allocate (size_t size, size_t align) {
+            // Big objects get their own block, so the rest of current block isn't wasted
+            if (size + align > BLOCK_SIZE) {
+                blocks.emplace_back(new char [size + align]);
+                return align_up(blocks.back().get(), align);
+            }
+            size_t size_class = get_size_class(size);
+            if (size_class < SIZE_CLASS_COUNT) {
+                if (align <= GRANULE && free_lists[size_class] != nullptr) {
+                    FreePiece* ret = free_lists[size_class];
+                    free_lists[size_class] = ret->next;
+                    return ret;
+                }
+                // Pieces of the same size class have the same size, so any of them can be reused
+                size = (size_class + 1) * GRANULE;
+                align = align < GRANULE ? GRANULE : align;
+            }
+            char* ret = align_up(cur, align);
+            if (cur == nullptr || ret + size > end) {
+                blocks.emplace_back(new char [BLOCK_SIZE]);
+                cur = blocks.back().get();
+                end = cur + BLOCK_SIZE;
+                ret = align_up(cur, align);
+            }
+            cur = ret + size;
+            return ret;
+        }
+
+        void deallocate (void* ptr, size_t size) {
+            size_t size_class = get_size_class(size);
+            if (size_class >= SIZE_CLASS_COUNT)
+                return;
+            FreePiece* piece = static_cast<FreePiece*>(ptr);
+            piece->next = free_lists[size_class];
+            free_lists[size_class] = piece;
+        }
+
+        // Arena, which is used by ir_make_shared at the moment (nullptr means ordinary heap)
+        static Arena*& current () {
+            static Arena* current_arena = nullptr;
+            return current_arena;
+        }
+
+    private:
+        static const size_t BLOCK_SIZE = 1 << 20;
+        // Pieces up to GRANULE * SIZE_CLASS_COUNT bytes are reused
+        static const size_t GRANULE = 16;
+        static const size_t SIZE_CLASS_COUNT = 64;
+
+        struct FreePiece {
+            FreePiece* next;
+        };
+
+        static size_t get_size_class (size_t size) { return size == 0 ? 0 : (size - 1) / GRANULE; }
+
+        static char* align_up (char* ptr, size_t align) {
+            return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(ptr) + align - 1) & ~(uintptr_t) (align - 1));
+        }
+
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char* cur;
+        char* end;
+        FreePiece* free_lists [SIZE_CLASS_COUNT];
+};
+
+// Makes the arena current until the end of the scope. Null arena leaves everything as is.
+class ArenaScope {
+    public:
+        explicit ArenaScope (Arena* arena) : prev(Arena::current()) {
+            if (arena != nullptr)
+                Arena::current() = arena;
+        }
+        ~ArenaScope () { Arena::current() = prev; }
+        ArenaScope (const ArenaScope&) = delete;
+        ArenaScope& operator= (const ArenaScope&) = delete;
+
+    private:
+        Arena* prev;
+};
+
+// Allocator for std::allocate_shared
+template<typename T>
+class ArenaAllocator {
+    public:
+        using value_type = T;
+
+        explicit ArenaAllocator (Arena* _arena) : arena(_arena) {}
+        template<typename U>
+        ArenaAllocator (const ArenaAllocator<U>& other) : arena(other.get_arena()) {}
+
+        T* allocate (size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+        void deallocate (T* ptr, size_t n) { arena->deallocate(ptr, n * sizeof(T)); }
+        Arena* get_arena () const { return arena; }
+
+    private:
+        Arena* arena;
+};
+
+template<typename T, typename U>
+bool operator== (const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.get_arena() == b.get_arena(); }
+template<typename T, typename U>
+bool operator!= (const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return !(a == b); }
+
+// Replacement of std::make_shared for IR (nodes, types, data, contexts, symbol tables).
+// Object and its control block are placed in the current arena, if there is one.
+template<typename T, typename... Args>
+std::shared_ptr<T> ir_make_shared (Args&&... args) {
+    Arena* arena = Arena::current();
+    if (arena == nullptr)
+        return std::make_shared<T>(std::forward<Args>(args)...);
+    return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+}
+}
@@ -13,20 +13,44 @@ using namespace oorgen;
 uint32_t Expr::total_expr_count = 0;
 uint32_t Expr::func_expr_count = 0;
 
+// Arguments, which are released by destructors of their parents, but aren't destroyed yet
+static std::vector<std::shared_ptr<Expr>> released_args;
+static bool is_releasing_args = false;
+
+void Expr::release_arg (std::shared_ptr<Expr>& arg) {
+    // Shared arguments (e.g. common subexpressions) survive their parent, so they are released in place
+    if (arg.use_count() != 1) {
+        arg.reset();
+        return;
+    }
+    released_args.push_back(std::move(arg));
+    // Only the outermost destructor destroys the arguments, nested ones just add to the list
+    if (is_releasing_args)
+        return;
+    is_releasing_args = true;
+    while (!released_args.empty()) {
+        std::shared_ptr<Expr> cur_arg = std::move(released_args.back());
+        released_args.pop_back();
+        cur_arg.reset();
+    }
+    is_releasing_args = false;
+}
+
 std::shared_ptr<Data> Expr::get_value () {
-    switch (value->get_class_id()) {
+    const std::shared_ptr<Data>& cur_value = peek_value();
+    switch (cur_value->get_class_id()) {
         case Data::VarClassID::VAR: {
-            std::shared_ptr<ScalarVariable> scalar_var = std::make_shared<ScalarVariable>(*(std::static_pointer_cast<ScalarVariable>(value)));
-            scalar_var->set_name("");
+            std::shared_ptr<ScalarVariable> scalar_var = ir_make_shared<ScalarVariable>(*(std::static_pointer_cast<ScalarVariable>(cur_value)));
+            scalar_var->set_name(Name());
             return scalar_var;
         }
         case Data::VarClassID::STRUCT: {
-            std::shared_ptr<Struct> struct_var = std::make_shared<Struct>(*(std::static_pointer_cast<Struct>(value)));
-            struct_var->set_name("");
+            std::shared_ptr<Struct> struct_var = ir_make_shared<Struct>(*(std::static_pointer_cast<Struct>(cur_value)));
+            struct_var->set_name(Name());
             return struct_var;
         }
         case Data::VarClassID::POINTER: {
-            return value;
+            return cur_value;
         }
         //TODO: implement for Array
         case Data::VarClassID::ARRAY:
@@ -36,21 +60,27 @@ std::shared_ptr<Data> Expr::get_value () {
     ERROR("Expr::get_value() - data corruption");
 }
 
+BuiltinType::ScalarTypedVal Expr::get_scalar_value () {
+    const std::shared_ptr<Data>& cur_value = peek_value();
+    if (cur_value->get_class_id() != Data::VarClassID::VAR)
+        ERROR("only ScalarVariable has scalar value (Expr)");
+    return static_cast<ScalarVariable*>(cur_value.get())->get_cur_value();
+}
+
 std::shared_ptr<Expr> VarUseExpr::set_value (std::shared_ptr<Expr> _expr) {
-    std::shared_ptr<Data> _new_value = _expr->get_value();
-    if (_new_value->get_class_id() != value->get_class_id()) {
+    if (_expr->get_value_class_id() != value->get_class_id()) {
         ERROR("different Data::VarClassID (VarUseExpr)");
     }
     switch (value->get_class_id()) {
         case Data::VarClassID::VAR:
-            if (value->get_type()->get_int_type_id() != _new_value->get_type()->get_int_type_id())
+            if (value->get_type()->get_int_type_id() != _expr->get_value_type()->get_int_type_id())
                 ERROR("can't assign different types (VarUseExpr)");
-            std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(std::static_pointer_cast<ScalarVariable>(_new_value)->get_cur_value());
+            std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(_expr->get_scalar_value());
             return _expr;
             break;
         case Data::VarClassID::POINTER: {
             std::shared_ptr<Pointer> value_ptr = std::static_pointer_cast<Pointer>(value);
-            std::shared_ptr<Pointer> _new_value_ptr = std::static_pointer_cast<Pointer>(_new_value);
+            std::shared_ptr<Pointer> _new_value_ptr = std::static_pointer_cast<Pointer>(_expr->get_value());
             if (value_ptr->get_pointee()->get_type()->get_int_type_id() !=
                 _new_value_ptr->get_pointee()->get_type()->get_int_type_id()) {
                 ERROR("can't assign different types (MemberExpr)");
@@ -77,7 +107,7 @@ VarUseExpr::VarUseExpr(std::shared_ptr<Data> _var) : Expr(Node::NodeID::VAR_USE,
 }
 
 AssignExpr::AssignExpr (std::shared_ptr<Expr> _to, std::shared_ptr<Expr> _from, bool _taken) :
-                        Expr(Node::NodeID::ASSIGN, _to->get_value(), 0),
+                        Expr(Node::NodeID::ASSIGN, nullptr, 0),
                         to(_to), from(_from), taken(_taken) {
     if (to->get_id() != Node::NodeID::VAR_USE && to->get_id() != Node::NodeID::MEMBER &&
         to->get_id() != Node::NodeID::DEREFERENCE) {
@@ -90,14 +120,14 @@ AssignExpr::AssignExpr (std::shared_ptr<Expr> _to, std::shared_ptr<Expr> _from,
 
 bool AssignExpr::propagate_type () {
     //TODO:StructType check for struct assignment
-    if (to->get_value()->get_class_id() == Data::VarClassID::VAR &&
-        from->get_value()->get_class_id() == Data::VarClassID::VAR) {
-        from = std::make_shared<TypeCastExpr>(from, value->get_type(), true);
-    }
-    else if (to->get_value()->get_class_id() == Data::VarClassID::POINTER &&
-             from->get_value()->get_class_id() == Data::VarClassID::POINTER) {
-        std::shared_ptr<PointerType> to_ptr_type = std::static_pointer_cast<PointerType>(to->get_value()->get_type());
-        std::shared_ptr<PointerType> from_ptr_type = std::static_pointer_cast<PointerType>(from->get_value()->get_type());
+    if (to->get_value_class_id() == Data::VarClassID::VAR &&
+        from->get_value_class_id() == Data::VarClassID::VAR) {
+        from = ir_make_shared<TypeCastExpr>(from, to->get_value_type(), true);
+    }
+    else if (to->get_value_class_id() == Data::VarClassID::POINTER &&
+             from->get_value_class_id() == Data::VarClassID::POINTER) {
+        std::shared_ptr<PointerType> to_ptr_type = std::static_pointer_cast<PointerType>(to->get_value_type());
+        std::shared_ptr<PointerType> from_ptr_type = std::static_pointer_cast<PointerType>(from->get_value_type());
         if (!is_pointers_compatible(to_ptr_type, from_ptr_type))
             ERROR("can't assign pointers of different types (AssignExpr)");
     }
@@ -108,7 +138,14 @@ bool AssignExpr::propagate_type () {
 }
 
 UB AssignExpr::propagate_value () {
-    value = from->get_value();
+    if (from->get_value_class_id() == Data::VarClassID::VAR) {
+        // Result of assignment is kept in its own ScalarVariable, which is created once
+        if (value == nullptr)
+            value = ir_make_shared<ScalarVariable>("", std::static_pointer_cast<IntegerType>(from->get_value_type()));
+        std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(from->get_scalar_value());
+    }
+    else
+        value = from->get_value();
     if (!taken)
         return NoUB;
 
@@ -135,6 +172,11 @@ void AssignExpr::emit (std::ostream& stream, std::string offset) {
     from->emit(stream);
 }
 
+bool AssignExpr::flatten (FlatExpr& flat_expr) {
+    flat_expr.open_node(Node::NodeID::ASSIGN, 0, *this, {to, from});
+    return true;
+}
+
 TypeCastExpr::TypeCastExpr (std::shared_ptr<Expr> _expr, std::shared_ptr<Type> _type, bool _is_implicit) :
               Expr(Node::NodeID::TYPE_CAST, nullptr, _expr->get_complexity() + 1),
               expr(_expr), to_type(_type), is_implicit(_is_implicit) {
@@ -144,7 +186,7 @@ TypeCastExpr::TypeCastExpr (std::shared_ptr<Expr> _expr, std::shared_ptr<Type> _
 
 bool TypeCastExpr::propagate_type () {
     if (to_type->get_int_type_id() == Type::IntegerTypeID::MAX_INT_ID ||
-        expr->get_value()->get_type()->get_int_type_id() == Type::IntegerTypeID::MAX_INT_ID) {
+        expr->get_value_type()->get_int_type_id() == Type::IntegerTypeID::MAX_INT_ID) {
         //TODO: what about overloaded struct types cast?
         ERROR("can cast only integer types (TypeCastExpr)");
     }
@@ -152,20 +194,20 @@ bool TypeCastExpr::propagate_type () {
 }
 
 UB TypeCastExpr::propagate_value () {
-    if (expr->get_value()->get_class_id() != Data::VarClassID::VAR) {
+    if (expr->get_value_class_id() != Data::VarClassID::VAR) {
         //TODO: what about overloaded struct types cast?
         ERROR("can cast only integer types (TypeCastExpr)");
     }
     //TODO: Is it always safe to cast value to ScalarVariable?
-    value = std::make_shared<ScalarVariable>("", std::static_pointer_cast<IntegerType>(to_type));
-    std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(std::static_pointer_cast<ScalarVariable>(expr->get_value())->get_cur_value().cast_type(to_type->get_int_type_id()));
+    value = ir_make_shared<ScalarVariable>("", std::static_pointer_cast<IntegerType>(to_type));
+    std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(expr->get_scalar_value().cast_type(to_type->get_int_type_id()));
     return NoUB;
 }
 
 std::shared_ptr<TypeCastExpr> TypeCastExpr::generate (std::shared_ptr<Context> ctx, std::shared_ptr<Expr> from) {
     GenPolicy::add_to_complexity(Node::NodeID::TYPE_CAST);
     std::shared_ptr<IntegerType> to_type = IntegerType::generate(ctx);
-    return std::make_shared<TypeCastExpr> (from, to_type, false);
+    return ir_make_shared<TypeCastExpr> (from, to_type, false);
 }
 
 void TypeCastExpr::emit (std::ostream& stream, std::string offset) {
@@ -178,12 +220,17 @@ void TypeCastExpr::emit (std::ostream& stream, std::string offset) {
     stream << ")";
 }
 
+bool TypeCastExpr::flatten (FlatExpr& flat_expr) {
+    flat_expr.open_node(Node::NodeID::TYPE_CAST, 0, *this, {expr});
+    return true;
+}
+
 std::vector<BuiltinType::ScalarTypedVal> ConstExpr::arith_const_buffer;
 std::vector<BuiltinType::ScalarTypedVal> ConstExpr::bit_log_const_buffer;
 
 //TODO: maybe variadic template function would be better?
 template <typename T>
-static bool can_reroll (std::vector<Probability<T>>& prob_vec, std::initializer_list<T> bad_variants) {
+static bool can_reroll (const ProbabilityVector<T>& prob_vec, std::initializer_list<T> bad_variants) {
     uint64_t sum_of_all = 0;
     uint64_t sum_of_bad = 0;
     for (auto &i : prob_vec) {
@@ -196,6 +243,7 @@ static bool can_reroll (std::vector<Probability<T>>& prob_vec, std::initializer_
 }
 
 std::shared_ptr<ConstExpr> ConstExpr::generate (std::shared_ptr<Context> ctx) {
+    RAND_CALL_SITE("ConstExpr::generate");
     GenPolicy::add_to_complexity(Node::NodeID::CONST);
     auto p = ctx->get_gen_policy();
 
@@ -216,9 +264,9 @@ std::shared_ptr<ConstExpr> ConstExpr::generate (std::shared_ptr<Context> ctx) {
 
     // Utility function for various transformation of constants
     auto perform_unary_op = [] (UnaryExpr::Op op, BuiltinType::ScalarTypedVal val) -> BuiltinType::ScalarTypedVal {
-        std::shared_ptr<ConstExpr> tmp_const = std::make_shared<ConstExpr>(val);
+        std::shared_ptr<ConstExpr> tmp_const = ir_make_shared<ConstExpr>(val);
         UnaryExpr unary_expr = UnaryExpr(op, tmp_const);
-        return std::static_pointer_cast<ScalarVariable>(unary_expr.get_value())->get_cur_value();
+        return unary_expr.get_scalar_value();
     };
 
     // Main logical part
@@ -274,10 +322,11 @@ std::shared_ptr<ConstExpr> ConstExpr::generate (std::shared_ptr<Context> ctx) {
         new_val = perform_unary_op(const_transform_id, new_val);
     }
 
-    return std::make_shared<ConstExpr>(new_val);
+    return ir_make_shared<ConstExpr>(new_val);
 }
 
 void ConstExpr::fill_const_buf (std::shared_ptr<Context> ctx) {
+    RAND_CALL_SITE("ConstExpr::fill_const_buf");
     // Wipe out old information
     arith_const_buffer.clear();
     bit_log_const_buffer.clear();
@@ -330,8 +379,8 @@ void ConstExpr::fill_const_buf (std::shared_ptr<Context> ctx) {
 }
 
 template <typename T>
-std::string ConstExpr::to_string(T T_val, T min, std::string suffix) {
-    if (!std::static_pointer_cast<ScalarVariable>(value)->get_type()->get_is_signed())
+std::string ConstExpr::to_string(T T_val, T min, bool is_signed, std::string suffix) {
+    if (!is_signed)
         return std::to_string(T_val) + suffix;
     if (T_val != min)
         return std::to_string(T_val) + suffix;
@@ -339,83 +388,92 @@ std::string ConstExpr::to_string(T T_val, T min, std::string suffix) {
 }
 
 void ConstExpr::emit (std::ostream& stream, std::string offset) {
-    std::shared_ptr<ScalarVariable> scalar_val = std::static_pointer_cast<ScalarVariable>(value);
-    std::shared_ptr<IntegerType> int_type = std::static_pointer_cast<IntegerType>(scalar_val->get_type());
-    std::string suffix = std::static_pointer_cast<BuiltinType>(scalar_val->get_type())->get_int_literal_suffix();
-    auto val = scalar_val->get_cur_value().val;
-    switch (scalar_val->get_type()->get_int_type_id()) {
+    emit_value(stream, get_scalar_value());
+}
+
+void ConstExpr::emit_value (std::ostream& stream, BuiltinType::ScalarTypedVal scalar_val) {
+    std::shared_ptr<IntegerType> int_type = IntegerType::init(scalar_val.get_int_type_id());
+    std::string suffix = int_type->get_int_literal_suffix();
+    bool is_signed = int_type->get_is_signed();
+    auto val = scalar_val.val;
+    switch (scalar_val.get_int_type_id()) {
         case IntegerType::IntegerTypeID::BOOL:
             stream << (val.bool_val ? "true" : "false");
             break;
         case IntegerType::IntegerTypeID::CHAR:
-            stream << to_string(val.char_val, int_type->get_min().val.char_val, suffix);
+            stream << to_string(val.char_val, int_type->get_min().val.char_val, is_signed, suffix);
             break;
         case IntegerType::IntegerTypeID::UCHAR:
-            stream << to_string(val.uchar_val, int_type->get_min().val.uchar_val, suffix);
+            stream << to_string(val.uchar_val, int_type->get_min().val.uchar_val, is_signed, suffix);
             break;
         case IntegerType::IntegerTypeID::SHRT:
-            stream << to_string(val.shrt_val, int_type->get_min().val.shrt_val, suffix);
+            stream << to_string(val.shrt_val, int_type->get_min().val.shrt_val, is_signed, suffix);
             break;
         case IntegerType::IntegerTypeID::USHRT:
-            stream << to_string(val.ushrt_val, int_type->get_min().val.ushrt_val, suffix);
+            stream << to_string(val.ushrt_val, int_type->get_min().val.ushrt_val, is_signed, suffix);
             break;
         case IntegerType::IntegerTypeID::INT:
-            stream << to_string(val.int_val, int_type->get_min().val.int_val, suffix);
+            stream << to_string(val.int_val, int_type->get_min().val.int_val, is_signed, suffix);
             break;
         case IntegerType::IntegerTypeID::UINT:
-            stream << to_string(val.uint_val, int_type->get_min().val.uint_val, suffix);
+            stream << to_string(val.uint_val, int_type->get_min().val.uint_val, is_signed, suffix);
             break;
         case IntegerType::IntegerTypeID::LINT:
             if (options->mode_64bit)
-                stream << to_string(val.lint64_val, int_type->get_min().val.lint64_val, suffix);
+                stream << to_string(val.lint64_val, int_type->get_min().val.lint64_val, is_signed, suffix);
             else
-                stream << to_string(val.lint32_val, int_type->get_min().val.lint32_val, suffix);
+                stream << to_string(val.lint32_val, int_type->get_min().val.lint32_val, is_signed, suffix);
             break;
         case IntegerType::IntegerTypeID::ULINT:
             if (options->mode_64bit)
-                stream << to_string(val.ulint64_val, int_type->get_min().val.ulint64_val, suffix);
+                stream << to_string(val.ulint64_val, int_type->get_min().val.ulint64_val, is_signed, suffix);
             else
-                stream << to_string(val.ulint32_val, int_type->get_min().val.ulint32_val, suffix);
+                stream << to_string(val.ulint32_val, int_type->get_min().val.ulint32_val, is_signed, suffix);
             break;
         case IntegerType::IntegerTypeID::LLINT:
-            stream << to_string(val.llint_val, int_type->get_min().val.llint_val, suffix);
+            stream << to_string(val.llint_val, int_type->get_min().val.llint_val, is_signed, suffix);
             break;
         case IntegerType::IntegerTypeID::ULLINT:
-            stream << to_string(val.ullint_val, int_type->get_min().val.ullint_val, suffix);
+            stream << to_string(val.ullint_val, int_type->get_min().val.ullint_val, is_signed, suffix);
             break;
         case IntegerType::IntegerTypeID::MAX_INT_ID:
             ERROR("bad int type id (Constexpr)");
     }
 }
 
+bool ConstExpr::flatten (FlatExpr& flat_expr) {
+    flat_expr.open_node(Node::NodeID::CONST, 0, *this, {});
+    return true;
+}
+
 ConstExpr::ConstExpr(BuiltinType::ScalarTypedVal _val) :
-        Expr(Node::NodeID::CONST, std::make_shared<ScalarVariable>("", IntegerType::init(_val.get_int_type_id())), 1) {
+        Expr(Node::NodeID::CONST, ir_make_shared<ScalarVariable>("", IntegerType::init(_val.get_int_type_id())), 1) {
     std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(_val);
 }
 
 std::shared_ptr<Expr> ArithExpr::integral_prom (std::shared_ptr<Expr> arg) {
-    if (arg->get_value()->get_class_id() != Data::VarClassID::VAR) {
+    if (arg->get_value_class_id() != Data::VarClassID::VAR) {
         ERROR("can perform integral_prom only on ScalarVariable (ArithExpr)");
     }
 
-    if (!arg->get_value()->get_type()->get_is_bit_field()) {
+    if (!arg->get_value_type()->get_is_bit_field()) {
         //[conv.prom]
-        if (arg->get_value()->get_type()->get_int_type_id() >= IntegerType::IntegerTypeID::INT) // can't perform integral promotion
+        if (arg->get_value_type()->get_int_type_id() >= IntegerType::IntegerTypeID::INT) // can't perform integral promotion
             return arg;
-        return std::make_shared<TypeCastExpr>(arg, IntegerType::init(Type::IntegerTypeID::INT), true);
+        return ir_make_shared<TypeCastExpr>(arg, IntegerType::init(Type::IntegerTypeID::INT), true);
     }
     else {
-        BuiltinType::ScalarTypedVal val = std::static_pointer_cast<ScalarVariable>(arg->get_value())->get_cur_value();
+        BuiltinType::ScalarTypedVal val = arg->get_scalar_value();
         if (BitField::can_fit_in_int(val, false))
-            return std::make_shared<TypeCastExpr>(arg, IntegerType::init(Type::IntegerTypeID::INT), true);
+            return ir_make_shared<TypeCastExpr>(arg, IntegerType::init(Type::IntegerTypeID::INT), true);
         if (BitField::can_fit_in_int(val, true))
-            return std::make_shared<TypeCastExpr>(arg, IntegerType::init(Type::IntegerTypeID::UINT), true);
+            return ir_make_shared<TypeCastExpr>(arg, IntegerType::init(Type::IntegerTypeID::UINT), true);
         return arg;
     }
 }
 
 std::shared_ptr<Expr> ArithExpr::conv_to_bool (std::shared_ptr<Expr> arg) {
-    if (arg->get_value()->get_class_id() != Data::VarClassID::VAR) {
+    if (arg->get_value_class_id() != Data::VarClassID::VAR) {
         ERROR("can perform conv_to_bool only on ScalarVariable (ArithExpr)");
     }
 
@@ -423,9 +481,9 @@ std::shared_ptr<Expr> ArithExpr::conv_to_bool (std::shared_ptr<Expr> arg) {
     if (options->is_c())
         to_type = IntegerType::IntegerTypeID::INT;
 
-    if (arg->get_value()->get_type()->get_int_type_id() == to_type) // can't perform integral promotion
+    if (arg->get_value_type()->get_int_type_id() == to_type) // can't perform integral promotion
         return arg;
-    return std::make_shared<TypeCastExpr>(arg, IntegerType::init(to_type), true);
+    return ir_make_shared<TypeCastExpr>(arg, IntegerType::init(to_type), true);
 }
 
 GenPolicy ArithExpr::choose_and_apply_ssp_const_use (GenPolicy old_gen_policy) {
@@ -445,88 +503,202 @@ GenPolicy ArithExpr::choose_and_apply_ssp_similar_op (GenPolicy old_gen_policy)
 }
 
 GenPolicy ArithExpr::choose_and_apply_ssp (GenPolicy gen_policy) {
+    RAND_CALL_SITE("ArithExpr::choose_and_apply_ssp");
     GenPolicy new_policy = choose_and_apply_ssp_const_use(gen_policy);
     new_policy = choose_and_apply_ssp_similar_op(new_policy);
     return new_policy;
 }
 
-std::shared_ptr<Expr> ArithExpr::generate (std::shared_ptr<Context> ctx, std::vector<std::shared_ptr<Expr>> inp) {
+std::shared_ptr<Expr> ArithExpr::generate (std::shared_ptr<Context> ctx, const InpExprIndex& inp) {
     ConstExpr::fill_const_buf(ctx);
     return gen_level(ctx, inp, 0);
 }
 
-// Top-level recursive function for expression tree generation.
-std::shared_ptr<Expr> ArithExpr::gen_level (std::shared_ptr<Context> ctx, std::vector<std::shared_ptr<Expr>> inp,
-                                            uint32_t par_depth) {
+// Applies single statement patterns to gen_policy of the context.
+std::shared_ptr<Context> ArithExpr::apply_ssp (std::shared_ptr<Context> ctx) {
     auto p = ctx->get_gen_policy();
-    //TODO: it is a stub for testing. Rewrite it later.
-    // Pick random pattern for single statement and apply it to gen_policy. Update Context with new gen_policy.
+    // Patterns are chosen once per expression, after that the policy doesn't change
+    if (p->get_chosen_arith_ssp_const_use() != ArithSSP::ConstUse::MAX_CONST_USE &&
+        p->get_chosen_arith_ssp_similar_op() != ArithSSP::SimilarOp::MAX_SIMILAR_OP)
+        return ctx;
     GenPolicy new_gen_policy = choose_and_apply_ssp(*(p));
-    std::shared_ptr<Context> new_ctx = std::make_shared<Context>(*(ctx));
+    std::shared_ptr<Context> new_ctx = ir_make_shared<Context>(*(ctx));
     new_ctx->set_gen_policy(new_gen_policy);
+    return new_ctx;
+}
 
-    // Pick random ID of the node being create.
-    GenPolicy::ArithLeafID node_type = rand_val_gen->get_rand_id (p->get_arith_leaves());
-    std::shared_ptr<Expr> ret = nullptr;
-
-    // If we want to use any Data, we've reached expression tree depth limit or
-    // total Arithmetic Expression number, or we want to use CSE but don't have any,
-    // we fall into this branch.
-    if (node_type == GenPolicy::ArithLeafID::Data || par_depth == p->get_max_arith_depth() ||
-        (node_type == GenPolicy::ArithLeafID::CSE && p->get_cse().size() == 0) ||
-        Expr::total_expr_count >= p->get_max_total_expr_count() ||
-        Expr::func_expr_count  >= p->get_max_func_expr_count()) {
-        // Pick random Data ID.
-        GenPolicy::ArithDataID data_type = rand_val_gen->get_rand_id (p->get_arith_data_distr());
-        // If we want to use Const or don't have any input VarUseExpr / MemberExpr, we fall into this branch.
-        if (data_type == GenPolicy::ArithDataID::Const || inp.size() == 0) {
-            ret = ConstExpr::generate(new_ctx);
+// Operator node, which waits for generation of its arguments (see ArithExpr::gen_level)
+struct ArithGenFrame {
+    ArithGenFrame (GenPolicy::ArithLeafID _node_type, std::shared_ptr<Context> _ctx, uint32_t _depth) :
+            node_type(_node_type), ctx(_ctx), depth(_depth), op(0), arg_count(0), ready_arg_count(0) {}
+
+    GenPolicy::ArithLeafID node_type;
+    std::shared_ptr<Context> ctx;
+    // Depth of the arguments
+    uint32_t depth;
+    // UnaryExpr::Op or BinaryExpr::Op
+    uint32_t op;
+    uint32_t arg_count;
+    uint32_t ready_arg_count;
+    std::shared_ptr<Expr> args [3];
+};
+
+// Makes all decisions about the operator node, which precede generation of its arguments
+static void open_arith_node (ArithGenFrame& frame) {
+    switch (frame.node_type) {
+        case GenPolicy::ArithLeafID::Unary: {
+            RAND_CALL_SITE("open_arith_node unary");
+            GenPolicy::add_to_complexity(Node::NodeID::UNARY);
+            frame.op = rand_val_gen->get_rand_id(frame.ctx->get_gen_policy()->get_allowed_unary_op());
+            frame.arg_count = 1;
+            break;
         }
-        // Branch for input VarUseExpr / MemberExpr
-        else if (data_type == GenPolicy::ArithDataID::Inp) {
-            ret = rand_val_gen->get_rand_elem(inp);
-            if (ret->get_id() == Node::NodeID::VAR_USE)
-                GenPolicy::add_to_complexity(Node::NodeID::VAR_USE);
-            else if (ret->get_id() == Node::NodeID::MEMBER)
-                GenPolicy::add_to_complexity(Node::NodeID::MEMBER);
-            else if (ret->get_id() == Node::NodeID::DEREFERENCE)
-                GenPolicy::add_to_complexity(Node::NodeID::DEREFERENCE);
-            else {
-                ERROR("unsupported input data type (ArithExpr)");
-            }
+        case GenPolicy::ArithLeafID::Binary: {
+            RAND_CALL_SITE("open_arith_node binary");
+            GenPolicy::add_to_complexity(Node::NodeID::BINARY);
+            frame.op = rand_val_gen->get_rand_id(frame.ctx->get_gen_policy()->get_allowed_binary_op());
+            frame.arg_count = 2;
+            break;
         }
-        else {
-            ERROR("Ops (ArithExpr)");
+        case GenPolicy::ArithLeafID::Conditional:
+            GenPolicy::add_to_complexity(Node::NodeID::BINARY);
+            frame.arg_count = 3;
+            break;
+        case GenPolicy::ArithLeafID::TypeCast:
+            // TypeCastExpr::generate adds complexity of the node, when it is closed
+            GenPolicy::reserve_complexity(Node::NodeID::TYPE_CAST);
+            frame.arg_count = 1;
+            break;
+        default:
+            ERROR("inappropriate node type (ArithExpr)");
+    }
+}
+
+// Creates the operator node from generated arguments (its type and value are propagated in constructor)
+static std::shared_ptr<Expr> close_arith_node (ArithGenFrame& frame) {
+    switch (frame.node_type) {
+        case GenPolicy::ArithLeafID::Unary: {
+            RAND_CALL_SITE("close_arith_node unary");
+            return ir_make_shared<UnaryExpr>(static_cast<UnaryExpr::Op>(frame.op), frame.args[0]);
+        }
+        case GenPolicy::ArithLeafID::Binary: {
+            RAND_CALL_SITE("close_arith_node binary");
+            return ir_make_shared<BinaryExpr>(static_cast<BinaryExpr::Op>(frame.op), frame.args[0], frame.args[1]);
+        }
+        case GenPolicy::ArithLeafID::Conditional: {
+            RAND_CALL_SITE("close_arith_node conditional");
+            return ir_make_shared<ConditionalExpr>(frame.args[0], frame.args[1], frame.args[2]);
+        }
+        case GenPolicy::ArithLeafID::TypeCast: {
+            RAND_CALL_SITE("close_arith_node type cast");
+            GenPolicy::release_complexity(Node::NodeID::TYPE_CAST);
+            return TypeCastExpr::generate(frame.ctx, frame.args[0]);
         }
+        default:
+            ERROR("inappropriate node type (ArithExpr)");
     }
-    // All of the following branches implement direct or indirect recursion, calling ArithExpr::gen_level
-    // Unary expr
-    else if (node_type == GenPolicy::ArithLeafID::Unary)
-        ret = UnaryExpr::generate(new_ctx, inp, par_depth + 1);
-    // Binary expr
-    else if (node_type == GenPolicy::ArithLeafID::Binary)
-        ret = BinaryExpr::generate(new_ctx, inp, par_depth + 1);
-    // Conditional (ternary) expr
-    else if (node_type == GenPolicy::ArithLeafID::Conditional)
-        ret = ConditionalExpr::generate(new_ctx, inp, par_depth + 1);
-    // TypeCast expr
-    else if (node_type == GenPolicy::ArithLeafID::TypeCast)
-        ret = TypeCastExpr::generate(new_ctx, ArithExpr::gen_level(new_ctx, inp, par_depth + 1));
-    // Use existing CSE
-    else if (node_type == GenPolicy::ArithLeafID::CSE)
-        ret = rand_val_gen->get_rand_elem(p->get_cse());
-    else
-        ERROR("inappropriate node type (ArithExpr)");
-//    std::cout << ret->emit() << std::endl;
-    return ret;
 }
 
+// Expression tree is generated without recursion. Operator nodes wait on the explicit stack until all their
+// arguments are generated (from left to right), so random decisions are made in the same order as in recursive
+// descent. Size of the tree is limited by max_arith_node_count, limits of expression count and complexity budget:
+// operator node is created only if the tree can still be finished within them.
+std::shared_ptr<Expr> ArithExpr::gen_level (std::shared_ptr<Context> ctx, const InpExprIndex& inp,
+                                            uint32_t par_depth) {
+    std::vector<ArithGenFrame> stack;
+    // Number of arguments of the nodes on the stack, which are neither generated nor being generated
+    uint32_t pending_arg_count = 0;
+    uint64_t node_count = 0;
+    while (true) {
+        std::shared_ptr<Expr> ret = nullptr;
+        {
+            RAND_CALL_SITE("ArithExpr::gen_level");
+            auto p = ctx->get_gen_policy();
+            //TODO: it is a stub for testing. Rewrite it later.
+            // Pick random pattern for single statement and apply it to gen_policy. Update Context with new gen_policy.
+            std::shared_ptr<Context> new_ctx = apply_ssp(ctx);
+
+            // Pick random ID of the node being create.
+            GenPolicy::ArithLeafID node_type = rand_val_gen->get_rand_id (p->get_arith_leaves());
+
+            // Minimal size of the tree, if all pending arguments and the current node become leaves.
+            // Operator node can increase it by 3 at most (conditional operator).
+            uint64_t min_tree_size = node_count + pending_arg_count + 1;
+            // Common subexpressions are copied to the tree, so any of them should fit into the rest of node limit
+            bool can_use_cse = false;
+            if (node_type == GenPolicy::ArithLeafID::CSE && p->get_cse().size() != 0) {
+                uint64_t max_cse_size = 0;
+                for (const auto& cse : p->get_cse())
+                    max_cse_size = std::max<uint64_t>(max_cse_size, cse->get_complexity());
+                can_use_cse = min_tree_size - 1 + max_cse_size <= p->get_max_arith_node_count();
+            }
 
-std::shared_ptr<UnaryExpr> UnaryExpr::generate (std::shared_ptr<Context> ctx, std::vector<std::shared_ptr<Expr>> inp, uint32_t par_depth) {
-    GenPolicy::add_to_complexity(Node::NodeID::UNARY);
-    UnaryExpr::Op op_type = rand_val_gen->get_rand_id(ctx->get_gen_policy()->get_allowed_unary_op());
-    std::shared_ptr<Expr> rhs = ArithExpr::gen_level (ctx, inp, par_depth);
-    return std::make_shared<UnaryExpr>(op_type, rhs);
+            // If we want to use any Data, we've reached expression tree depth limit or
+            // total Arithmetic Expression number, or we want to use CSE but don't have any,
+            // we fall into this branch.
+            if (node_type == GenPolicy::ArithLeafID::Data || par_depth == p->get_max_arith_depth() ||
+                min_tree_size + 3 > p->get_max_arith_node_count() || !p->can_add_arith_node(pending_arg_count) ||
+                (node_type == GenPolicy::ArithLeafID::CSE && !can_use_cse) ||
+                Expr::total_expr_count + min_tree_size >= p->get_max_total_expr_count() ||
+                Expr::func_expr_count + min_tree_size >= p->get_max_func_expr_count()) {
+                // Pick random Data ID.
+                GenPolicy::ArithDataID data_type = rand_val_gen->get_rand_id (p->get_arith_data_distr());
+                // If we want to use Const or don't have any input VarUseExpr / MemberExpr, we fall into this branch.
+                if (data_type == GenPolicy::ArithDataID::Const || inp.size() == 0) {
+                    ret = ConstExpr::generate(new_ctx);
+                }
+                // Branch for input VarUseExpr / MemberExpr
+                else if (data_type == GenPolicy::ArithDataID::Inp) {
+                    ret = rand_val_gen->get_rand_elem(inp);
+                    if (ret->get_id() == Node::NodeID::VAR_USE)
+                        GenPolicy::add_to_complexity(Node::NodeID::VAR_USE);
+                    else if (ret->get_id() == Node::NodeID::MEMBER)
+                        GenPolicy::add_to_complexity(Node::NodeID::MEMBER);
+                    else if (ret->get_id() == Node::NodeID::DEREFERENCE)
+                        GenPolicy::add_to_complexity(Node::NodeID::DEREFERENCE);
+                    else {
+                        ERROR("unsupported input data type (ArithExpr)");
+                    }
+                }
+                else {
+                    ERROR("Ops (ArithExpr)");
+                }
+            }
+            // Use existing CSE
+            else if (node_type == GenPolicy::ArithLeafID::CSE) {
+                ret = rand_val_gen->get_rand_elem(p->get_cse());
+                node_count += ret->get_complexity() - 1;
+            }
+            // Unary, binary, conditional (ternary) and type cast expressions need arguments
+            else
+                stack.emplace_back(node_type, new_ctx, par_depth + 1);
+        }
+
+        ++node_count;
+        if (ret == nullptr) {
+            open_arith_node(stack.back());
+            pending_arg_count += stack.back().arg_count - 1;
+            ctx = stack.back().ctx;
+            par_depth = stack.back().depth;
+            continue;
+        }
+
+        // Pass finished node to its parent. Parents, which have got all arguments, are finished too.
+        while (!stack.empty()) {
+            ArithGenFrame& frame = stack.back();
+            frame.args[frame.ready_arg_count++] = ret;
+            if (frame.ready_arg_count < frame.arg_count) {
+                --pending_arg_count;
+                break;
+            }
+            ret = close_arith_node(frame);
+            stack.pop_back();
+        }
+        if (stack.empty())
+            return ret;
+        ctx = stack.back().ctx;
+        par_depth = stack.back().depth;
+    }
 }
 
 void UnaryExpr::rebuild (UB ub) {
@@ -562,7 +734,7 @@ void UnaryExpr::rebuild (UB ub) {
 }
 
 UnaryExpr::UnaryExpr (Op _op, std::shared_ptr<Expr> _arg) :
-                       ArithExpr(Node::NodeID::UNARY, _arg->get_value()), op (_op), arg (_arg) {
+                       ArithExpr(Node::NodeID::UNARY, nullptr), op (_op), arg (_arg) {
     //TODO: add UB elimination strategy
     propagate_type();
     UB ret_ub = propagate_value();
@@ -579,7 +751,7 @@ bool UnaryExpr::propagate_type () {
     }
 
     //TODO: what about overloadedstruct operators?
-    if (arg->get_value()->get_class_id() != Data::VarClassID::VAR) {
+    if (arg->get_value_class_id() != Data::VarClassID::VAR) {
         ERROR("can perform propagate_type only on ScalarVariable (UnaryExpr)");
     }
 
@@ -601,7 +773,10 @@ bool UnaryExpr::propagate_type () {
             ERROR("bad op (UnaryExpr)");
             break;
     }
-    value = arg->get_value();
+    // Type of the argument doesn't change during rebuild, so result ScalarVariable is created once
+    if (value == nullptr)
+        value = ir_make_shared<ScalarVariable>("", std::static_pointer_cast<IntegerType>(arg->get_value_type()));
+    std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(arg->get_scalar_value());
     return true;
 }
 
@@ -612,34 +787,34 @@ UB UnaryExpr::propagate_value () {
     }
 
     //TODO: what about overloadedstruct operators?
-    if (arg->get_value()->get_class_id() != Data::VarClassID::VAR) {
+    if (arg->get_value_class_id() != Data::VarClassID::VAR) {
         ERROR("can perform propagate_value only on ScalarVariable (UnaryExpr)");
     }
 
-    std::shared_ptr<ScalarVariable> scalar_val = std::static_pointer_cast<ScalarVariable>(arg->get_value());
+    BuiltinType::ScalarTypedVal arg_val = arg->get_scalar_value();
 
-    BuiltinType::ScalarTypedVal new_val (scalar_val->get_type()->get_int_type_id());
+    BuiltinType::ScalarTypedVal new_val (arg->get_value_type()->get_int_type_id());
 
     switch (op) {
         case PreInc:
         case PostInc:
-            new_val = scalar_val->get_cur_value()++;
+            new_val = arg_val++;
             break;
         case PreDec:
         case PostDec:
-            new_val = scalar_val->get_cur_value()--;
+            new_val = arg_val--;
             break;
         case Plus:
-            new_val = scalar_val->get_cur_value();
+            new_val = arg_val;
             break;
         case Negate:
-            new_val = -scalar_val->get_cur_value();
+            new_val = -arg_val;
             break;
         case BitNot:
-            new_val = ~scalar_val->get_cur_value();
+            new_val = ~arg_val;
             break;
         case LogNot:
-            new_val = !scalar_val->get_cur_value();
+            new_val = !arg_val;
             break;
         case MaxOp:
             ERROR("bad op (UnaryExpr)");
@@ -654,58 +829,44 @@ UB UnaryExpr::propagate_value () {
 // This function rebuilds Unary expression in case of UB.
 // The main idea is to replace operator by its complementary operator.
 // This trick always works for unary operations.
-void UnaryExpr::emit (std::ostream& stream, std::string offset) {
-    std::string op_str = offset;
+const char* UnaryExpr::get_op_str (Op op) {
     switch (op) {
         case PreInc:
         case PostInc:
-            op_str = "++";
-            break;
+            return "++";
         case PreDec:
         case PostDec:
-            op_str = "--";
-            break;
+            return "--";
         case Plus:
-            op_str = "+";
-            break;
+            return "+";
         case Negate:
-            op_str = "-";
-            break;
+            return "-";
         case LogNot:
-            op_str = "!";
-            break;
+            return "!";
         case BitNot:
-            op_str = "~";
-            break;
+            return "~";
         case MaxOp:
-            ERROR("bad op (UnaryExpr)");
             break;
     }
-    std::string ret = "";
+    ERROR("bad op (UnaryExpr)");
+}
+
+void UnaryExpr::emit (std::ostream& stream, std::string) {
     if (op == PostInc || op == PostDec) {
         stream << "(";
         arg->emit(stream);
-        stream << ")" + op_str;
+        stream << ")" << get_op_str(op);
     }
     else {
-        stream << op_str + "(";
+        stream << get_op_str(op) << "(";
         arg->emit(stream);
         stream << ")";
     }
 }
 
-std::shared_ptr<BinaryExpr> BinaryExpr::generate (std::shared_ptr<Context> ctx, std::vector<std::shared_ptr<Expr>> inp, uint32_t par_depth) {
-    GenPolicy::add_to_complexity(Node::NodeID::BINARY);
-    BinaryExpr::Op op_type = rand_val_gen->get_rand_id(ctx->get_gen_policy()->get_allowed_binary_op());
-    std::shared_ptr<Expr> lhs = ArithExpr::gen_level (ctx, inp, par_depth);
-    std::shared_ptr<Expr> rhs = ArithExpr::gen_level (ctx, inp, par_depth);
-    std::shared_ptr<BinaryExpr> ret = std::make_shared<BinaryExpr>(op_type, lhs, rhs);
-/*
-    std::cout << "lhs: " << std::static_pointer_cast<ScalarVariable>(lhs->get_value())->get_cur_value() << std::endl;
-    std::cout << "rhs: " << std::static_pointer_cast<ScalarVariable>(rhs->get_value())->get_cur_value() << std::endl;
-    std::cout << "ret: " << std::static_pointer_cast<ScalarVariable>(ret->get_value())->get_cur_value() << std::endl;
-*/
-    return ret;
+bool UnaryExpr::flatten (FlatExpr& flat_expr) {
+    flat_expr.open_node(Node::NodeID::UNARY, op, *this, {arg});
+    return true;
 }
 
 BinaryExpr::BinaryExpr (Op _op, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) :
@@ -732,138 +893,143 @@ static uint64_t msb(uint64_t x) {
 // This works pretty well in most cases.
 // If it doesn't work, we insert child nodes to change operands.
 void BinaryExpr::rebuild (UB ub) {
+    RAND_CALL_SITE("BinaryExpr::rebuild");
     //TODO: We should implement more rebuild strategies (e.g. regenerate node)
-    switch (op) {
-        case BinaryExpr::Add:
-            op = Sub;
-            break;
-        case BinaryExpr::Sub:
-            op = Add;
-            break;
-        case BinaryExpr::Mul:
-            if (ub == UB::SignOvfMin)
+    // New operator or inserted nodes can lead to another UB, so strategies are applied until it is eliminated
+    while (ub != NoUB) {
+        switch (op) {
+            case BinaryExpr::Add:
                 op = Sub;
-            else
-                op = Div;
-            break;
-        case BinaryExpr::Div:
-        case BinaryExpr::Mod:
-            if (ub == UB::ZeroDiv)
-               op = Mul;
-            else
-               op = Sub;
-            break;
-        // Shift operators are tricky.
-        case BinaryExpr::Shr:
-        case BinaryExpr::Shl:
-            //TODO: We should rewrite it later. It is awful.
-            if ((ub == UB::ShiftRhsNeg) || (ub == UB::ShiftRhsLarge)) {
-                std::shared_ptr<Expr> lhs = arg0;
-                std::shared_ptr<Expr> rhs = arg1;
-                // First of all, we need to find maximum value which can be used as rhs.
-                std::shared_ptr<IntegerType> lhs_int_type = std::static_pointer_cast<IntegerType>(lhs->get_value()->get_type());
-                uint64_t max_sht_val = lhs_int_type->get_bit_size();
-                if ((op == Shl) && (lhs_int_type->get_is_signed()) && (ub == UB::ShiftRhsLarge))
-                    max_sht_val -= msb((uint64_t)std::static_pointer_cast<ScalarVariable>(lhs->get_value())->get_cur_value().get_abs_val());
-                // Second, we randomly choose value between 0 and maximum rhs value.
-                uint64_t const_val = rand_val_gen->get_rand_value(uint64_t(0), max_sht_val);
-                // Third, we combine chosen value with existing rhs
-                uint64_t rhs_abs_val = std::static_pointer_cast<ScalarVariable>(rhs->get_value())->get_cur_value().get_abs_val();
-                std::shared_ptr<IntegerType> rhs_int_type = std::static_pointer_cast<IntegerType>(rhs->get_value()->get_type());
-                if (ub == UB::ShiftRhsNeg) {
-                    const_val += rhs_abs_val;
-                    const_val = std::min(const_val, rhs_int_type->get_max().get_abs_val());// TODO: it won't work with INT_MIN
+                break;
+            case BinaryExpr::Sub:
+                op = Add;
+                break;
+            case BinaryExpr::Mul:
+                if (ub == UB::SignOvfMin)
+                    op = Sub;
+                else
+                    op = Div;
+                break;
+            case BinaryExpr::Div:
+            case BinaryExpr::Mod:
+                if (ub == UB::ZeroDiv)
+                   op = Mul;
+                else
+                   op = Sub;
+                break;
+            // Shift operators are tricky.
+            case BinaryExpr::Shr:
+            case BinaryExpr::Shl:
+                //TODO: We should rewrite it later. It is awful.
+                if ((ub == UB::ShiftRhsNeg) || (ub == UB::ShiftRhsLarge)) {
+                    std::shared_ptr<Expr> lhs = arg0;
+                    std::shared_ptr<Expr> rhs = arg1;
+                    // First of all, we need to find maximum value which can be used as rhs.
+                    std::shared_ptr<IntegerType> lhs_int_type =
+                        std::static_pointer_cast<IntegerType>(lhs->get_value_type());
+                    uint64_t max_sht_val = lhs_int_type->get_bit_size();
+                    if ((op == Shl) && (lhs_int_type->get_is_signed()) && (ub == UB::ShiftRhsLarge))
+                        max_sht_val -= msb((uint64_t)lhs->get_scalar_value().get_abs_val());
+                    // Second, we randomly choose value between 0 and maximum rhs value.
+                    uint64_t const_val = rand_val_gen->get_rand_value(uint64_t(0), max_sht_val);
+                    // Third, we combine chosen value with existing rhs
+                    uint64_t rhs_abs_val = rhs->get_scalar_value().get_abs_val();
+                    std::shared_ptr<IntegerType> rhs_int_type =
+                        std::static_pointer_cast<IntegerType>(rhs->get_value_type());
+                    if (ub == UB::ShiftRhsNeg) {
+                        const_val += rhs_abs_val;
+                        // TODO: it won't work with INT_MIN
+                        const_val = std::min(const_val, rhs_int_type->get_max().get_abs_val());
+                    }
+                    else {
+                        const_val = rhs_abs_val - const_val;
+                    }
+
+                    // And finally we insert new child node with corresponding additive operator
+                    BuiltinType::ScalarTypedVal const_ins_val (rhs_int_type->get_int_type_id());
+                    const_ins_val.set_abs_val (const_val);
+                    std::shared_ptr<ConstExpr> const_ins = ir_make_shared<ConstExpr>(const_ins_val);
+                    if (ub == UB::ShiftRhsNeg)
+                        arg1 = ir_make_shared<BinaryExpr>(Add, arg1, const_ins);
+                    else // UB::ShiftRhsLarge
+                        arg1 = ir_make_shared<BinaryExpr>(Sub, arg1, const_ins);
                 }
+                // UB::NegShift
                 else {
-                    const_val = rhs_abs_val - const_val;
+                    // It is simple - we always add MAX value to existing lhs
+                    std::shared_ptr<Expr> lhs = arg0;
+                    std::shared_ptr<IntegerType> lhs_int_type =
+                        std::static_pointer_cast<IntegerType>(lhs->get_value_type());
+                    uint64_t const_val = lhs_int_type->get_max().get_abs_val();
+                    BuiltinType::ScalarTypedVal const_ins_val(lhs_int_type->get_int_type_id());
+                    const_ins_val.set_abs_val (const_val);
+                    std::shared_ptr<ConstExpr> const_ins = ir_make_shared<ConstExpr>(const_ins_val);
+                    arg0 = ir_make_shared<BinaryExpr>(Add, arg0, const_ins);
                 }
-
-                // And finally we insert new child node with corresponding additive operator
-                BuiltinType::ScalarTypedVal const_ins_val (rhs_int_type->get_int_type_id());
-                const_ins_val.set_abs_val (const_val);
-                std::shared_ptr<ConstExpr> const_ins = std::make_shared<ConstExpr>(const_ins_val);
-                if (ub == UB::ShiftRhsNeg)
-                    arg1 = std::make_shared<BinaryExpr>(Add, arg1, const_ins);
-                else // UB::ShiftRhsLarge
-                    arg1 = std::make_shared<BinaryExpr>(Sub, arg1, const_ins);
-            }
-            // UB::NegShift
-            else {
-                // It is simple - we always add MAX value to existing lhs
-                std::shared_ptr<Expr> lhs = arg0;
-                std::shared_ptr<IntegerType> lhs_int_type = std::static_pointer_cast<IntegerType>(lhs->get_value()->get_type());
-                uint64_t const_val = lhs_int_type->get_max().get_abs_val();
-                BuiltinType::ScalarTypedVal const_ins_val(lhs_int_type->get_int_type_id());
-                const_ins_val.set_abs_val (const_val);
-                std::shared_ptr<ConstExpr> const_ins = std::make_shared<ConstExpr>(const_ins_val);
-                arg0 = std::make_shared<BinaryExpr>(Add, arg0, const_ins);
-            }
-            break;
-        case BinaryExpr::Lt:
-        case BinaryExpr::Gt:
-        case BinaryExpr::Le:
-        case BinaryExpr::Ge:
-        case BinaryExpr::Eq:
-        case BinaryExpr::Ne:
-        case BinaryExpr::BitAnd:
-        case BinaryExpr::BitOr:
-        case BinaryExpr::BitXor:
-        case BinaryExpr::LogAnd:
-        case BinaryExpr::LogOr:
-            break;
-        case BinaryExpr::MaxOp:
-        case BinaryExpr::Ter:
-            ERROR("invalid Op (ArithExprGen)");
-            break;
-    }
-    propagate_type();
-    UB ret_ub = propagate_value();
-    if (ret_ub != NoUB) {
-        rebuild(ret_ub);
+                break;
+            case BinaryExpr::Lt:
+            case BinaryExpr::Gt:
+            case BinaryExpr::Le:
+            case BinaryExpr::Ge:
+            case BinaryExpr::Eq:
+            case BinaryExpr::Ne:
+            case BinaryExpr::BitAnd:
+            case BinaryExpr::BitOr:
+            case BinaryExpr::BitXor:
+            case BinaryExpr::LogAnd:
+            case BinaryExpr::LogOr:
+                break;
+            case BinaryExpr::MaxOp:
+            case BinaryExpr::Ter:
+                ERROR("invalid Op (ArithExprGen)");
+                break;
+        }
+        propagate_type();
+        ub = propagate_value();
     }
 }
 
 void BinaryExpr::perform_arith_conv () {
     // integral promotion should be a part of it, but it was moved to base class
     // 10.5.1
-    if (arg0->get_value()->get_type()->get_int_type_id() == arg1->get_value()->get_type()->get_int_type_id())
+    if (arg0->get_value_type()->get_int_type_id() == arg1->get_value_type()->get_int_type_id())
         return;
     // 10.5.2
-    if (arg0->get_value()->get_type()->get_is_signed() == arg1->get_value()->get_type()->get_is_signed()) {
-        std::shared_ptr<Type> cast_to_type = IntegerType::init(std::max(arg0->get_value()->get_type()->get_int_type_id(),
-                                                                        arg1->get_value()->get_type()->get_int_type_id()));
-        if (arg0->get_value()->get_type()->get_int_type_id() <  arg1->get_value()->get_type()->get_int_type_id()) {
-            arg0 = std::make_shared<TypeCastExpr>(arg0, cast_to_type, true);
+    if (arg0->get_value_type()->get_is_signed() == arg1->get_value_type()->get_is_signed()) {
+        std::shared_ptr<Type> cast_to_type = IntegerType::init(std::max(arg0->get_value_type()->get_int_type_id(),
+                                                                        arg1->get_value_type()->get_int_type_id()));
+        if (arg0->get_value_type()->get_int_type_id() <  arg1->get_value_type()->get_int_type_id()) {
+            arg0 = ir_make_shared<TypeCastExpr>(arg0, cast_to_type, true);
         }
         else {
-            arg1 = std::make_shared<TypeCastExpr>(arg1, cast_to_type, true);
+            arg1 = ir_make_shared<TypeCastExpr>(arg1, cast_to_type, true);
         }
         return;
     }
-    if ((!arg0->get_value()->get_type()->get_is_signed() && 
-         (arg0->get_value()->get_type()->get_int_type_id() >= arg1->get_value()->get_type()->get_int_type_id())) || // 10.5.3
-         (arg0->get_value()->get_type()->get_is_signed() && 
-          IntegerType::can_repr_value (arg1->get_value()->get_type()->get_int_type_id(), arg0->get_value()->get_type()->get_int_type_id()))) { // 10.5.4
-        arg1 = std::make_shared<TypeCastExpr>(arg1, IntegerType::init(arg0->get_value()->get_type()->get_int_type_id()), true);
+    if ((!arg0->get_value_type()->get_is_signed() && 
+         (arg0->get_value_type()->get_int_type_id() >= arg1->get_value_type()->get_int_type_id())) || // 10.5.3
+         (arg0->get_value_type()->get_is_signed() && 
+          IntegerType::can_repr_value (arg1->get_value_type()->get_int_type_id(), arg0->get_value_type()->get_int_type_id()))) { // 10.5.4
+        arg1 = ir_make_shared<TypeCastExpr>(arg1, IntegerType::init(arg0->get_value_type()->get_int_type_id()), true);
         return;
     }
-    if ((!arg1->get_value()->get_type()->get_is_signed() &&
-         (arg1->get_value()->get_type()->get_int_type_id() >= arg0->get_value()->get_type()->get_int_type_id())) || // 10.5.3
-         (arg1->get_value()->get_type()->get_is_signed() &&
-          IntegerType::can_repr_value (arg0->get_value()->get_type()->get_int_type_id(), arg1->get_value()->get_type()->get_int_type_id()))) { // 10.5.4
-        arg0 = std::make_shared<TypeCastExpr>(arg0, IntegerType::init(arg1->get_value()->get_type()->get_int_type_id()), true);
+    if ((!arg1->get_value_type()->get_is_signed() &&
+         (arg1->get_value_type()->get_int_type_id() >= arg0->get_value_type()->get_int_type_id())) || // 10.5.3
+         (arg1->get_value_type()->get_is_signed() &&
+          IntegerType::can_repr_value (arg0->get_value_type()->get_int_type_id(), arg1->get_value_type()->get_int_type_id()))) { // 10.5.4
+        arg0 = ir_make_shared<TypeCastExpr>(arg0, IntegerType::init(arg1->get_value_type()->get_int_type_id()), true);
         return;
     }
     // 10.5.5
-    if (arg0->get_value()->get_type()->get_is_signed()) {
-        std::shared_ptr<Type> cast_to_type = IntegerType::init(IntegerType::get_corr_unsig(arg0->get_value()->get_type()->get_int_type_id()));
-        arg0 = std::make_shared<TypeCastExpr>(arg0, cast_to_type, true);
-        arg1 = std::make_shared<TypeCastExpr>(arg1, cast_to_type, true);
+    if (arg0->get_value_type()->get_is_signed()) {
+        std::shared_ptr<Type> cast_to_type = IntegerType::init(IntegerType::get_corr_unsig(arg0->get_value_type()->get_int_type_id()));
+        arg0 = ir_make_shared<TypeCastExpr>(arg0, cast_to_type, true);
+        arg1 = ir_make_shared<TypeCastExpr>(arg1, cast_to_type, true);
     }
-    if (arg1->get_value()->get_type()->get_is_signed()) {
-        std::shared_ptr<Type> cast_to_type = IntegerType::init(IntegerType::get_corr_unsig(arg1->get_value()->get_type()->get_int_type_id()));
-        arg0 = std::make_shared<TypeCastExpr>(arg0, cast_to_type, true);
-        arg1 = std::make_shared<TypeCastExpr>(arg1, cast_to_type, true);
+    if (arg1->get_value_type()->get_is_signed()) {
+        std::shared_ptr<Type> cast_to_type = IntegerType::init(IntegerType::get_corr_unsig(arg1->get_value_type()->get_int_type_id()));
+        arg0 = ir_make_shared<TypeCastExpr>(arg0, cast_to_type, true);
+        arg1 = ir_make_shared<TypeCastExpr>(arg1, cast_to_type, true);
     }
 }
 
@@ -873,8 +1039,8 @@ bool BinaryExpr::propagate_type () {
     }
 
     //TODO: what about overloaded struct operators?
-    if (arg0->get_value()->get_class_id() != Data::VarClassID::VAR ||
-        arg1->get_value()->get_class_id() != Data::VarClassID::VAR) {
+    if (arg0->get_value_class_id() != Data::VarClassID::VAR ||
+        arg1->get_value_class_id() != Data::VarClassID::VAR) {
         ERROR("can perform propagate_type only on ScalarVariable (BinaryExpr)");
     }
 
@@ -922,8 +1088,8 @@ UB BinaryExpr::propagate_value () {
     }
 
     //TODO: what about overloaded struct operators?
-    if (arg0->get_value()->get_class_id() != Data::VarClassID::VAR ||
-        arg1->get_value()->get_class_id() != Data::VarClassID::VAR) {
+    if (arg0->get_value_class_id() != Data::VarClassID::VAR ||
+        arg1->get_value_class_id() != Data::VarClassID::VAR) {
         ERROR("can perform propagate_value only on ScalarVariable (BinaryExpr)");
     }
 
@@ -931,78 +1097,78 @@ UB BinaryExpr::propagate_value () {
     if (op == BinaryExpr::Ter)
         return UB::NoUB;
 
-    std::shared_ptr<ScalarVariable> scalar_lhs = std::static_pointer_cast<ScalarVariable>(arg0->get_value());
-    std::shared_ptr<ScalarVariable> scalar_rhs = std::static_pointer_cast<ScalarVariable>(arg1->get_value());
-    BuiltinType::ScalarTypedVal new_val (scalar_lhs->get_type()->get_int_type_id());
+    BuiltinType::ScalarTypedVal lhs_val = arg0->get_scalar_value();
+    BuiltinType::ScalarTypedVal rhs_val = arg1->get_scalar_value();
+    BuiltinType::ScalarTypedVal new_val (arg0->get_value_type()->get_int_type_id());
 
 /*
     std::cout << "Before prop:" << std::endl;
     arg0->emit(std::cout);
     std::cout << std::endl;
-    std::cout << "lhs: " << std::static_pointer_cast<ScalarVariable>(arg0->get_value())->get_cur_value() << std::endl;
-    std::cout << "lhs val id: " << std::static_pointer_cast<ScalarVariable>(arg0->get_value())->get_cur_value().get_int_type_id() << std::endl;
-    std::cout << "lhs id: " << arg0->get_value()->get_type()->get_int_type_id() << std::endl;
+    std::cout << "lhs: " << arg0->get_scalar_value() << std::endl;
+    std::cout << "lhs val id: " << arg0->get_scalar_value().get_int_type_id() << std::endl;
+    std::cout << "lhs id: " << arg0->get_value_type()->get_int_type_id() << std::endl;
     arg1->emit(std::cout);
     std::cout << std::endl;
-    std::cout << "rhs: " << std::static_pointer_cast<ScalarVariable>(arg1->get_value())->get_cur_value() << std::endl;
-    std::cout << "rhs val id: " << std::static_pointer_cast<ScalarVariable>(arg1->get_value())->get_cur_value().get_int_type_id() << std::endl;
-    std::cout << "rhs id: " << arg1->get_value()->get_type()->get_int_type_id() << std::endl;
+    std::cout << "rhs: " << arg1->get_scalar_value() << std::endl;
+    std::cout << "rhs val id: " << arg1->get_scalar_value().get_int_type_id() << std::endl;
+    std::cout << "rhs id: " << arg1->get_value_type()->get_int_type_id() << std::endl;
 */
 
     switch (op) {
         case Add:
-            new_val = scalar_lhs->get_cur_value() + scalar_rhs->get_cur_value();
+            new_val = lhs_val + rhs_val;
             break;
         case Sub:
-            new_val = scalar_lhs->get_cur_value() - scalar_rhs->get_cur_value();
+            new_val = lhs_val - rhs_val;
             break;
         case Mul:
-            new_val = scalar_lhs->get_cur_value() * scalar_rhs->get_cur_value();
+            new_val = lhs_val * rhs_val;
             break;
         case Div:
-            new_val = scalar_lhs->get_cur_value() / scalar_rhs->get_cur_value();
+            new_val = lhs_val / rhs_val;
             break;
         case Mod:
-            new_val = scalar_lhs->get_cur_value() % scalar_rhs->get_cur_value();
+            new_val = lhs_val % rhs_val;
             break;
         case Lt:
-            new_val = scalar_lhs->get_cur_value() < scalar_rhs->get_cur_value();
+            new_val = lhs_val < rhs_val;
             break;
         case Gt:
-            new_val = scalar_lhs->get_cur_value() > scalar_rhs->get_cur_value();
+            new_val = lhs_val > rhs_val;
             break;
         case Le:
-            new_val = scalar_lhs->get_cur_value() <= scalar_rhs->get_cur_value();
+            new_val = lhs_val <= rhs_val;
             break;
         case Ge:
-            new_val = scalar_lhs->get_cur_value() >= scalar_rhs->get_cur_value();
+            new_val = lhs_val >= rhs_val;
             break;
         case Eq:
-            new_val = scalar_lhs->get_cur_value() == scalar_rhs->get_cur_value();
+            new_val = lhs_val == rhs_val;
             break;
         case Ne:
-            new_val = scalar_lhs->get_cur_value() != scalar_rhs->get_cur_value();
+            new_val = lhs_val != rhs_val;
             break;
         case BitAnd:
-            new_val = scalar_lhs->get_cur_value() & scalar_rhs->get_cur_value();
+            new_val = lhs_val & rhs_val;
             break;
         case BitOr:
-            new_val = scalar_lhs->get_cur_value() | scalar_rhs->get_cur_value();
+            new_val = lhs_val | rhs_val;
             break;
         case BitXor:
-            new_val = scalar_lhs->get_cur_value() ^ scalar_rhs->get_cur_value();
+            new_val = lhs_val ^ rhs_val;
             break;
         case LogAnd:
-            new_val = scalar_lhs->get_cur_value() && scalar_rhs->get_cur_value();
+            new_val = lhs_val && rhs_val;
             break;
         case LogOr:
-            new_val = scalar_lhs->get_cur_value() || scalar_rhs->get_cur_value();
+            new_val = lhs_val || rhs_val;
             break;
         case Shl:
-            new_val = scalar_lhs->get_cur_value() << scalar_rhs->get_cur_value();
+            new_val = lhs_val << rhs_val;
             break;
         case Shr:
-            new_val = scalar_lhs->get_cur_value() >> scalar_rhs->get_cur_value();
+            new_val = lhs_val >> rhs_val;
             break;
         case Ter:
         case MaxOp:
@@ -1011,24 +1177,24 @@ UB BinaryExpr::propagate_value () {
     }
 
     if (!new_val.has_ub()) {
-        value = std::make_shared<ScalarVariable>("", IntegerType::init(new_val.get_int_type_id()));
+        value = ir_make_shared<ScalarVariable>("", IntegerType::init(new_val.get_int_type_id()));
         std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(new_val);
     }
     else {
-        value = std::make_shared<ScalarVariable>("", IntegerType::init(arg0->get_value()->get_type()->get_int_type_id()));
+        value = ir_make_shared<ScalarVariable>("", IntegerType::init(arg0->get_value_type()->get_int_type_id()));
     }
 
 /*
     std::cout << "After prop:" << std::endl;
     arg0->emit(std::cout);
     std::cout << std::endl;
-    std::cout << "lhs: " << std::static_pointer_cast<ScalarVariable>(arg0->get_value())->get_cur_value() << std::endl;
-    std::cout << "lhs val id: " << std::static_pointer_cast<ScalarVariable>(arg0->get_value())->get_cur_value().get_int_type_id() << std::endl;
-    std::cout << "lhs id: " << arg0->get_value()->get_type()->get_int_type_id() << std::endl;
+    std::cout << "lhs: " << arg0->get_scalar_value() << std::endl;
+    std::cout << "lhs val id: " << arg0->get_scalar_value().get_int_type_id() << std::endl;
+    std::cout << "lhs id: " << arg0->get_value_type()->get_int_type_id() << std::endl;
     arg1->emit(std::cout);
     std::cout << std::endl;
-    std::cout << "rhs: " << std::static_pointer_cast<ScalarVariable>(arg1->get_value())->get_cur_value() << std::endl;
-    std::cout << "rhs id: " << arg1->get_value()->get_type()->get_int_type_id() << std::endl;
+    std::cout << "rhs: " << arg1->get_scalar_value() << std::endl;
+    std::cout << "rhs id: " << arg1->get_value_type()->get_int_type_id() << std::endl;
     std::cout << "new_val: " << new_val << std::endl;
     std::cout << "new id: " << new_val.get_int_type_id() << std::endl;
     std::cout << "UB: " << new_val.get_ub() << std::endl;
@@ -1039,73 +1205,62 @@ UB BinaryExpr::propagate_value () {
     return new_val.get_ub();
 }
 
-void BinaryExpr::emit (std::ostream& stream, std::string offset) {
-    stream << offset << "(";
-    arg0->emit(stream);
-    stream << ")";
+const char* BinaryExpr::get_op_str (Op op) {
     switch (op) {
         case Add:
-            stream << " + ";
-            break;
+            return " + ";
         case Sub:
-            stream << " - ";
-            break;
+            return " - ";
         case Mul:
-            stream << " * ";
-            break;
+            return " * ";
         case Div:
-            stream << " / ";
-            break;
+            return " / ";
         case Mod:
-            stream << " % ";
-            break;
+            return " % ";
         case Shl:
-            stream << " << ";
-            break;
+            return " << ";
         case Shr:
-            stream << " >> ";
-            break;
+            return " >> ";
         case Lt:
-            stream << " < ";
-            break;
+            return " < ";
         case Gt:
-            stream << " > ";
-            break;
+            return " > ";
         case Le:
-            stream << " <= ";
-            break;
+            return " <= ";
         case Ge:
-            stream << " >= ";
-            break;
+            return " >= ";
         case Eq:
-            stream << " == ";
-            break;
+            return " == ";
         case Ne:
-            stream << " != ";
-            break;
+            return " != ";
         case BitAnd:
-            stream << " & ";
-            break;
+            return " & ";
         case BitXor:
-            stream << " ^ ";
-            break;
+            return " ^ ";
         case BitOr:
-            stream << " | ";
-            break;
+            return " | ";
         case LogAnd:
-            stream << " && ";
-            break;
+            return " && ";
         case LogOr:
-            stream << " || ";
-            break;
+            return " || ";
         case Ter:
         case MaxOp:
-            ERROR("bad op (BinaryExpr)");
             break;
-        }
-        stream << "(";
-        arg1->emit(stream);
-        stream << ")";
+    }
+    ERROR("bad op (BinaryExpr)");
+}
+
+void BinaryExpr::emit (std::ostream& stream, std::string offset) {
+    stream << offset << "(";
+    arg0->emit(stream);
+    stream << ")" << get_op_str(op) << "(";
+    arg1->emit(stream);
+    stream << ")";
+}
+
+bool BinaryExpr::flatten (FlatExpr& flat_expr) {
+    flat_expr.open_node(Node::NodeID::BINARY, op, *this, {arg0, arg1});
+    return true;
 }
 
 ConditionalExpr::ConditionalExpr (std::shared_ptr<Expr> _cond, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs) :
@@ -1121,20 +1276,20 @@ UB ConditionalExpr::propagate_value() {
     }
 
     //TODO: what about overloaded struct operators?
-    if (condition->get_value()->get_class_id() != Data::VarClassID::VAR)
+    if (condition->get_value_class_id() != Data::VarClassID::VAR)
         ERROR("can perform propagate_value only on ScalarVariable (ConditionalExpr)");
 
-    std::shared_ptr<ScalarVariable> scalar_cond = std::static_pointer_cast<ScalarVariable>(condition->get_value());
+    BuiltinType::ScalarTypedVal cond_scalar_val = condition->get_scalar_value();
     // All other check are done in BinaryExpr constructor
-    std::shared_ptr<ScalarVariable> scalar_lhs = std::static_pointer_cast<ScalarVariable>(arg0->get_value());
-    std::shared_ptr<ScalarVariable> scalar_rhs = std::static_pointer_cast<ScalarVariable>(arg1->get_value());
-    BuiltinType::ScalarTypedVal new_val (scalar_lhs->get_type()->get_int_type_id());
+    BuiltinType::ScalarTypedVal lhs_val = arg0->get_scalar_value();
+    BuiltinType::ScalarTypedVal rhs_val = arg1->get_scalar_value();
+    BuiltinType::ScalarTypedVal new_val (arg0->get_value_type()->get_int_type_id());
 
-    bool cond_val = options->is_cxx() ? scalar_cond->get_cur_value().val.bool_val :
-                                        (bool) scalar_cond->get_cur_value().val.int_val;
-    new_val = cond_val ? scalar_lhs->get_cur_value() : scalar_rhs->get_cur_value();
+    bool cond_val = options->is_cxx() ? cond_scalar_val.val.bool_val :
+                                        (bool) cond_scalar_val.val.int_val;
+    new_val = cond_val ? lhs_val : rhs_val;
 
-    value = std::make_shared<ScalarVariable>("", IntegerType::init(new_val.get_int_type_id()));
+    value = ir_make_shared<ScalarVariable>("", IntegerType::init(new_val.get_int_type_id()));
     std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(new_val);
 
     return UB::NoUB;
@@ -1150,14 +1305,9 @@ void ConditionalExpr::emit (std::ostream& stream, std::string offset) {
     stream << "))";
 }
 
-std::shared_ptr<ConditionalExpr> ConditionalExpr::generate (
-        std::shared_ptr<Context> ctx, std::vector<std::shared_ptr<Expr>> inp, int par_depth) {
-    GenPolicy::add_to_complexity(Node::NodeID::BINARY);
-    std::shared_ptr<Expr> cond = ArithExpr::gen_level (ctx, inp, par_depth);
-    std::shared_ptr<Expr> lhs = ArithExpr::gen_level (ctx, inp, par_depth);
-    std::shared_ptr<Expr> rhs = ArithExpr::gen_level (ctx, inp, par_depth);
-    std::shared_ptr<ConditionalExpr> ret = std::make_shared<ConditionalExpr>(cond, lhs, rhs);
-    return ret;
+bool ConditionalExpr::flatten (FlatExpr& flat_expr) {
+    flat_expr.open_node(Node::NodeID::BINARY, op, *this, {condition, arg0, arg1});
+    return true;
 }
 
 bool MemberExpr::propagate_type () {
@@ -1172,7 +1322,7 @@ bool MemberExpr::propagate_type () {
         value = struct_var;
     }
     else {
-        std::shared_ptr<Data> member_expr_data = member_expr->get_value();
+        std::shared_ptr<Data> member_expr_data = member_expr->get_raw_value();
         if (member_expr_data->get_class_id() != Data::VarClassID::STRUCT) {
             ERROR("can take member only from Struct (MemberExpr)");
         }
@@ -1197,7 +1347,7 @@ UB MemberExpr::propagate_value () {
         value = struct_var->get_member(identifier);
     }
     else {
-        std::shared_ptr<Data> member_expr_data = member_expr->get_value();
+        std::shared_ptr<Data> member_expr_data = member_expr->get_raw_value();
         if (member_expr_data->get_class_id() != Data::VarClassID::STRUCT) {
             ERROR("can take member only from Struct (MemberExpr)");
         }
@@ -1212,25 +1362,24 @@ UB MemberExpr::propagate_value () {
 
 std::shared_ptr<Expr> MemberExpr::set_value (std::shared_ptr<Expr> _expr) {
     //TODO: what about struct?
-    std::shared_ptr<Data> _new_value = _expr->get_value();
-    if (_new_value->get_class_id() != value->get_class_id()) {
+    if (_expr->get_value_class_id() != value->get_class_id()) {
         ERROR("different Data::VarClassID (MemberExpr)");
     }
     switch (value->get_class_id()) {
         case Data::VarClassID::VAR:
-            if (value->get_type()->get_int_type_id() != _new_value->get_type()->get_int_type_id()) {
+            if (value->get_type()->get_int_type_id() != _expr->get_value_type()->get_int_type_id()) {
                 ERROR("can't assign different types (MemberExpr)");
             }
             if (value->get_type()->get_is_bit_field())
                 return check_and_set_bit_field(_expr);
             else {
-                std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(std::static_pointer_cast<ScalarVariable>(_new_value)->get_cur_value());
+                std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(_expr->get_scalar_value());
                 return _expr;
             }
             break;
         case Data::VarClassID::POINTER: {
             std::shared_ptr<Pointer> value_ptr = std::static_pointer_cast<Pointer>(value);
-            std::shared_ptr<Pointer> _new_value_ptr = std::static_pointer_cast<Pointer>(_new_value);
+            std::shared_ptr<Pointer> _new_value_ptr = std::static_pointer_cast<Pointer>(_expr->get_value());
             if (value_ptr->get_pointee()->get_type()->get_int_type_id() !=
                 _new_value_ptr->get_pointee()->get_type()->get_int_type_id()) {
                 ERROR("can't assign different types (MemberExpr)");
@@ -1253,19 +1402,18 @@ std::shared_ptr<Expr> MemberExpr::set_value (std::shared_ptr<Expr> _expr) {
 }
 
 static std::shared_ptr<Expr> change_to_value(std::shared_ptr<Context> ctx, std::shared_ptr<Expr> _expr, BuiltinType::ScalarTypedVal to_val) {
-    std::shared_ptr<Data> expr_data = _expr->get_value();
-    if (expr_data->get_class_id() != Data::VarClassID::VAR) {
+    if (_expr->get_value_class_id() != Data::VarClassID::VAR) {
         ERROR("only variables are supported");
     }
-    BuiltinType::ScalarTypedVal value = std::static_pointer_cast<ScalarVariable>(expr_data)->get_cur_value();
-    std::shared_ptr<ConstExpr> const_expr = std::make_shared<ConstExpr>(value);
-    std::shared_ptr<Expr> to_zero =  std::make_shared<BinaryExpr>(BinaryExpr::Op::Sub, _expr, const_expr);
-    std::shared_ptr<ConstExpr> to_val_const_expr = std::make_shared<ConstExpr>(to_val);
-    return std::make_shared<BinaryExpr>(BinaryExpr::Op::Add, to_zero, to_val_const_expr);
+    BuiltinType::ScalarTypedVal value = _expr->get_scalar_value();
+    std::shared_ptr<ConstExpr> const_expr = ir_make_shared<ConstExpr>(value);
+    std::shared_ptr<Expr> to_zero =  ir_make_shared<BinaryExpr>(BinaryExpr::Op::Sub, _expr, const_expr);
+    std::shared_ptr<ConstExpr> to_val_const_expr = ir_make_shared<ConstExpr>(to_val);
+    return ir_make_shared<BinaryExpr>(BinaryExpr::Op::Add, to_zero, to_val_const_expr);
 }
 
 std::shared_ptr<Expr> MemberExpr::check_and_set_bit_field (std::shared_ptr<Expr> _expr) {
-    BuiltinType::ScalarTypedVal new_val = std::static_pointer_cast<ScalarVariable>(_expr->get_value())->get_cur_value();
+    BuiltinType::ScalarTypedVal new_val = _expr->get_scalar_value();
     std::shared_ptr<BitField> bit_field = std::static_pointer_cast<BitField>(value->get_type());
     BuiltinType::ScalarTypedVal ovf_cmp_val = (bit_field->get_min() > new_val) || (bit_field->get_max() < new_val);
     if (!ovf_cmp_val.val.bool_val) {
@@ -1275,12 +1423,12 @@ std::shared_ptr<Expr> MemberExpr::check_and_set_bit_field (std::shared_ptr<Expr>
     //TODO: it is a stub. We need to change it
     GenPolicy gen_policy;
     Context ctx_var (gen_policy, nullptr, Node::NodeID::MAX_STMT_ID, true);
-    ctx_var.set_local_sym_table(std::make_shared<SymbolTable>());
-    std::shared_ptr<Context> ctx = std::make_shared<Context>(ctx_var);
+    ctx_var.set_local_sym_table(ir_make_shared<SymbolTable>());
+    std::shared_ptr<Context> ctx = ir_make_shared<Context>(ctx_var);
     BuiltinType::ScalarTypedVal to_value = BuiltinType::ScalarTypedVal::generate(ctx, bit_field->get_min(), bit_field->get_max());
     std::shared_ptr<Expr> ret = change_to_value(ctx, _expr, to_value);
 
-    std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(std::static_pointer_cast<ScalarVariable>(ret->get_value())->get_cur_value());
+    std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(ret->get_scalar_value());
     return ret;
 }
 
@@ -1294,10 +1442,10 @@ void MemberExpr::emit (std::ostream& stream, std::string offset) {
         if (struct_var->get_member_count() <= identifier) {
             ERROR("bad identifier (MemberExpr)");
         }
-        stream << struct_var->get_name() + "." + struct_var->get_member(identifier)->get_name();
+        stream << struct_var->get_name_id() << "." << struct_var->get_member(identifier)->get_name_id();
     }
     else {
-        std::shared_ptr<Data> member_expr_data = member_expr->get_value();
+        std::shared_ptr<Data> member_expr_data = member_expr->get_raw_value();
         if (member_expr_data->get_class_id() != Data::VarClassID::STRUCT) {
             ERROR("can take member only from Struct (MemberExpr)");
         }
@@ -1306,7 +1454,7 @@ void MemberExpr::emit (std::ostream& stream, std::string offset) {
             ERROR("bad identifier (MemberExpr)");
         }
         member_expr->emit(stream);
-        stream << "." +  member_expr_struct->get_member(identifier)->get_name();
+        stream << "." << member_expr_struct->get_member(identifier)->get_name_id();
     }
 }
 
@@ -1317,7 +1465,7 @@ MemberExpr::MemberExpr(std::shared_ptr<Struct> _struct, uint64_t _identifier) :
 }
 
 MemberExpr::MemberExpr(std::shared_ptr<MemberExpr> _member_expr, uint64_t _identifier) :
-        Expr(Node::NodeID::MEMBER, _member_expr->get_value(), _member_expr->get_complexity() + 1),
+        Expr(Node::NodeID::MEMBER, _member_expr->get_raw_value(), _member_expr->get_complexity() + 1),
         member_expr(_member_expr), struct_var(nullptr), identifier(_identifier) {
     propagate_type();
     propagate_value();
@@ -1335,7 +1483,7 @@ AddressOfExpr::AddressOfExpr(std::shared_ptr<Expr> expr) :
         addr_of_expr_value = std::static_pointer_cast<MemberExpr>(addr_of_expr)->get_raw_value();
     else
         addr_of_expr_value = addr_of_expr->get_value();
-    value = std::make_shared<Pointer>("", addr_of_expr_value);
+    value = ir_make_shared<Pointer>("", addr_of_expr_value);
 }
 
 void AddressOfExpr::emit (std::ostream& stream, std::string offset) {
@@ -1350,7 +1498,7 @@ ExprStar::ExprStar(std::shared_ptr<Expr> expr) :
     if (expr_star->get_id() != Node::NodeID::VAR_USE && expr_star->get_id() != Node::NodeID::MEMBER &&
         expr_star->get_id() != Node::NodeID::REFERENCE && expr_star->get_id() != Node::NodeID::DEREFERENCE)
         ERROR("pointer can be stored only in variable or member of structure");
-    if (!expr_star->get_value()->get_type()->is_ptr_type())
+    if (!expr_star->get_value_type()->is_ptr_type())
         ERROR("can dereference only pointer");
     value = std::static_pointer_cast<Pointer>(expr_star->get_value())->get_pointee();
 }
@@ -1362,28 +1510,27 @@ void ExprStar::emit (std::ostream& stream, std::string offset) {
     stream << ")";
 }
 
-std::shared_ptr<Data> ExprStar::get_value () {
+const std::shared_ptr<Data>& ExprStar::peek_value () {
     value = std::static_pointer_cast<Pointer>(expr_star->get_value())->get_pointee();
-    return Expr::get_value();
+    return value;
 }
 
 std::shared_ptr<Expr> ExprStar::set_value (std::shared_ptr<Expr> _expr) {
-    std::shared_ptr<Data> _new_value = _expr->get_value();
-    if (_new_value->get_class_id() != value->get_class_id())
+    if (_expr->get_value_class_id() != value->get_class_id())
         ERROR("different Data::VarClassID (ExprStar)");
 
     switch (value->get_class_id()) {
         case Data::VarClassID::VAR:
-            if (value->get_type()->get_int_type_id() != _new_value->get_type()->get_int_type_id())
+            if (value->get_type()->get_int_type_id() != _expr->get_value_type()->get_int_type_id())
                 ERROR("can't assign different types (ExprStar)");
             if (value->get_type()->get_is_bit_field())
                 ERROR("pointer can't reference bit-field (ExprStar)");
-            std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(std::static_pointer_cast<ScalarVariable>(_new_value)->get_cur_value());
+            std::static_pointer_cast<ScalarVariable>(value)->set_cur_value(_expr->get_scalar_value());
             return _expr;
             break;
         case Data::VarClassID::POINTER: {
             std::shared_ptr<Pointer> value_ptr = std::static_pointer_cast<Pointer>(value);
-            std::shared_ptr<Pointer> _new_value_ptr = std::static_pointer_cast<Pointer>(_new_value);
+            std::shared_ptr<Pointer> _new_value_ptr = std::static_pointer_cast<Pointer>(_expr->get_value());
             if (value_ptr->get_pointee()->get_type()->get_int_type_id() !=
                 _new_value_ptr->get_pointee()->get_type()->get_int_type_id()) {
                 ERROR("can't assign different types (ExprStar)");
@@ -1404,3 +1551,154 @@ std::shared_ptr<Expr> ExprStar::set_value (std::shared_ptr<Expr> _expr) {
     }
     ERROR("ExprStar::set_value(ExprStar) - data corruption");
 }
+
+std::vector<FlatExpr::PendingExpr> FlatExpr::pending;
+
+void FlatExpr::append (std::shared_ptr<Expr> expr) {
+    size_t stack_bottom = pending.size();
+    pending.push_back({expr, 0});
+    while (pending.size() > stack_bottom) {
+        PendingExpr cur = std::move(pending.back());
+        pending.pop_back();
+        if (cur.expr == nullptr)
+            subtree_end.at(cur.node) = kinds.size();
+        else if (!cur.expr->flatten(*this)) {
+            // Leaves can be without value (e.g. StubExpr), so we don't look at it
+            BuiltinType::ScalarTypedVal::Val val;
+            val.ullint_val = 0;
+            add_node(cur.expr->get_id(), 0, Type::IntegerTypeID::MAX_INT_ID, val);
+            leaves.push_back(cur.expr);
+        }
+    }
+}
+
+void FlatExpr::open_node (Node::NodeID kind, uint8_t op, Expr& expr,
+                          std::initializer_list<std::shared_ptr<Expr>> args) {
+    BuiltinType::ScalarTypedVal::Val val;
+    val.ullint_val = 0;
+    if (expr.get_value_class_id() == Data::VarClassID::VAR)
+        val = expr.get_scalar_value().val;
+    uint32_t node = add_node(kind, op, expr.get_value_type()->get_int_type_id(), val);
+    // The last argument is closer to the top of the stack, so the arguments are appended in their order
+    pending.push_back({nullptr, node});
+    for (const std::shared_ptr<Expr>* arg = args.end(); arg != args.begin(); )
+        pending.push_back({*--arg, 0});
+}
+
+uint32_t FlatExpr::add_node (Node::NodeID kind, uint8_t op, Type::IntegerTypeID type_id,
+                             BuiltinType::ScalarTypedVal::Val val) {
+    uint32_t node = kinds.size();
+    kinds.push_back(kind);
+    ops.push_back(op);
+    type_ids.push_back(type_id);
+    values.push_back(val);
+    subtree_end.push_back(node + 1);
+    return node;
+}
+
+uint32_t FlatExpr::get_arg_count (uint32_t node) const {
+    switch (kinds[node]) {
+        case Node::NodeID::ASSIGN:
+            return 2;
+        case Node::NodeID::BINARY:
+            return ops[node] == BinaryExpr::Op::Ter ? 3 : 2;
+        case Node::NodeID::TYPE_CAST:
+        case Node::NodeID::UNARY:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+void FlatExpr::emit_prefix (std::ostream& stream, uint32_t node, uint32_t& leaf_num) const {
+    switch (kinds[node]) {
+        case Node::NodeID::ASSIGN:
+            break;
+        case Node::NodeID::BINARY:
+            stream << (ops[node] == BinaryExpr::Op::Ter ? "((" : "(");
+            break;
+        case Node::NodeID::CONST: {
+            BuiltinType::ScalarTypedVal val (type_ids[node]);
+            val.val = values[node];
+            ConstExpr::emit_value(stream, val);
+            break;
+        }
+        case Node::NodeID::TYPE_CAST:
+            stream << "(" << IntegerType::init(type_ids[node])->get_simple_name() << ") (";
+            break;
+        case Node::NodeID::UNARY: {
+            UnaryExpr::Op op = static_cast<UnaryExpr::Op>(ops[node]);
+            if (op == UnaryExpr::Op::PostInc || op == UnaryExpr::Op::PostDec)
+                stream << "(";
+            else
+                stream << UnaryExpr::get_op_str(op) << "(";
+            break;
+        }
+        default:
+            leaves.at(leaf_num++)->emit(stream);
+            break;
+    }
+}
+
+void FlatExpr::emit_after_arg (std::ostream& stream, uint32_t node, uint32_t arg_num) const {
+    switch (kinds[node]) {
+        case Node::NodeID::ASSIGN:
+            if (arg_num == 0)
+                stream << " = ";
+            break;
+        case Node::NodeID::BINARY:
+            if (ops[node] == BinaryExpr::Op::Ter) {
+                static const char* const ter_parts [] = { ") ? (", ") : (", "))" };
+                stream << ter_parts[arg_num];
+            }
+            else if (arg_num == 0)
+                stream << ")" << BinaryExpr::get_op_str(static_cast<BinaryExpr::Op>(ops[node])) << "(";
+            else
+                stream << ")";
+            break;
+        case Node::NodeID::TYPE_CAST:
+            stream << ")";
+            break;
+        case Node::NodeID::UNARY: {
+            UnaryExpr::Op op = static_cast<UnaryExpr::Op>(ops[node]);
+            stream << ")";
+            if (op == UnaryExpr::Op::PostInc || op == UnaryExpr::Op::PostDec)
+                stream << UnaryExpr::get_op_str(op);
+            break;
+        }
+        default:
+            ERROR("node without arguments (FlatExpr)");
+    }
+}
+
+// Nodes are visited in pre-order, which is also the order of their text. Stack keeps nodes, which arguments
+// are emitted at the moment, with the number of already finished arguments.
+void FlatExpr::emit (std::ostream& stream) const {
+    if (empty())
+        return;
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    uint32_t leaf_num = 0;
+    uint32_t node = 0;
+    while (true) {
+        emit_prefix(stream, node, leaf_num);
+        if (get_arg_count(node) > 0) {
+            stack.emplace_back(node, 0);
+            node++;
+            continue;
+        }
+        // Subtree of the node is finished, so we go up until we find parent with remaining arguments
+        uint32_t finished = node;
+        while (!stack.empty()) {
+            uint32_t parent = stack.back().first;
+            uint32_t arg_num = stack.back().second++;
+            emit_after_arg(stream, parent, arg_num);
+            if (arg_num + 1 < get_arg_count(parent))
+                break;
+            finished = parent;
+            stack.pop_back();
+        }
+        if (stack.empty())
+            return;
+        node = subtree_end[finished];
+    }
+}
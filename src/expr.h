@@ -1,5 +1,6 @@
 #pragma once
 
+#include <initializer_list>
 #include <vector>
 
 #include "ir_node.h"
@@ -9,7 +10,9 @@
 namespace oorgen {
 
 class Context;
+class FlatExpr;
 class GenPolicy;
+class InpExprIndex;
 
 //抽象类，用来作为所有表达式的父类
 class Expr : public Node {
@@ -19,13 +22,26 @@ class Expr : public Node {
               Node(_id), value(_value), complexity(_compl) {}
         // Getters and Setters
         Type::TypeID get_type_id () { return value->get_type()->get_type_id (); }
-        virtual std::shared_ptr<Data> get_value ();
+        // get_value returns a copy of the value, which can be changed by the caller.
+        // Queries should use functions below, which don't copy anything.
+        std::shared_ptr<Data> get_value ();
+        Data::VarClassID get_value_class_id () { return peek_value()->get_class_id(); }
+        std::shared_ptr<Type> get_value_type () { return peek_value()->get_type(); }
+        // Current value of expression with scalar result
+        BuiltinType::ScalarTypedVal get_scalar_value ();
         uint32_t get_complexity() { return complexity; }
+        // Appends node of the expression to flat encoding with its arguments (see FlatExpr::open_node).
+        // Expressions, which return false, are kept in the encoding as opaque leaves.
+        virtual bool flatten (FlatExpr&) { return false; }
         static void increase_expr_count(uint32_t val) { total_expr_count += val; func_expr_count += val; }
         static uint32_t get_total_expr_count () { return total_expr_count; }
         static void zero_out_func_expr_count () { func_expr_count = 0; }
 
     protected:
+        // Deep trees would overflow the stack, if each node released its arguments from its destructor,
+        // so destructors of operators pass their arguments here and they are released in a loop.
+        static void release_arg (std::shared_ptr<Expr>& arg);
+
         // 此函数会将语言标准要求的类型转换（隐式强制转换，Integral提升或常规算术转换）执行到现有子节点。
         // 结果，它在现存子节点和当前节点之间插入所需的TypeCastExpr。
         virtual bool propagate_type () = 0;
@@ -33,6 +49,8 @@ class Expr : public Node {
         // 此函数基于当前节点的子节点们，计算当前节点的值
         // 也探测UB并且消除它，需要首先调用propagate_type()
         virtual UB propagate_value () = 0;
+        // Actual value of the expression without copying
+        virtual const std::shared_ptr<Data>& peek_value () { return value; }
         std::shared_ptr<Data> value;
         uint32_t complexity;
 
@@ -51,7 +69,7 @@ class VarUseExpr : public Expr {
         std::shared_ptr<Expr> set_value (std::shared_ptr<Expr> _expr);
         // 此方法可以直接访问基本变量
         std::shared_ptr<Data> get_raw_value () { return value; }
-        void emit (std::ostream& stream, std::string offset = "") { stream << value->get_name (); }
+        void emit (std::ostream& stream, std::string offset = "") { stream << value->get_name_id(); }
 
     private:
         bool propagate_type () { return true; }
@@ -64,7 +82,9 @@ class VarUseExpr : public Expr {
 class AssignExpr : public Expr {
     public:
         AssignExpr (std::shared_ptr<Expr> _to, std::shared_ptr<Expr> _from, bool _taken = true);
+        ~AssignExpr () { release_arg(from); }
         void emit (std::ostream& stream, std::string offset = "");
+        bool flatten (FlatExpr& flat_expr);
 
     private:
         bool propagate_type ();
@@ -85,7 +105,9 @@ class AssignExpr : public Expr {
 class TypeCastExpr : public Expr {
     public:
         TypeCastExpr (std::shared_ptr<Expr> _expr, std::shared_ptr<Type> _type, bool _is_implicit = false);
+        ~TypeCastExpr () { release_arg(expr); }
         void emit (std::ostream& stream, std::string offset = "");
+        bool flatten (FlatExpr& flat_expr);
         static std::shared_ptr<TypeCastExpr> generate (std::shared_ptr<Context> ctx, std::shared_ptr<Expr> from);
 
     private:
@@ -107,6 +129,9 @@ class ConstExpr : public Expr {
     public:
         ConstExpr (BuiltinType::ScalarTypedVal _val);
         void emit (std::ostream& stream, std::string offset = "");
+        bool flatten (FlatExpr& flat_expr);
+        // Emits literal for the value
+        static void emit_value (std::ostream& stream, BuiltinType::ScalarTypedVal val);
         static std::shared_ptr<ConstExpr> generate (std::shared_ptr<Context> ctx);
 
         // 此函数将填充所用常量的内部缓冲区（对于每种context类型都是唯一的），
@@ -121,7 +146,7 @@ class ConstExpr : public Expr {
         static std::vector<BuiltinType::ScalarTypedVal> bit_log_const_buffer;
 
         template <typename T>
-        std::string to_string(T T_val, T min, std::string suffix);
+        static std::string to_string(T T_val, T min, bool is_signed, std::string suffix);
         bool propagate_type () { return true; }
         UB propagate_value () { return NoUB; }
 };
@@ -133,7 +158,7 @@ class ArithExpr : public Expr {
     public:
         // ArithExpr的复杂度应在所有转换后手动设置，而不是传递给Expr构造函数
         ArithExpr(Node::NodeID _node_id, std::shared_ptr<Data> _val) : Expr(_node_id, _val, 0) {}
-        static std::shared_ptr<Expr> generate (std::shared_ptr<Context> ctx, std::vector<std::shared_ptr<Expr>> inp);
+        static std::shared_ptr<Expr> generate (std::shared_ptr<Context> ctx, const InpExprIndex& inp);
 
     protected:
         // This function chooses one of ArithSSP::ConstUse patterns and combines old_gen_policy with it
@@ -142,8 +167,10 @@ class ArithExpr : public Expr {
         static GenPolicy choose_and_apply_ssp_similar_op (GenPolicy old_gen_policy);
         // Bridge to choose_and_apply_ssp_const_use and choose_and_apply_ssp_similar_op. This function combines both of them.
         static GenPolicy choose_and_apply_ssp (GenPolicy old_gen_policy);
-        // Top-level recursive function for expression tree generation
-        static std::shared_ptr<Expr> gen_level (std::shared_ptr<Context> ctx, std::vector<std::shared_ptr<Expr>> inp, uint32_t par_depth);
+        // Returns context with single statement patterns applied (it is the same context if they are already chosen)
+        static std::shared_ptr<Context> apply_ssp (std::shared_ptr<Context> ctx);
+        // Top-level function for expression tree generation. It uses explicit stack instead of recursion.
+        static std::shared_ptr<Expr> gen_level (std::shared_ptr<Context> ctx, const InpExprIndex& inp, uint32_t par_depth);
 
         std::shared_ptr<Expr> integral_prom (std::shared_ptr<Expr> arg);
         std::shared_ptr<Expr> conv_to_bool (std::shared_ptr<Expr> arg);
@@ -168,9 +195,11 @@ class UnaryExpr : public ArithExpr {
             MaxOp
         };
         UnaryExpr (Op _op, std::shared_ptr<Expr> _arg);
+        ~UnaryExpr () { release_arg(arg); }
         Op get_op () { return op; }
-        static std::shared_ptr<UnaryExpr> generate (std::shared_ptr<Context> ctx, std::vector<std::shared_ptr<Expr>> inp, uint32_t par_depth);
         void emit (std::ostream& stream, std::string offset = "");
+        bool flatten (FlatExpr& flat_expr);
+        static const char* get_op_str (Op op);
 
     private:
         bool propagate_type ();
@@ -215,9 +244,12 @@ class BinaryExpr : public ArithExpr {
         };
 
         BinaryExpr (Op _op, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs);
+        ~BinaryExpr () { release_arg(arg0); release_arg(arg1); }
         Op get_op () { return op; }
-        static std::shared_ptr<BinaryExpr> generate (std::shared_ptr<Context> ctx, std::vector<std::shared_ptr<Expr>> inp, uint32_t par_depth);
         void emit (std::ostream& stream, std::string offset = "");
+        bool flatten (FlatExpr& flat_expr);
+        // Operator with surrounding spaces, e.g. " + "
+        static const char* get_op_str (Op op);
 
     protected:
         bool propagate_type ();
@@ -235,8 +267,9 @@ class BinaryExpr : public ArithExpr {
 class ConditionalExpr : public BinaryExpr {
     public:
         ConditionalExpr (std::shared_ptr<Expr> _cond, std::shared_ptr<Expr> lhs, std::shared_ptr<Expr> rhs);
+        ~ConditionalExpr () { release_arg(condition); }
         void emit (std::ostream& stream, std::string offset = "");
-        static std::shared_ptr<ConditionalExpr> generate (std::shared_ptr<Context> ctx, std::vector<std::shared_ptr<Expr>> inp, int par_depth);
+        bool flatten (FlatExpr& flat_expr);
 
     private:
         UB propagate_value ();
@@ -282,12 +315,13 @@ class ExprStar : public Expr {
     public:
         ExprStar(std::shared_ptr<Expr> expr);
         std::shared_ptr<Expr> set_value (std::shared_ptr<Expr> _expr);
-        std::shared_ptr<Data> get_value ();
         void emit (std::ostream& stream, std::string offset = "");
 
     private:
         bool propagate_type () { return true; }
         UB propagate_value () { return NoUB; }
+        // Pointer can be retargeted after creation of the expression, so value is updated on every access
+        const std::shared_ptr<Data>& peek_value ();
 
         std::shared_ptr<Expr> expr_star;
 };
@@ -304,4 +338,52 @@ class StubExpr : public Expr {
 
         std::string string;
 };
+
+// Flat encoding of expression tree. Statements keep their expressions in it after generation is finished,
+// so the tree can be released and emission doesn't chase pointers. It is used only for storage and emission:
+// generation and UB repair still work on the tree.
+// Nodes are stored in pre-order in parallel arrays (structure of arrays). The first argument of node i is i + 1,
+// each next argument starts at subtree_end of the previous one.
+// Constants, type casts, arithmetic and assignments are encoded completely. Other expressions (variables,
+// members, address-of and dereference) are kept as opaque leaves, which are listed in pre-order too.
+class FlatExpr {
+    public:
+        FlatExpr () {}
+        explicit FlatExpr (std::shared_ptr<Expr> root) { append(root); }
+
+        bool empty () const { return kinds.empty(); }
+        void emit (std::ostream& stream) const;
+
+        // Appends expression and all its arguments. Arguments are appended without recursion: they wait
+        // on the stack of pending expressions, which is shared by all encodings.
+        void append (std::shared_ptr<Expr> expr);
+        // Interface for Expr::flatten. It appends the node and puts its arguments on the stack,
+        // so they are appended right after it.
+        void open_node (Node::NodeID kind, uint8_t op, Expr& expr,
+                        std::initializer_list<std::shared_ptr<Expr>> args);
+
+    private:
+        // Expression, which waits for appending, or the end of the node's arguments (if expr is nullptr)
+        struct PendingExpr {
+            std::shared_ptr<Expr> expr;
+            uint32_t node;
+        };
+        static std::vector<PendingExpr> pending;
+
+        uint32_t add_node (Node::NodeID kind, uint8_t op, Type::IntegerTypeID type_id, BuiltinType::ScalarTypedVal::Val val);
+        uint32_t get_arg_count (uint32_t node) const;
+        // Text before the first argument and after each argument of the node
+        void emit_prefix (std::ostream& stream, uint32_t node, uint32_t& leaf_num) const;
+        void emit_after_arg (std::ostream& stream, uint32_t node, uint32_t arg_num) const;
+
+        std::vector<Node::NodeID> kinds;
+        // UnaryExpr::Op or BinaryExpr::Op
+        std::vector<uint8_t> ops;
+        std::vector<Type::IntegerTypeID> type_ids;
+        // Value at the moment of encoding (only for expressions with scalar result)
+        std::vector<BuiltinType::ScalarTypedVal::Val> values;
+        // Position after the last node of the subtree
+        std::vector<uint32_t> subtree_end;
+        std::vector<std::shared_ptr<Expr>> leaves;
+};
 }
@@ -1,4 +1,10 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
 #include <map>
+#include <sstream>
 
 #include "gen_policy.h"
 
@@ -6,526 +12,492 @@
 
 using namespace oorgen;
 
-const uint32_t TEST_FUNC_COUNT = 5;
-
-const uint32_t MAX_ALLOWED_INT_TYPES = 3;
-
-const uint32_t MAX_ARITH_DEPTH = 5;
-const uint32_t MAX_TOTAL_EXPR_COUNT = 50000000;
-const uint32_t MAX_FUNC_EXPR_COUNT = 10000000;
-
-const uint32_t MIN_SCOPE_STMT_COUNT = 5;
-const uint32_t MAX_SCOPE_STMT_COUNT = 10;
-
-const uint32_t MAX_TOTAL_STMT_COUNT = 5000;
-const uint32_t MAX_FUNC_STMT_COUNT = 1000;
-
-const uint32_t MIN_INP_VAR_COUNT = 20;
-const uint32_t MAX_INP_VAR_COUNT = 60;
-const uint32_t MIN_MIX_VAR_COUNT = 20;
-const uint32_t MAX_MIX_VAR_COUNT = 60;
-
-const uint32_t MAX_CSE_COUNT = 5;
-
-const uint32_t MAX_IF_DEPTH = 3;
-
-const uint64_t MAX_TEST_COMPLEXITY = UINT64_MAX;
-
-const uint32_t MIN_STRUCT_TYPES_COUNT = 0;
-const uint32_t MAX_STRUCT_TYPES_COUNT = 6;
-const uint32_t MIN_INP_STRUCT_COUNT = 0;
-const uint32_t MAX_INP_STRUCT_COUNT = 6;
-const uint32_t MIN_MIX_STRUCT_COUNT = 0;
-const uint32_t MAX_MIX_STRUCT_COUNT = 6;
-const uint32_t MIN_OUT_STRUCT_COUNT = 0;
-const uint32_t MAX_OUT_STRUCT_COUNT = 8;
-const uint32_t MIN_STRUCT_MEMBER_COUNT = 1;
-const uint32_t MAX_STRUCT_MEMBER_COUNT = 10;
-const uint32_t MAX_STRUCT_DEPTH = 5;
-const uint32_t MIN_BIT_FIELD_SIZE = 8;
-const uint32_t MAX_BIT_FIELD_SIZE = 2; //TODO: unused, because it cause different result for LLVM and GCC. See pr70733
-
-const uint32_t CONST_BUFFER_SIZE = 4;
-
-// This switch totally disables array in generated tests
-const bool DISABLE_ARRAYS = false;
-const uint32_t MIN_ARRAY_SIZE = 2;
-const uint32_t MAX_ARRAY_SIZE = 10;
-const uint32_t MIN_ARRAY_TYPES_COUNT = 0;
-const uint32_t MAX_ARRAY_TYPES_COUNT = 6;
-const uint32_t MIN_INP_ARRAY_COUNT = 0;
-const uint32_t MAX_INP_ARRAY_COUNT = 6;
-const uint32_t MIN_MIX_ARRAY_COUNT = 0;
-const uint32_t MAX_MIX_ARRAY_COUNT = 6;
-const uint32_t MIN_OUT_ARRAY_COUNT = 0;
-const uint32_t MAX_OUT_ARRAY_COUNT = 8;
-
-const uint32_t MIN_INP_PTR_COUNT = 0;
-const uint32_t MAX_INP_PTR_COUNT = 10;
-const uint32_t MIN_MIX_PTR_COUNT = 0;
-const uint32_t MAX_MIX_PTR_COUNT = 10;
-const uint32_t MIN_OUT_PTR_COUNT = 0;
-const uint32_t MAX_OUT_PTR_COUNT = 10;
-
-///////////////////////////////////////////////////////////////////////////////
+const std::map<std::string, uint64_t GenProfile::*> GenProfile::knobs = {
+    {"test_func_count", &GenProfile::test_func_count},
+    {"max_allowed_int_types", &GenProfile::max_allowed_int_types},
+    {"max_arith_depth", &GenProfile::max_arith_depth},
+    {"max_arith_node_count", &GenProfile::max_arith_node_count},
+    {"arith_data_weight", &GenProfile::arith_data_weight},
+    {"arith_unary_weight", &GenProfile::arith_unary_weight},
+    {"arith_binary_weight", &GenProfile::arith_binary_weight},
+    {"arith_conditional_weight", &GenProfile::arith_conditional_weight},
+    {"arith_type_cast_weight", &GenProfile::arith_type_cast_weight},
+    {"arith_cse_weight", &GenProfile::arith_cse_weight},
+    {"max_total_expr_count", &GenProfile::max_total_expr_count},
+    {"max_func_expr_count", &GenProfile::max_func_expr_count},
+    {"min_scope_stmt_count", &GenProfile::min_scope_stmt_count},
+    {"max_scope_stmt_count", &GenProfile::max_scope_stmt_count},
+    {"max_total_stmt_count", &GenProfile::max_total_stmt_count},
+    {"max_func_stmt_count", &GenProfile::max_func_stmt_count},
+    {"min_inp_var_count", &GenProfile::min_inp_var_count},
+    {"max_inp_var_count", &GenProfile::max_inp_var_count},
+    {"min_mix_var_count", &GenProfile::min_mix_var_count},
+    {"max_mix_var_count", &GenProfile::max_mix_var_count},
+    {"max_cse_count", &GenProfile::max_cse_count},
+    {"max_if_depth", &GenProfile::max_if_depth},
+    {"max_test_complexity", &GenProfile::max_test_complexity},
+    {"min_struct_types_count", &GenProfile::min_struct_types_count},
+    {"max_struct_types_count", &GenProfile::max_struct_types_count},
+    {"min_inp_struct_count", &GenProfile::min_inp_struct_count},
+    {"max_inp_struct_count", &GenProfile::max_inp_struct_count},
+    {"min_mix_struct_count", &GenProfile::min_mix_struct_count},
+    {"max_mix_struct_count", &GenProfile::max_mix_struct_count},
+    {"min_out_struct_count", &GenProfile::min_out_struct_count},
+    {"max_out_struct_count", &GenProfile::max_out_struct_count},
+    {"min_struct_member_count", &GenProfile::min_struct_member_count},
+    {"max_struct_member_count", &GenProfile::max_struct_member_count},
+    {"max_struct_depth", &GenProfile::max_struct_depth},
+    {"min_bit_field_size", &GenProfile::min_bit_field_size},
+    {"max_bit_field_size", &GenProfile::max_bit_field_size},
+    {"const_buffer_size", &GenProfile::const_buffer_size},
+    {"disable_arrays", &GenProfile::disable_arrays},
+    {"min_array_size", &GenProfile::min_array_size},
+    {"max_array_size", &GenProfile::max_array_size},
+    {"min_array_types_count", &GenProfile::min_array_types_count},
+    {"max_array_types_count", &GenProfile::max_array_types_count},
+    {"min_inp_array_count", &GenProfile::min_inp_array_count},
+    {"max_inp_array_count", &GenProfile::max_inp_array_count},
+    {"min_mix_array_count", &GenProfile::min_mix_array_count},
+    {"max_mix_array_count", &GenProfile::max_mix_array_count},
+    {"min_out_array_count", &GenProfile::min_out_array_count},
+    {"max_out_array_count", &GenProfile::max_out_array_count},
+    {"min_inp_ptr_count", &GenProfile::min_inp_ptr_count},
+    {"max_inp_ptr_count", &GenProfile::max_inp_ptr_count},
+    {"min_mix_ptr_count", &GenProfile::min_mix_ptr_count},
+    {"max_mix_ptr_count", &GenProfile::max_mix_ptr_count},
+    {"min_out_ptr_count", &GenProfile::min_out_ptr_count},
+    {"max_out_ptr_count", &GenProfile::max_out_ptr_count},
+};
 
-std::shared_ptr<RandValGen> oorgen::rand_val_gen;
+// Knobs with non-default range of values. All other knobs are copied to uint32_t fields of GenPolicy,
+// so they are limited by UINT32_MAX. Arrays, scopes and structs can't be empty. Sum of weights should fit
+// into int (see RandValGen::shuffle_prob).
+static const std::map<std::string, std::pair<uint64_t, uint64_t>> knob_ranges = {
+    {"max_test_complexity", {0, UINT64_MAX}},
+    {"max_arith_node_count", {1, UINT32_MAX}},
+    {"arith_data_weight", {0, 10000}},
+    {"arith_unary_weight", {0, 10000}},
+    {"arith_binary_weight", {0, 10000}},
+    {"arith_conditional_weight", {0, 10000}},
+    {"arith_type_cast_weight", {0, 10000}},
+    {"arith_cse_weight", {0, 10000}},
+    {"disable_arrays", {0, UINT64_MAX}},
+    {"min_scope_stmt_count", {1, UINT32_MAX}},
+    {"max_scope_stmt_count", {1, UINT32_MAX}},
+    {"min_struct_member_count", {1, UINT32_MAX}},
+    {"max_struct_member_count", {1, UINT32_MAX}},
+    {"min_array_size", {1, UINT32_MAX}},
+    {"max_array_size", {1, UINT32_MAX}},
+};
 
-RandValGen::RandValGen (uint64_t _seed) {
-    if (_seed != 0) {
-        seed = _seed;
-    }
-    else {
-        std::random_device rd;
-        seed = rd ();
-    }
-    std::cout << "/*SEED " << options->plane_oorgen_version << "_" << seed << "*/" << std::endl;
-    rand_gen = std::mt19937_64(seed);
+// Smaller tests, which are cheap to compile
+static GenProfile make_fast_compile_profile () {
+    GenProfile ret;
+    ret.test_func_count = 2;
+    ret.max_arith_depth = 3;
+    ret.min_scope_stmt_count = 2;
+    ret.max_scope_stmt_count = 5;
+    ret.max_total_stmt_count = 1000;
+    ret.max_func_stmt_count = 200;
+    ret.min_inp_var_count = ret.min_mix_var_count = 10;
+    ret.max_inp_var_count = ret.max_mix_var_count = 30;
+    ret.max_if_depth = 2;
+    ret.max_struct_types_count = 3;
+    ret.max_inp_struct_count = ret.max_mix_struct_count = 3;
+    ret.max_out_struct_count = 4;
+    ret.max_struct_member_count = 6;
+    ret.max_struct_depth = 3;
+    ret.max_array_size = 6;
+    ret.max_array_types_count = 3;
+    ret.max_inp_array_count = ret.max_mix_array_count = 3;
+    ret.max_out_array_count = 4;
+    ret.max_inp_ptr_count = ret.max_mix_ptr_count = ret.max_out_ptr_count = 5;
+    return ret;
 }
 
-const std::string NameHandler::common_test_func_prefix = "tf_";
-
-///////////////////////////////////////////////////////////////////////////////
-
-bool GenPolicy::default_was_loaded = false;
-GenPolicy oorgen::default_gen_policy;
-
-GenPolicy::GenPolicy () {
-    if (default_was_loaded)
-        *this = default_gen_policy;
+// Big tests with deep nesting
+static GenProfile make_stress_profile () {
+    GenProfile ret;
+    ret.test_func_count = 8;
+    ret.max_arith_depth = 7;
+    // Nested common subexpressions make huge expressions, which are kept on purpose
+    ret.max_arith_node_count = UINT32_MAX;
+    ret.min_scope_stmt_count = 6;
+    ret.max_scope_stmt_count = 12;
+    ret.max_total_stmt_count = 10000;
+    ret.max_func_stmt_count = 2000;
+    ret.min_inp_var_count = ret.min_mix_var_count = 40;
+    ret.max_inp_var_count = ret.max_mix_var_count = 120;
+    ret.max_cse_count = 10;
+    ret.max_if_depth = 4;
+    ret.max_struct_types_count = 10;
+    ret.max_inp_struct_count = ret.max_mix_struct_count = 10;
+    ret.max_out_struct_count = 12;
+    ret.max_struct_member_count = 16;
+    ret.max_struct_depth = 7;
+    ret.max_array_size = 20;
+    ret.max_array_types_count = 10;
+    ret.max_inp_array_count = ret.max_mix_array_count = 10;
+    ret.max_out_array_count = 12;
+    ret.max_inp_ptr_count = ret.max_mix_ptr_count = ret.max_out_ptr_count = 20;
+    return ret;
 }
 
-void GenPolicy::init_from_config () {
-    test_func_count = TEST_FUNC_COUNT;
-
-    num_of_allowed_int_types = MAX_ALLOWED_INT_TYPES;
-    rand_init_allowed_int_types();
+const std::map<std::string, GenProfile> GenProfile::presets = {
+    {"fast-compile", make_fast_compile_profile()},
+    {"balanced", GenProfile()},
+    {"stress", make_stress_profile()},
+};
 
-    allowed_cv_qual.push_back (Type::CV_Qual::NTHG);
+static std::string trim (const std::string& str) {
+    size_t first = str.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+        return "";
+    size_t last = str.find_last_not_of(" \t\r");
+    return str.substr(first, last - first + 1);
+}
 
-    allow_static_var = false;
-    if (options->is_c())
-        allow_static_members = false;
-    else if (options->is_cxx())
-        allow_static_members = true;
-    else {
-        std::cerr << "ERROR at " << __FILE__ << ":" << __LINE__ << ": can't detect language subset" << std::endl;
-        exit(-1);
-    }
+GenProfile GenProfile::load (std::string name) {
+    auto preset = presets.find(name);
+    if (preset != presets.end())
+        return preset->second;
+
+    std::ifstream file (name);
+    if (!file.is_open())
+        ERROR("can't find preset or open profile file " + name);
+
+    GenProfile ret;
+    std::string line;
+    uint32_t line_num = 0;
+    while (std::getline(file, line)) {
+        ++line_num;
+        std::string where = name + ":" + std::to_string(line_num);
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
 
-    allow_struct = true;
-    min_struct_type_count = MIN_STRUCT_TYPES_COUNT;
-    max_struct_type_count = MAX_STRUCT_TYPES_COUNT;
-    min_inp_struct_count = MIN_INP_STRUCT_COUNT;
-    max_inp_struct_count = MAX_INP_STRUCT_COUNT;
-    min_mix_struct_count = MIN_MIX_STRUCT_COUNT;
-    max_mix_struct_count = MAX_MIX_STRUCT_COUNT;
-    min_out_struct_count = MIN_OUT_STRUCT_COUNT;
-    max_out_struct_count = MAX_OUT_STRUCT_COUNT;
-    min_struct_member_count = MIN_STRUCT_MEMBER_COUNT;
-    max_struct_member_count = MAX_STRUCT_MEMBER_COUNT;
-    allow_mix_cv_qual_in_struct = false;
-    allow_mix_static_in_struct = true;
-    allow_mix_types_in_struct = true;
-    member_use_prob.push_back(Probability<bool>(true, 80));
-    member_use_prob.push_back(Probability<bool>(false, 20));
-    rand_val_gen->shuffle_prob(member_use_prob);
-    max_struct_depth = MAX_STRUCT_DEPTH;
-    member_class_prob.push_back(Probability<Data::VarClassID>(Data::VarClassID::VAR, 70));
-    member_class_prob.push_back(Probability<Data::VarClassID>(Data::VarClassID::STRUCT, 30));
-    rand_val_gen->shuffle_prob(member_class_prob);
-    min_bit_field_size = MIN_BIT_FIELD_SIZE;
-    max_bit_field_size = MAX_BIT_FIELD_SIZE;
-    bit_field_prob.push_back(Probability<BitFieldID>(UNNAMED, 15));
-    bit_field_prob.push_back(Probability<BitFieldID>(NAMED, 20));
-    bit_field_prob.push_back(Probability<BitFieldID>(MAX_BIT_FIELD_ID, 65));
-    rand_val_gen->shuffle_prob(bit_field_prob);
-
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(VAR, 50));
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(MEMBER, 25));
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(VAR_IN_ARRAY, 15));
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(MEMBER_IN_ARRAY, 10));
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(DEREFERENCE, 10));
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(POINTER, 10));
-    rand_val_gen->shuffle_prob(out_data_type_prob);
-
-    out_data_category_prob.emplace_back(Probability<OutDataCategoryID>(MIX, 50));
-    out_data_category_prob.emplace_back(Probability<OutDataCategoryID>(OUT, 50));
-    rand_val_gen->shuffle_prob(out_data_category_prob);
-
-    min_array_size = MIN_ARRAY_SIZE;
-    max_array_size = MAX_ARRAY_SIZE;
-    array_base_type_prob.emplace_back(Probability<Type::TypeID>(Type::BUILTIN_TYPE, 60));
-    array_base_type_prob.emplace_back(Probability<Type::TypeID>(Type::STRUCT_TYPE, 40));
-    rand_val_gen->shuffle_prob(array_base_type_prob);
-    array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::C_ARR, 40));
-    if (options->is_cxx()) {
-        array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::VAL_ARR, 15));
-        if (options->standard_id >= Options::CXX11) {
-            array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::STD_ARR, 15));
-            array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::STD_VEC, 15));
+        size_t eq_pos = line.find('=');
+        if (eq_pos == std::string::npos)
+            ERROR("expected \"knob = value\" at " + where);
+        std::string key = trim(line.substr(0, eq_pos));
+        std::string value = trim(line.substr(eq_pos + 1));
+
+        if (key == "preset") {
+            auto new_preset = presets.find(value);
+            if (new_preset == presets.end())
+                ERROR("unknown preset " + value + " at " + where);
+            ret = new_preset->second;
+            continue;
         }
-    }
-    rand_val_gen->shuffle_prob(array_kind_prob);
-    array_elem_subs_prob.emplace_back(Probability<ArrayType::ElementSubscript>(ArrayType::Brackets, 50));
-    array_elem_subs_prob.emplace_back(Probability<ArrayType::ElementSubscript>(ArrayType::At, 50));
-    rand_val_gen->shuffle_prob(array_elem_subs_prob);
-    min_array_type_count = MIN_ARRAY_TYPES_COUNT;
-    max_array_type_count = MAX_ARRAY_TYPES_COUNT;
-    min_inp_array_count = MIN_INP_ARRAY_COUNT;
-    max_inp_array_count = MAX_INP_ARRAY_COUNT;
-    min_mix_array_count = MIN_MIX_ARRAY_COUNT;
-    max_mix_array_count = MAX_MIX_ARRAY_COUNT;
-    min_out_array_count = MIN_OUT_ARRAY_COUNT;
-    max_out_array_count = MAX_OUT_ARRAY_COUNT;
-    if (DISABLE_ARRAYS) {
-        min_array_type_count = max_array_type_count = 0;
-        min_inp_array_count = max_inp_array_count = 0;
-        min_mix_array_count = max_mix_array_count = 0;
-        min_out_array_count = max_out_array_count = 0;
-    }
-
-    min_inp_ptr_count = MIN_INP_PTR_COUNT;
-    max_inp_ptr_count = MAX_INP_PTR_COUNT;
-    min_mix_ptr_count = MIN_MIX_PTR_COUNT;
-    max_mix_ptr_count = MAX_MIX_PTR_COUNT;
-    min_out_ptr_count = MIN_OUT_PTR_COUNT;
-    max_out_ptr_count = MAX_OUT_PTR_COUNT;
-
-    max_arith_depth = MAX_ARITH_DEPTH;
-    max_total_expr_count = MAX_TOTAL_EXPR_COUNT;
-    max_func_expr_count = MAX_FUNC_EXPR_COUNT;
-
-    min_scope_stmt_count = MIN_SCOPE_STMT_COUNT;
-    max_scope_stmt_count = MAX_SCOPE_STMT_COUNT;
-
-    max_total_stmt_count = MAX_TOTAL_STMT_COUNT;
-    max_func_stmt_count = MAX_FUNC_STMT_COUNT;
-
-    min_inp_var_count = MIN_INP_VAR_COUNT;
-    max_inp_var_count = MAX_INP_VAR_COUNT;
-    min_mix_var_count = MIN_MIX_VAR_COUNT;
-    max_mix_var_count = MAX_MIX_VAR_COUNT;
-
-    max_cse_count = MAX_CSE_COUNT;
 
-    for (int i = UnaryExpr::Op::Plus; i < UnaryExpr::Op::MaxOp; ++i) {
-        Probability<UnaryExpr::Op> prob ((UnaryExpr::Op) i, 10);
-        allowed_unary_op.push_back (prob);
+        auto knob = knobs.find(key);
+        if (knob == knobs.end())
+            ERROR("unknown knob " + key + " at " + where);
+        size_t parsed_len = 0;
+        try {
+            ret.*(knob->second) = std::stoull(value, &parsed_len, 10);
+        }
+        catch (std::exception& e) {
+            parsed_len = 0;
+        }
+        if (parsed_len == 0 || parsed_len != value.size())
+            ERROR("bad value " + value + " of knob " + key + " at " + where);
+
+        auto range = knob_ranges.find(key);
+        uint64_t min_value = range != knob_ranges.end() ? range->second.first : 0;
+        uint64_t max_value = range != knob_ranges.end() ? range->second.second : UINT32_MAX;
+        if (ret.*(knob->second) < min_value || ret.*(knob->second) > max_value)
+            ERROR("value " + value + " of knob " + key + " is out of range [" + std::to_string(min_value) + ", " +
+                  std::to_string(max_value) + "] at " + where);
     }
-    rand_val_gen->shuffle_prob(allowed_unary_op);
 
-    for (int i = 0; i < BinaryExpr::Op::MaxOp; ++i) {
-        Probability<BinaryExpr::Op> prob ((BinaryExpr::Op) i, 10);
-        allowed_binary_op.push_back (prob);
+    for (const auto& knob : knobs) {
+        // max_bit_field_size is unused, so it isn't checked
+        if (knob.first.compare(0, 4, "min_") != 0 || knob.first == "min_bit_field_size")
+            continue;
+        auto max_knob = knobs.find("max_" + knob.first.substr(4));
+        if (max_knob != knobs.end() && ret.*(knob.second) > ret.*(max_knob->second))
+            ERROR("knob " + knob.first + " exceeds " + max_knob->first + " in profile " + name);
     }
-    rand_val_gen->shuffle_prob(allowed_binary_op);
-
-    Probability<Node::NodeID> decl_gen (Node::NodeID::DECL, 10);
-    stmt_gen_prob.push_back (decl_gen);
-    Probability<Node::NodeID> assign_gen (Node::NodeID::EXPR, 10);
-    stmt_gen_prob.push_back (assign_gen);
-    Probability<Node::NodeID> if_gen (Node::NodeID::IF, 10);
-    stmt_gen_prob.push_back (if_gen);
-    rand_val_gen->shuffle_prob(stmt_gen_prob);
-
-    Probability<ArithLeafID> data_leaf (ArithLeafID::Data, 11);
-    arith_leaves.push_back (data_leaf);
-    Probability<ArithLeafID> unary_leaf (ArithLeafID::Unary, 21);
-    arith_leaves.push_back (unary_leaf);
-    Probability<ArithLeafID> binary_leaf (ArithLeafID::Binary, 46);
-    arith_leaves.push_back (binary_leaf);
-    Probability<ArithLeafID> cond_leaf (ArithLeafID::Conditional, 3);
-    arith_leaves.push_back (cond_leaf);
-    Probability<ArithLeafID> type_cast_leaf (ArithLeafID::TypeCast, 11);
-    arith_leaves.push_back (type_cast_leaf);
-    Probability<ArithLeafID> cse_leaf (ArithLeafID::CSE, 8);
-    arith_leaves.push_back (cse_leaf);
-    rand_val_gen->shuffle_prob(arith_leaves);
-
-    Probability<ArithDataID> inp_data (ArithDataID::Inp, 80);
-    arith_data_distr.push_back (inp_data);
-    Probability<ArithDataID> const_data (ArithDataID::Const, 20);
-    arith_data_distr.push_back (const_data);
-    rand_val_gen->shuffle_prob(arith_data_distr);
-
-    Probability<ArithCSEGenID> add_cse (ArithCSEGenID::Add, 20);
-    arith_cse_gen.push_back (add_cse);
-    Probability<ArithCSEGenID> max_cse_gen (ArithCSEGenID::MAX_CSE_GEN_ID, 80);
-    arith_cse_gen.push_back (max_cse_gen);
-    rand_val_gen->shuffle_prob(arith_cse_gen);
-
-    Probability<ArithSSP::ConstUse> const_branch (ArithSSP::ConstUse::CONST_BRANCH, 5);
-    allowed_arith_ssp_const_use.push_back(const_branch);
-    Probability<ArithSSP::ConstUse> half_const (ArithSSP::ConstUse::HALF_CONST, 5);
-    allowed_arith_ssp_const_use.push_back(half_const);
-    Probability<ArithSSP::ConstUse> no_ssp_const_use (ArithSSP::ConstUse::MAX_CONST_USE, 90);
-    allowed_arith_ssp_const_use.push_back(no_ssp_const_use);
-    rand_val_gen->shuffle_prob(allowed_arith_ssp_const_use);
-
-    chosen_arith_ssp_const_use = ArithSSP::ConstUse::MAX_CONST_USE;
-
-    Probability<ArithSSP::SimilarOp> additive (ArithSSP::SimilarOp::ADDITIVE, 5);
-    allowed_arith_ssp_similar_op.push_back(additive);
-    Probability<ArithSSP::SimilarOp> bitwise (ArithSSP::SimilarOp::BITWISE, 5);
-    allowed_arith_ssp_similar_op.push_back(bitwise);
-    Probability<ArithSSP::SimilarOp> logic (ArithSSP::SimilarOp::LOGIC, 5);
-    allowed_arith_ssp_similar_op.push_back(logic);
-    Probability<ArithSSP::SimilarOp> mul (ArithSSP::SimilarOp::MUL, 5);
-    allowed_arith_ssp_similar_op.push_back(mul);
-    Probability<ArithSSP::SimilarOp> bit_sh (ArithSSP::SimilarOp::BIT_SH, 5);
-    allowed_arith_ssp_similar_op.push_back(bit_sh);
-    Probability<ArithSSP::SimilarOp> add_mul (ArithSSP::SimilarOp::ADD_MUL, 5);
-    allowed_arith_ssp_similar_op.push_back(add_mul);
-    Probability<ArithSSP::SimilarOp> no_ssp_similar_op (ArithSSP::SimilarOp::MAX_SIMILAR_OP, 70);
-    allowed_arith_ssp_similar_op.push_back(no_ssp_similar_op);
-    rand_val_gen->shuffle_prob(allowed_arith_ssp_similar_op);
-
-    chosen_arith_ssp_similar_op = ArithSSP::SimilarOp::MAX_SIMILAR_OP;
-
-    const_buffer_size = CONST_BUFFER_SIZE;
-    new_const_prob.emplace_back(Probability<bool>(true, 50));
-    new_const_prob.emplace_back(Probability<bool>(false, 50));
-    rand_val_gen->shuffle_prob(new_const_prob);
-    new_const_type_prob.emplace_back(Probability<bool>(true, 50));
-    new_const_type_prob.emplace_back(Probability<bool>(false, 50));
-    rand_val_gen->shuffle_prob(new_const_type_prob);
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Zero, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::One, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Two, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Three, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Four, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Eight, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Sixteen, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::MAX_SPECIAL_CONST, 10));
-    rand_val_gen->shuffle_prob(special_const_prob);
-    new_const_kind_prob.emplace_back(Probability<ConstPattern::NewConstKind>(ConstPattern::EndBits, 25));
-    new_const_kind_prob.emplace_back(Probability<ConstPattern::NewConstKind>(ConstPattern::BitBlock, 25));
-    new_const_kind_prob.emplace_back(Probability<ConstPattern::NewConstKind>(ConstPattern::MAX_NEW_CONST_KIND, 50));
-    rand_val_gen->shuffle_prob(new_const_kind_prob);
-    const_transform_prob.emplace_back(Probability<UnaryExpr::Op>(UnaryExpr::Op::Negate, 33));
-    const_transform_prob.emplace_back(Probability<UnaryExpr::Op>(UnaryExpr::Op::BitNot, 33));
-    const_transform_prob.emplace_back(Probability<UnaryExpr::Op>(UnaryExpr::Op::Plus, 33));
-    rand_val_gen->shuffle_prob(const_transform_prob);
-
-    Probability<bool> else_exist (true, 50);
-    else_prob.push_back(else_exist);
-    Probability<bool> no_else (false, 50);
-    else_prob.push_back(no_else);
-    rand_val_gen->shuffle_prob(else_prob);
-
-    max_if_depth = MAX_IF_DEPTH;
-
-    decl_stmt_gen_id_prob.emplace_back(Probability<GenPolicy::DeclStmtGenID>(GenPolicy::DeclStmtGenID::Variable, 80));
-    decl_stmt_gen_id_prob.emplace_back(Probability<GenPolicy::DeclStmtGenID>(GenPolicy::DeclStmtGenID::Pointer, 20));
-    rand_val_gen->shuffle_prob(decl_stmt_gen_id_prob);
-
-    max_test_complexity = MAX_TEST_COMPLEXITY;
-
-    default_was_loaded = true;
-}
-
-void GenPolicy::copy_data (std::shared_ptr<GenPolicy> old) {
-    cse = old->get_cse();
+    if (ret.arith_data_weight + ret.arith_unary_weight + ret.arith_binary_weight + ret.arith_conditional_weight +
+        ret.arith_type_cast_weight + ret.arith_cse_weight == 0)
+        ERROR("all weights of arithmetic nodes are zero in profile " + name);
+    return ret;
 }
 
-GenPolicy GenPolicy::apply_arith_ssp_const_use (ArithSSP::ConstUse pattern_id) {
-    chosen_arith_ssp_const_use = pattern_id;
-    GenPolicy new_policy = *this;
-    if (pattern_id == ArithSSP::ConstUse::CONST_BRANCH) {
-        new_policy.arith_data_distr.clear();
-        Probability<ArithDataID> const_data (ArithDataID::Const, 100);
-        new_policy.arith_data_distr.push_back (const_data);
-    }
-    else if (pattern_id == ArithSSP::ConstUse::HALF_CONST) {
-        new_policy.arith_data_distr.clear();
-        Probability<ArithDataID> inp_data (ArithDataID::Inp, 50);
-        new_policy.arith_data_distr.push_back (inp_data);
-        Probability<ArithDataID> const_data (ArithDataID::Const, 50);
-        new_policy.arith_data_distr.push_back (const_data);
-    }
-    return new_policy;
+void GenProfile::dump (std::ostream& stream) {
+    for (const auto& knob : knobs)
+        stream << knob.first << " = " << this->*(knob.second) << std::endl;
 }
 
-GenPolicy GenPolicy::apply_arith_ssp_similar_op (ArithSSP::SimilarOp pattern_id) {
-    chosen_arith_ssp_similar_op = pattern_id;
-    GenPolicy new_policy = *this;
-    if (pattern_id == ArithSSP::SimilarOp::ADDITIVE || pattern_id == ArithSSP::SimilarOp::ADD_MUL) {
-        new_policy.allowed_unary_op.clear();
-        // TODO: add default probability to gen_policy;
-        Probability<UnaryExpr::Op> plus (UnaryExpr::Op::Plus, 50);
-        new_policy.allowed_unary_op.push_back (plus);
-        Probability<UnaryExpr::Op> negate (UnaryExpr::Op::Negate, 50);
-        new_policy.allowed_unary_op.push_back (negate);
-
-        new_policy.allowed_binary_op.clear();
-        // TODO: add default probability to gen_policy;
-        Probability<BinaryExpr::Op> add (BinaryExpr::Op::Add, 33);
-        new_policy.allowed_binary_op.push_back (add);
-        Probability<BinaryExpr::Op> sub (BinaryExpr::Op::Sub, 33);
-        new_policy.allowed_binary_op.push_back (sub);
+// Solves least squares problem x * coeffs = y with normal equations. Returns false, if it is degenerate.
+static bool solve_least_squares (const std::vector<std::vector<double>>& x, const std::vector<double>& y,
+                                 std::vector<double>& coeffs) {
+    size_t n = x.front().size();
+    // Augmented matrix of normal equations
+    std::vector<std::vector<double>> a (n, std::vector<double>(n + 1, 0));
+    for (size_t row = 0; row < x.size(); ++row)
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n; ++j)
+                a[i][j] += x[row][i] * x[row][j];
+            a[i][n] += x[row][i] * y[row];
+        }
 
-        if (pattern_id == ArithSSP::SimilarOp::ADD_MUL) {
-            Probability<BinaryExpr::Op> mul (BinaryExpr::Op::Mul, 33);
-            new_policy.allowed_binary_op.push_back (mul);
+    // Gaussian elimination with partial pivoting
+    for (size_t col = 0; col < n; ++col) {
+        size_t pivot = col;
+        for (size_t i = col + 1; i < n; ++i)
+            if (std::fabs(a[i][col]) > std::fabs(a[pivot][col]))
+                pivot = i;
+        if (std::fabs(a[pivot][col]) < 1e-12)
+            return false;
+        std::swap(a[col], a[pivot]);
+        for (size_t i = 0; i < n; ++i) {
+            if (i == col)
+                continue;
+            double factor = a[i][col] / a[col][col];
+            for (size_t j = col; j <= n; ++j)
+                a[i][j] -= factor * a[col][j];
         }
     }
-    else if (pattern_id == ArithSSP::SimilarOp::BITWISE || pattern_id == ArithSSP::SimilarOp::BIT_SH) {
-        new_policy.allowed_unary_op.clear();
-        Probability<UnaryExpr::Op> bit_not (UnaryExpr::Op::BitNot, 100);
-        new_policy.allowed_unary_op.push_back (bit_not);
+    coeffs.resize(n);
+    for (size_t i = 0; i < n; ++i)
+        coeffs[i] = a[i][n] / a[i][i];
+    return true;
+}
 
-        new_policy.allowed_binary_op.clear();
-        Probability<BinaryExpr::Op> bit_and (BinaryExpr::Op::BitAnd, 20);
-        new_policy.allowed_binary_op.push_back (bit_and);
-        Probability<BinaryExpr::Op> bit_xor (BinaryExpr::Op::BitXor, 20);
-        new_policy.allowed_binary_op.push_back (bit_xor);
-        Probability<BinaryExpr::Op> bit_or (BinaryExpr::Op::BitOr, 20);
-        new_policy.allowed_binary_op.push_back (bit_or);
+// Knobs, which shape the statement tree, and complexity of the run, which was generated with them
+struct ScopeRun {
+    double mean_scope_stmt_count;
+    double max_if_depth;
+    double complexity;
+};
 
-        if (pattern_id == ArithSSP::SimilarOp::BIT_SH) {
-            Probability<BinaryExpr::Op> shl (BinaryExpr::Op::Shl, 20);
-            new_policy.allowed_binary_op.push_back (shl);
-            Probability<BinaryExpr::Op> shr (BinaryExpr::Op::Shr, 20);
-            new_policy.allowed_binary_op.push_back (shr);
-        }
+// Fits log(complexity) = a + b * log(mean_scope_stmt_count) + c * max_if_depth to the runs,
+// where mean_scope_stmt_count = (min_scope_stmt_count + max_scope_stmt_count) / 2.
+// Then it chooses knobs, which give the target complexity. Depth of nested if statements is taken from
+// the range of the runs, and the mean statement count is changed as little as possible.
+// The ratio of min_scope_stmt_count to max_scope_stmt_count is preserved.
+// Knobs, which are the same in all runs, can't be fitted, so they are kept.
+static void fit_scope_knobs (GenProfile& profile, const std::vector<ScopeRun>& runs, double target_complexity,
+                             std::ostream& report) {
+    if (runs.empty()) {
+        report << "# Scope knobs are kept: run log doesn't record them" << std::endl;
+        return;
+    }
+    double min_depth = runs.front().max_if_depth;
+    double max_depth = min_depth;
+    double min_mean = runs.front().mean_scope_stmt_count;
+    double max_mean = min_mean;
+    for (const auto& run : runs) {
+        min_depth = std::min(min_depth, run.max_if_depth);
+        max_depth = std::max(max_depth, run.max_if_depth);
+        min_mean = std::min(min_mean, run.mean_scope_stmt_count);
+        max_mean = std::max(max_mean, run.mean_scope_stmt_count);
+    }
+    bool fit_mean = max_mean > min_mean;
+    bool fit_depth = max_depth > min_depth;
+    if (!fit_mean && !fit_depth) {
+        report << "# Scope knobs are kept: they are the same in all runs" << std::endl;
+        return;
     }
-    else if (pattern_id == ArithSSP::SimilarOp::LOGIC) {
-        new_policy.allowed_unary_op.clear();
-        Probability<UnaryExpr::Op> log_not (UnaryExpr::Op::LogNot, 100);
-        new_policy.allowed_unary_op.push_back (log_not);
 
-        new_policy.allowed_binary_op.clear();
-        Probability<BinaryExpr::Op> log_and (BinaryExpr::Op::LogAnd, 50);
-        new_policy.allowed_binary_op.push_back (log_and);
-        Probability<BinaryExpr::Op> log_or (BinaryExpr::Op::LogOr, 50);
-        new_policy.allowed_binary_op.push_back (log_or);
+    std::vector<std::vector<double>> x;
+    std::vector<double> y;
+    for (const auto& run : runs) {
+        std::vector<double> row = {1};
+        if (fit_mean)
+            row.push_back(std::log(run.mean_scope_stmt_count));
+        if (fit_depth)
+            row.push_back(run.max_if_depth);
+        x.push_back(row);
+        y.push_back(std::log(run.complexity));
     }
-    else if (pattern_id == ArithSSP::SimilarOp::MUL) {
-        // TODO: what about unary expr?
-        new_policy.allowed_binary_op.clear();
-        Probability<BinaryExpr::Op> mul (BinaryExpr::Op::Mul, 100);
-        new_policy.allowed_binary_op.push_back (mul);
+    std::vector<double> coeffs;
+    if (!solve_least_squares(x, y, coeffs)) {
+        report << "# Scope knobs are kept: runs don't determine their influence" << std::endl;
+        return;
+    }
+    double mean_coeff = fit_mean ? coeffs.at(1) : 0;
+    double depth_coeff = fit_depth ? coeffs.back() : 0;
+    report << "# log(complexity): " << coeffs.front() << " + " << mean_coeff << " * log(mean scope stmt count) + " <<
+              depth_coeff << " * max if depth" << std::endl;
+    if ((fit_mean && mean_coeff <= 0) || (fit_depth && depth_coeff <= 0)) {
+        report << "# Scope knobs are kept: complexity doesn't grow with them" << std::endl;
+        return;
     }
-    return new_policy;
-}
 
-void GenPolicy::rand_init_allowed_int_types () {
-    allowed_int_types.clear ();
-    std::vector<IntegerType::IntegerTypeID> tmp_allowed_int_types;
-    uint32_t gen_types = 0;
-    while (gen_types < num_of_allowed_int_types) {
-        auto type = (IntegerType::IntegerTypeID) rand_val_gen->get_rand_value(0, IntegerType::IntegerTypeID::MAX_INT_ID - 1);
-        if (type == IntegerType::IntegerTypeID::BOOL && options->is_c())
-            continue;
-        if (std::find(tmp_allowed_int_types.begin(), tmp_allowed_int_types.end(), type) == tmp_allowed_int_types.end()) {
-            tmp_allowed_int_types.push_back (type);
-            gen_types++;
+    double base_mean = (profile.min_scope_stmt_count + profile.max_scope_stmt_count) / 2.0;
+    double best_mean = base_mean;
+    uint64_t best_depth = profile.max_if_depth;
+    double best_score = std::numeric_limits<double>::max();
+    uint64_t first_depth = fit_depth ? std::llround(min_depth) : profile.max_if_depth;
+    uint64_t last_depth = fit_depth ? std::llround(max_depth) : profile.max_if_depth;
+    for (uint64_t depth = first_depth; depth <= last_depth; ++depth) {
+        double log_rest = std::log(target_complexity) - coeffs.front() - depth_coeff * depth;
+        double mean = fit_mean ? std::exp(log_rest / mean_coeff) : base_mean;
+        // Without the mean, the depth itself should give the target complexity
+        double score = fit_mean ? std::fabs(std::log(std::max(mean, 1.0) / base_mean)) + (mean < 1 ? 1 - mean : 0) :
+                                  std::fabs(log_rest - mean_coeff * std::log(base_mean));
+        if (score < best_score) {
+            best_score = score;
+            best_mean = std::max(mean, 1.0);
+            best_depth = depth;
         }
     }
-    for (auto i : tmp_allowed_int_types) {
-        Probability<IntegerType::IntegerTypeID> prob (i, 1);
-        allowed_int_types.push_back (prob);
-    }
-}
 
-void GenPolicy::set_cv_qual(bool value, Type::CV_Qual cv_qual) {
-    if (value)
-        allowed_cv_qual.push_back (cv_qual);
-    else
-        allowed_cv_qual.erase (std::remove (allowed_cv_qual.begin(), allowed_cv_qual.end(), cv_qual), allowed_cv_qual.end());
+    double ratio = profile.max_scope_stmt_count > 0 ?
+                   (double) profile.min_scope_stmt_count / profile.max_scope_stmt_count : 1;
+    profile.max_scope_stmt_count = std::max<uint64_t>(1, std::llround(2 * best_mean / (1 + ratio)));
+    uint64_t min_scope_stmt_count = std::max<uint64_t>(1, std::llround(profile.max_scope_stmt_count * ratio));
+    profile.min_scope_stmt_count = std::min<uint64_t>(profile.max_scope_stmt_count, min_scope_stmt_count);
+    profile.max_if_depth = best_depth;
 }
-/*
-Copyright (c) 2015-2017, Intel Corporation
-
-Licensed under the Apache License, Version 2.0 (the "License");
-you may not use this file except in compliance with the License.
-You may obtain a copy of the License at
-
-     http://www.apache.org/licenses/LICENSE-2.0
 
-Unless required by applicable law or agreed to in writing, software
-distributed under the License is distributed on an "AS IS" BASIS,
-WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
-See the License for the specific language governing permissions and
-limitations under the License.
-*/
+GenProfile GenProfile::autotune (GenProfile base, std::string log_file,
+                                 double target_compile_time, double target_run_time,
+                                 std::ostream& report) {
+    std::ifstream file (log_file);
+    if (!file.is_open())
+        ERROR("can't open run log " + log_file);
+
+    // Least squares fit of time = base + coeff * complexity
+    double compl_sum = 0;
+    double compl_sqr_sum = 0;
+    double compile_sum = 0;
+    double compile_compl_sum = 0;
+    double run_sum = 0;
+    double run_compl_sum = 0;
+    uint32_t run_count = 0;
+    std::vector<ScopeRun> scope_runs;
+
+    std::string line;
+    uint32_t line_num = 0;
+    while (std::getline(file, line)) {
+        ++line_num;
+        std::string where = log_file + ":" + std::to_string(line_num);
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
 
-//////////////////////////////////////////////////////////////////////////////
-#include <map>
+        std::map<std::string, std::string> record;
+        std::stringstream line_ss (line);
+        std::string token;
+        while (line_ss >> token) {
+            size_t eq_pos = token.find('=');
+            if (eq_pos == std::string::npos)
+                ERROR("expected \"key=value\" at " + where);
+            record[token.substr(0, eq_pos)] = token.substr(eq_pos + 1);
+        }
 
-#include "gen_policy.h"
+        double values [3];
+        const char* required [3] = {"complexity", "compile_time", "run_time"};
+        for (int i = 0; i < 3; ++i) {
+            auto value = record.find(required[i]);
+            if (value == record.end())
+                ERROR("missing " + std::string(required[i]) + " at " + where);
+            try {
+                values[i] = std::stod(value->second);
+            }
+            catch (std::exception& e) {
+                ERROR("bad value " + value->second + " of " + required[i] + " at " + where);
+            }
+        }
+        if (values[0] <= 0)
+            continue;
+        compl_sum += values[0];
+        compl_sqr_sum += values[0] * values[0];
+        compile_sum += values[1];
+        compile_compl_sum += values[1] * values[0];
+        run_sum += values[2];
+        run_compl_sum += values[2] * values[0];
+        run_count++;
+
+        // Runs, which were cut by complexity budget, don't show the influence of scope knobs
+        std::map<std::string, double> knob_values;
+        for (std::string knob : {"min_scope_stmt_count", "max_scope_stmt_count", "max_if_depth", "max_test_complexity"}) {
+            auto value = record.find(knob);
+            if (value == record.end())
+                break;
+            try {
+                knob_values[knob] = std::stod(value->second);
+            }
+            catch (std::exception& e) {
+                ERROR("bad value " + value->second + " of " + knob + " at " + where);
+            }
+        }
+        if (knob_values.size() == 4 && values[0] < 0.95 * knob_values["max_test_complexity"] &&
+            knob_values["max_scope_stmt_count"] > 0)
+            scope_runs.push_back({(knob_values["min_scope_stmt_count"] + knob_values["max_scope_stmt_count"]) / 2,
+                                  knob_values["max_if_depth"], values[0]});
+    }
+    if (run_count == 0)
+        ERROR("run log " + log_file + " doesn't contain any runs");
+
+    double mean_complexity = compl_sum / run_count;
+    double compl_var = compl_sqr_sum / run_count - mean_complexity * mean_complexity;
+    // Returns complexity, which corresponds to the target time, according to the fitted line
+    auto fit = [&] (double time_sum, double time_compl_sum, double target_time, std::string name) -> double {
+        double mean_time = time_sum / run_count;
+        double coeff = 0;
+        double base_time = 0;
+        // All runs have (almost) the same complexity, so the line goes through the origin
+        if (compl_var <= mean_complexity * mean_complexity * 1e-9)
+            coeff = time_compl_sum / compl_sqr_sum;
+        else {
+            coeff = (time_compl_sum / run_count - mean_time * mean_complexity) / compl_var;
+            base_time = mean_time - coeff * mean_complexity;
+        }
+        report << "# " << name << " time: " << base_time << " s + " << coeff << " s per complexity unit" << std::endl;
+        if (coeff <= 0)
+            ERROR(name + " time doesn't grow with complexity in run log " + log_file);
+        if (target_time <= base_time)
+            ERROR("target " + name + " time is less than fitted time of empty test");
+        return (target_time - base_time) / coeff;
+    };
+
+    report << "# Tuned with " << run_count << " runs from " << log_file << std::endl;
+    double target_complexity = std::numeric_limits<double>::max();
+    if (target_compile_time > 0)
+        target_complexity = std::min(target_complexity, fit(compile_sum, compile_compl_sum, target_compile_time, "compile"));
+    if (target_run_time > 0)
+        target_complexity = std::min(target_complexity, fit(run_sum, run_compl_sum, target_run_time, "run"));
+    if (target_complexity == std::numeric_limits<double>::max())
+        ERROR("can't fit profile without target compile or run time");
+
+    double ratio = target_complexity / mean_complexity;
+    auto scale = [ratio] (uint64_t value) -> uint64_t {
+        return std::max<uint64_t>(1, std::llround(value * ratio));
+    };
+    GenProfile ret = base;
+    ret.max_test_complexity = std::max<uint64_t>(1, std::llround(target_complexity));
+    ret.max_total_stmt_count = scale(base.max_total_stmt_count);
+    ret.max_func_stmt_count = scale(base.max_func_stmt_count);
+    fit_scope_knobs(ret, scope_runs, target_complexity, report);
+
+    report << "# Mean complexity: " << mean_complexity << ", target complexity: " << target_complexity << std::endl;
+    return ret;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 
-using namespace oorgen;
-
-const uint32_t TEST_FUNC_COUNT = 5;
-
-const uint32_t MAX_ALLOWED_INT_TYPES = 3;
-
-const uint32_t MAX_ARITH_DEPTH = 5;
-const uint32_t MAX_TOTAL_EXPR_COUNT = 50000000;
-const uint32_t MAX_FUNC_EXPR_COUNT = 10000000;
-
-const uint32_t MIN_SCOPE_STMT_COUNT = 5;
-const uint32_t MAX_SCOPE_STMT_COUNT = 10;
-
-const uint32_t MAX_TOTAL_STMT_COUNT = 5000;
-const uint32_t MAX_FUNC_STMT_COUNT = 1000;
-
-const uint32_t MIN_INP_VAR_COUNT = 20;
-const uint32_t MAX_INP_VAR_COUNT = 60;
-const uint32_t MIN_MIX_VAR_COUNT = 20;
-const uint32_t MAX_MIX_VAR_COUNT = 60;
-
-const uint32_t MAX_CSE_COUNT = 5;
-
-const uint32_t MAX_IF_DEPTH = 3;
-
-const uint64_t MAX_TEST_COMPLEXITY = UINT64_MAX;
-
-const uint32_t MIN_STRUCT_TYPES_COUNT = 0;
-const uint32_t MAX_STRUCT_TYPES_COUNT = 6;
-const uint32_t MIN_INP_STRUCT_COUNT = 0;
-const uint32_t MAX_INP_STRUCT_COUNT = 6;
-const uint32_t MIN_MIX_STRUCT_COUNT = 0;
-const uint32_t MAX_MIX_STRUCT_COUNT = 6;
-const uint32_t MIN_OUT_STRUCT_COUNT = 0;
-const uint32_t MAX_OUT_STRUCT_COUNT = 8;
-const uint32_t MIN_STRUCT_MEMBER_COUNT = 1;
-const uint32_t MAX_STRUCT_MEMBER_COUNT = 10;
-const uint32_t MAX_STRUCT_DEPTH = 5;
-const uint32_t MIN_BIT_FIELD_SIZE = 8;
-const uint32_t MAX_BIT_FIELD_SIZE = 2; //TODO: unused, because it cause different result for LLVM and GCC. See pr70733
-
-const uint32_t CONST_BUFFER_SIZE = 4;
-
-// This switch totally disables array in generated tests
-const bool DISABLE_ARRAYS = false;
-const uint32_t MIN_ARRAY_SIZE = 2;
-const uint32_t MAX_ARRAY_SIZE = 10;
-const uint32_t MIN_ARRAY_TYPES_COUNT = 0;
-const uint32_t MAX_ARRAY_TYPES_COUNT = 6;
-const uint32_t MIN_INP_ARRAY_COUNT = 0;
-const uint32_t MAX_INP_ARRAY_COUNT = 6;
-const uint32_t MIN_MIX_ARRAY_COUNT = 0;
-const uint32_t MAX_MIX_ARRAY_COUNT = 6;
-const uint32_t MIN_OUT_ARRAY_COUNT = 0;
-const uint32_t MAX_OUT_ARRAY_COUNT = 8;
-
-const uint32_t MIN_INP_PTR_COUNT = 0;
-const uint32_t MAX_INP_PTR_COUNT = 10;
-const uint32_t MIN_MIX_PTR_COUNT = 0;
-const uint32_t MAX_MIX_PTR_COUNT = 10;
-const uint32_t MIN_OUT_PTR_COUNT = 0;
-const uint32_t MAX_OUT_PTR_COUNT = 10;
+std::shared_ptr<RandValGen> oorgen::rand_val_gen;
 
-///////////////////////////////////////////////////////////////////////////////
+const std::map<std::string, RandValGen::EngineID> RandValGen::str_to_engine = {
+    {"mt19937", MT19937_64},
+    {"xoshiro256ss", XOSHIRO256SS},
+    {"pcg64", PCG64},
+    {"xoshiro256ssx4", XOSHIRO256SS_X4},
+};
 
-std::shared_ptr<RandValGen> oorgen::rand_val_gen;
+std::string RandValGen::get_engine_name (EngineID engine_id) {
+    for (const auto &iter : str_to_engine)
+        if (iter.second == engine_id)
+            return iter.first;
+    ERROR("unknown engine id (RandValGen)");
+}
 
-RandValGen::RandValGen (uint64_t _seed) {
+RandValGen::RandValGen (uint64_t _seed, EngineID _engine_id) : engine_id(_engine_id) {
     if (_seed != 0) {
         seed = _seed;
     }
@@ -533,8 +505,101 @@ RandValGen::RandValGen (uint64_t _seed) {
         std::random_device rd;
         seed = rd ();
     }
-    std::cout << "/*SEED " << options->plane_oorgen_version << "_" << seed << "*/" << std::endl;
-    rand_gen = std::mt19937_64(seed);
+    // Seed has form VV_SSS for legacy engine (so old seeds are printed as they used to be)
+    // and VV_EEE_SSS for all other engines.
+    std::cout << "/*SEED " << get_seed_str() << "*/" << std::endl;
+
+    init_engine();
+}
+
+std::string RandValGen::get_seed_str () {
+    std::string ret = options->plane_oorgen_version + "_";
+    if (engine_id != MT19937_64)
+        ret += get_engine_name(engine_id) + "_";
+    return ret + std::to_string(seed);
+}
+
+void RandValGen::init_engine () {
+    // Pool is filled on the first request
+    rand_pool_pos = RAND_POOL_SIZE;
+    switch (engine_id) {
+        case MT19937_64:
+            rand_gen = std::mt19937_64(seed);
+            break;
+        case XOSHIRO256SS:
+            xoshiro_gen.seed(seed);
+            break;
+        case PCG64:
+            pcg_gen.seed(seed);
+            break;
+        case XOSHIRO256SS_X4:
+            xoshiro_x4_gen.seed(seed);
+            break;
+        case MAX_ENGINE_ID:
+            ERROR("bad engine id (RandValGen)");
+    }
+}
+
+void RandValGen::fill_rand_pool () {
+    switch (engine_id) {
+        case XOSHIRO256SS:
+            xoshiro_gen.fill(rand_pool, RAND_POOL_SIZE);
+            break;
+        case PCG64:
+            pcg_gen.fill(rand_pool, RAND_POOL_SIZE);
+            break;
+        case XOSHIRO256SS_X4:
+            xoshiro_x4_gen.fill(rand_pool, RAND_POOL_SIZE);
+            break;
+        case MT19937_64:
+        case MAX_ENGINE_ID:
+            ERROR("engine doesn't use pool (RandValGen)");
+    }
+    rand_pool_pos = 0;
+}
+
+bool RandValGen::collect_stats = false;
+uint32_t RandValGen::draw_depth = 0;
+const char* RandValGen::cur_call_site = "unknown";
+std::unordered_map<const char*, RandValGen::DrawStats> RandValGen::stats;
+RandValGen::DrawStats RandValGen::total_stats;
+
+void RandValGen::add_draw (uint64_t value, std::chrono::nanoseconds time) {
+    for (DrawStats* i : {&stats[cur_call_site], &total_stats}) {
+        i->draws++;
+        i->time += time;
+        i->hash = (i->hash ^ value) * FNV_PRIME;
+    }
+}
+
+void RandValGen::dump_stats (std::ostream& stream) {
+    // The same call site name can be represented with different pointers in different translation units
+    std::map<std::string, DrawStats> merged_stats;
+    for (const auto& i : stats) {
+        DrawStats& merged = merged_stats[i.first];
+        merged.draws += i.second.draws;
+        merged.time += i.second.time;
+        // Combination should be commutative, as the order of pointers differs from run to run
+        merged.hash ^= i.second.hash;
+    }
+    merged_stats["total"] = total_stats;
+
+    stream << "/*RAND STATS" << std::endl;
+    stream << std::left << std::setw(48) << "call site" << std::right << std::setw(12) << "draws" <<
+              std::setw(14) << "time (us)" << std::setw(20) << "hash" << std::endl;
+    for (const auto& i : merged_stats)
+        stream << std::left << std::setw(48) << i.first << std::right << std::setw(12) << i.second.draws <<
+                  std::setw(14) << std::chrono::duration_cast<std::chrono::microseconds>(i.second.time).count() <<
+                  std::setw(20) << std::hex << i.second.hash << std::dec << std::endl;
+    stream << "*/" << std::endl;
+}
+
+std::shared_ptr<RandValGen> RandValGen::get_stream (uint64_t stream_id) {
+    std::shared_ptr<RandValGen> ret = std::make_shared<RandValGen>(*this);
+    uint64_t sm_state = seed ^ splitmix64(stream_id);
+    ret->seed = splitmix64(sm_state);
+    ret->init_engine();
+    return ret;
 }
 
 const std::string NameHandler::common_test_func_prefix = "tf_";
@@ -547,328 +612,361 @@ GenPolicy oorgen::default_gen_policy;
 GenPolicy::GenPolicy () {
     if (default_was_loaded)
         *this = default_gen_policy;
+    else
+        reset_arith_ssp_variants();
 }
 
 void GenPolicy::init_from_config () {
-    test_func_count = TEST_FUNC_COUNT;
-
-    num_of_allowed_int_types = MAX_ALLOWED_INT_TYPES;
+    RAND_CALL_SITE("GenPolicy::init_from_config");
+    BaseLayer& base = base_layer.mut();
+    base.profile = GenProfile::load(options->profile);
+    const GenProfile& profile = base.profile;
+    ArithLayer& arith = arith_layer.mut();
+    base.test_func_count = profile.test_func_count;
+
+    base.num_of_allowed_int_types = profile.max_allowed_int_types;
     rand_init_allowed_int_types();
 
-    allowed_cv_qual.push_back (Type::CV_Qual::NTHG);
+    base.allowed_cv_qual.push_back (Type::CV_Qual::NTHG);
 
-    allow_static_var = false;
+    base.allow_static_var = false;
     if (options->is_c())
-        allow_static_members = false;
+        base.allow_static_members = false;
     else if (options->is_cxx())
-        allow_static_members = true;
+        base.allow_static_members = true;
     else {
         std::cerr << "ERROR at " << __FILE__ << ":" << __LINE__ << ": can't detect language subset" << std::endl;
         exit(-1);
     }
 
-    allow_struct = true;
-    min_struct_type_count = MIN_STRUCT_TYPES_COUNT;
-    max_struct_type_count = MAX_STRUCT_TYPES_COUNT;
-    min_inp_struct_count = MIN_INP_STRUCT_COUNT;
-    max_inp_struct_count = MAX_INP_STRUCT_COUNT;
-    min_mix_struct_count = MIN_MIX_STRUCT_COUNT;
-    max_mix_struct_count = MAX_MIX_STRUCT_COUNT;
-    min_out_struct_count = MIN_OUT_STRUCT_COUNT;
-    max_out_struct_count = MAX_OUT_STRUCT_COUNT;
-    min_struct_member_count = MIN_STRUCT_MEMBER_COUNT;
-    max_struct_member_count = MAX_STRUCT_MEMBER_COUNT;
-    allow_mix_cv_qual_in_struct = false;
-    allow_mix_static_in_struct = true;
-    allow_mix_types_in_struct = true;
-    member_use_prob.push_back(Probability<bool>(true, 80));
-    member_use_prob.push_back(Probability<bool>(false, 20));
-    rand_val_gen->shuffle_prob(member_use_prob);
-    max_struct_depth = MAX_STRUCT_DEPTH;
-    member_class_prob.push_back(Probability<Data::VarClassID>(Data::VarClassID::VAR, 70));
-    member_class_prob.push_back(Probability<Data::VarClassID>(Data::VarClassID::STRUCT, 30));
-    rand_val_gen->shuffle_prob(member_class_prob);
-    min_bit_field_size = MIN_BIT_FIELD_SIZE;
-    max_bit_field_size = MAX_BIT_FIELD_SIZE;
-    bit_field_prob.push_back(Probability<BitFieldID>(UNNAMED, 15));
-    bit_field_prob.push_back(Probability<BitFieldID>(NAMED, 20));
-    bit_field_prob.push_back(Probability<BitFieldID>(MAX_BIT_FIELD_ID, 65));
-    rand_val_gen->shuffle_prob(bit_field_prob);
-
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(VAR, 50));
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(MEMBER, 25));
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(VAR_IN_ARRAY, 15));
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(MEMBER_IN_ARRAY, 10));
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(DEREFERENCE, 10));
-    out_data_type_prob.emplace_back(Probability<OutDataTypeID>(POINTER, 10));
-    rand_val_gen->shuffle_prob(out_data_type_prob);
-
-    out_data_category_prob.emplace_back(Probability<OutDataCategoryID>(MIX, 50));
-    out_data_category_prob.emplace_back(Probability<OutDataCategoryID>(OUT, 50));
-    rand_val_gen->shuffle_prob(out_data_category_prob);
-
-    min_array_size = MIN_ARRAY_SIZE;
-    max_array_size = MAX_ARRAY_SIZE;
-    array_base_type_prob.emplace_back(Probability<Type::TypeID>(Type::BUILTIN_TYPE, 60));
-    array_base_type_prob.emplace_back(Probability<Type::TypeID>(Type::STRUCT_TYPE, 40));
-    rand_val_gen->shuffle_prob(array_base_type_prob);
-    array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::C_ARR, 40));
+    base.allow_struct = true;
+    base.min_struct_type_count = profile.min_struct_types_count;
+    base.max_struct_type_count = profile.max_struct_types_count;
+    base.min_inp_struct_count = profile.min_inp_struct_count;
+    base.max_inp_struct_count = profile.max_inp_struct_count;
+    base.min_mix_struct_count = profile.min_mix_struct_count;
+    base.max_mix_struct_count = profile.max_mix_struct_count;
+    base.min_out_struct_count = profile.min_out_struct_count;
+    base.max_out_struct_count = profile.max_out_struct_count;
+    base.min_struct_member_count = profile.min_struct_member_count;
+    base.max_struct_member_count = profile.max_struct_member_count;
+    base.allow_mix_cv_qual_in_struct = false;
+    base.allow_mix_static_in_struct = true;
+    base.allow_mix_types_in_struct = true;
+    base.member_use_prob.push_back(Probability<bool>(true, 80));
+    base.member_use_prob.push_back(Probability<bool>(false, 20));
+    rand_val_gen->shuffle_prob(base.member_use_prob);
+    base.max_struct_depth = profile.max_struct_depth;
+    base.member_class_prob.push_back(Probability<Data::VarClassID>(Data::VarClassID::VAR, 70));
+    base.member_class_prob.push_back(Probability<Data::VarClassID>(Data::VarClassID::STRUCT, 30));
+    rand_val_gen->shuffle_prob(base.member_class_prob);
+    base.min_bit_field_size = profile.min_bit_field_size;
+    base.max_bit_field_size = profile.max_bit_field_size;
+    base.bit_field_prob.push_back(Probability<BitFieldID>(UNNAMED, 15));
+    base.bit_field_prob.push_back(Probability<BitFieldID>(NAMED, 20));
+    base.bit_field_prob.push_back(Probability<BitFieldID>(MAX_BIT_FIELD_ID, 65));
+    rand_val_gen->shuffle_prob(base.bit_field_prob);
+
+    base.out_data_type_prob.emplace_back(Probability<OutDataTypeID>(VAR, 50));
+    base.out_data_type_prob.emplace_back(Probability<OutDataTypeID>(MEMBER, 25));
+    base.out_data_type_prob.emplace_back(Probability<OutDataTypeID>(VAR_IN_ARRAY, 15));
+    base.out_data_type_prob.emplace_back(Probability<OutDataTypeID>(MEMBER_IN_ARRAY, 10));
+    base.out_data_type_prob.emplace_back(Probability<OutDataTypeID>(DEREFERENCE, 10));
+    base.out_data_type_prob.emplace_back(Probability<OutDataTypeID>(POINTER, 10));
+    rand_val_gen->shuffle_prob(base.out_data_type_prob);
+
+    base.out_data_category_prob.emplace_back(Probability<OutDataCategoryID>(MIX, 50));
+    base.out_data_category_prob.emplace_back(Probability<OutDataCategoryID>(OUT, 50));
+    rand_val_gen->shuffle_prob(base.out_data_category_prob);
+
+    base.min_array_size = profile.min_array_size;
+    base.max_array_size = profile.max_array_size;
+    base.array_base_type_prob.emplace_back(Probability<Type::TypeID>(Type::BUILTIN_TYPE, 60));
+    base.array_base_type_prob.emplace_back(Probability<Type::TypeID>(Type::STRUCT_TYPE, 40));
+    rand_val_gen->shuffle_prob(base.array_base_type_prob);
+    base.array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::C_ARR, 40));
     if (options->is_cxx()) {
-        array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::VAL_ARR, 15));
+        base.array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::VAL_ARR, 15));
         if (options->standard_id >= Options::CXX11) {
-            array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::STD_ARR, 15));
-            array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::STD_VEC, 15));
+            base.array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::STD_ARR, 15));
+            base.array_kind_prob.emplace_back(Probability<ArrayType::Kind>(ArrayType::STD_VEC, 15));
         }
     }
-    rand_val_gen->shuffle_prob(array_kind_prob);
-    array_elem_subs_prob.emplace_back(Probability<ArrayType::ElementSubscript>(ArrayType::Brackets, 50));
-    array_elem_subs_prob.emplace_back(Probability<ArrayType::ElementSubscript>(ArrayType::At, 50));
-    rand_val_gen->shuffle_prob(array_elem_subs_prob);
-    min_array_type_count = MIN_ARRAY_TYPES_COUNT;
-    max_array_type_count = MAX_ARRAY_TYPES_COUNT;
-    min_inp_array_count = MIN_INP_ARRAY_COUNT;
-    max_inp_array_count = MAX_INP_ARRAY_COUNT;
-    min_mix_array_count = MIN_MIX_ARRAY_COUNT;
-    max_mix_array_count = MAX_MIX_ARRAY_COUNT;
-    min_out_array_count = MIN_OUT_ARRAY_COUNT;
-    max_out_array_count = MAX_OUT_ARRAY_COUNT;
-    if (DISABLE_ARRAYS) {
-        min_array_type_count = max_array_type_count = 0;
-        min_inp_array_count = max_inp_array_count = 0;
-        min_mix_array_count = max_mix_array_count = 0;
-        min_out_array_count = max_out_array_count = 0;
-    }
-
-    min_inp_ptr_count = MIN_INP_PTR_COUNT;
-    max_inp_ptr_count = MAX_INP_PTR_COUNT;
-    min_mix_ptr_count = MIN_MIX_PTR_COUNT;
-    max_mix_ptr_count = MAX_MIX_PTR_COUNT;
-    min_out_ptr_count = MIN_OUT_PTR_COUNT;
-    max_out_ptr_count = MAX_OUT_PTR_COUNT;
-
-    max_arith_depth = MAX_ARITH_DEPTH;
-    max_total_expr_count = MAX_TOTAL_EXPR_COUNT;
-    max_func_expr_count = MAX_FUNC_EXPR_COUNT;
-
-    min_scope_stmt_count = MIN_SCOPE_STMT_COUNT;
-    max_scope_stmt_count = MAX_SCOPE_STMT_COUNT;
-
-    max_total_stmt_count = MAX_TOTAL_STMT_COUNT;
-    max_func_stmt_count = MAX_FUNC_STMT_COUNT;
-
-    min_inp_var_count = MIN_INP_VAR_COUNT;
-    max_inp_var_count = MAX_INP_VAR_COUNT;
-    min_mix_var_count = MIN_MIX_VAR_COUNT;
-    max_mix_var_count = MAX_MIX_VAR_COUNT;
-
-    max_cse_count = MAX_CSE_COUNT;
+    rand_val_gen->shuffle_prob(base.array_kind_prob);
+    base.array_elem_subs_prob.emplace_back(Probability<ArrayType::ElementSubscript>(ArrayType::Brackets, 50));
+    base.array_elem_subs_prob.emplace_back(Probability<ArrayType::ElementSubscript>(ArrayType::At, 50));
+    rand_val_gen->shuffle_prob(base.array_elem_subs_prob);
+    base.min_array_type_count = profile.min_array_types_count;
+    base.max_array_type_count = profile.max_array_types_count;
+    base.min_inp_array_count = profile.min_inp_array_count;
+    base.max_inp_array_count = profile.max_inp_array_count;
+    base.min_mix_array_count = profile.min_mix_array_count;
+    base.max_mix_array_count = profile.max_mix_array_count;
+    base.min_out_array_count = profile.min_out_array_count;
+    base.max_out_array_count = profile.max_out_array_count;
+    if (profile.disable_arrays) {
+        base.min_array_type_count = base.max_array_type_count = 0;
+        base.min_inp_array_count = base.max_inp_array_count = 0;
+        base.min_mix_array_count = base.max_mix_array_count = 0;
+        base.min_out_array_count = base.max_out_array_count = 0;
+    }
+
+    base.min_inp_ptr_count = profile.min_inp_ptr_count;
+    base.max_inp_ptr_count = profile.max_inp_ptr_count;
+    base.min_mix_ptr_count = profile.min_mix_ptr_count;
+    base.max_mix_ptr_count = profile.max_mix_ptr_count;
+    base.min_out_ptr_count = profile.min_out_ptr_count;
+    base.max_out_ptr_count = profile.max_out_ptr_count;
+
+    base.max_arith_depth = profile.max_arith_depth;
+    base.max_arith_node_count = profile.max_arith_node_count;
+    base.max_total_expr_count = profile.max_total_expr_count;
+    base.max_func_expr_count = profile.max_func_expr_count;
+
+    base.min_scope_stmt_count = profile.min_scope_stmt_count;
+    base.max_scope_stmt_count = profile.max_scope_stmt_count;
+
+    base.max_total_stmt_count = profile.max_total_stmt_count;
+    base.max_func_stmt_count = profile.max_func_stmt_count;
+
+    base.min_inp_var_count = profile.min_inp_var_count;
+    base.max_inp_var_count = profile.max_inp_var_count;
+    base.min_mix_var_count = profile.min_mix_var_count;
+    base.max_mix_var_count = profile.max_mix_var_count;
+
+    base.max_cse_count = profile.max_cse_count;
 
     for (int i = UnaryExpr::Op::Plus; i < UnaryExpr::Op::MaxOp; ++i) {
         Probability<UnaryExpr::Op> prob ((UnaryExpr::Op) i, 10);
-        allowed_unary_op.push_back (prob);
+        arith.allowed_unary_op.push_back (prob);
     }
-    rand_val_gen->shuffle_prob(allowed_unary_op);
+    rand_val_gen->shuffle_prob(arith.allowed_unary_op);
 
     for (int i = 0; i < BinaryExpr::Op::MaxOp; ++i) {
         Probability<BinaryExpr::Op> prob ((BinaryExpr::Op) i, 10);
-        allowed_binary_op.push_back (prob);
+        arith.allowed_binary_op.push_back (prob);
     }
-    rand_val_gen->shuffle_prob(allowed_binary_op);
+    rand_val_gen->shuffle_prob(arith.allowed_binary_op);
 
     Probability<Node::NodeID> decl_gen (Node::NodeID::DECL, 10);
-    stmt_gen_prob.push_back (decl_gen);
+    base.stmt_gen_prob.push_back (decl_gen);
     Probability<Node::NodeID> assign_gen (Node::NodeID::EXPR, 10);
-    stmt_gen_prob.push_back (assign_gen);
+    base.stmt_gen_prob.push_back (assign_gen);
     Probability<Node::NodeID> if_gen (Node::NodeID::IF, 10);
-    stmt_gen_prob.push_back (if_gen);
-    rand_val_gen->shuffle_prob(stmt_gen_prob);
-
-    Probability<ArithLeafID> data_leaf (ArithLeafID::Data, 11);
-    arith_leaves.push_back (data_leaf);
-    Probability<ArithLeafID> unary_leaf (ArithLeafID::Unary, 21);
-    arith_leaves.push_back (unary_leaf);
-    Probability<ArithLeafID> binary_leaf (ArithLeafID::Binary, 46);
-    arith_leaves.push_back (binary_leaf);
-    Probability<ArithLeafID> cond_leaf (ArithLeafID::Conditional, 3);
-    arith_leaves.push_back (cond_leaf);
-    Probability<ArithLeafID> type_cast_leaf (ArithLeafID::TypeCast, 11);
-    arith_leaves.push_back (type_cast_leaf);
-    Probability<ArithLeafID> cse_leaf (ArithLeafID::CSE, 8);
-    arith_leaves.push_back (cse_leaf);
-    rand_val_gen->shuffle_prob(arith_leaves);
+    base.stmt_gen_prob.push_back (if_gen);
+    rand_val_gen->shuffle_prob(base.stmt_gen_prob);
+
+    Probability<ArithLeafID> data_leaf (ArithLeafID::Data, profile.arith_data_weight);
+    base.arith_leaves.push_back (data_leaf);
+    Probability<ArithLeafID> unary_leaf (ArithLeafID::Unary, profile.arith_unary_weight);
+    base.arith_leaves.push_back (unary_leaf);
+    Probability<ArithLeafID> binary_leaf (ArithLeafID::Binary, profile.arith_binary_weight);
+    base.arith_leaves.push_back (binary_leaf);
+    Probability<ArithLeafID> cond_leaf (ArithLeafID::Conditional, profile.arith_conditional_weight);
+    base.arith_leaves.push_back (cond_leaf);
+    Probability<ArithLeafID> type_cast_leaf (ArithLeafID::TypeCast, profile.arith_type_cast_weight);
+    base.arith_leaves.push_back (type_cast_leaf);
+    Probability<ArithLeafID> cse_leaf (ArithLeafID::CSE, profile.arith_cse_weight);
+    base.arith_leaves.push_back (cse_leaf);
+    rand_val_gen->shuffle_prob(base.arith_leaves);
 
     Probability<ArithDataID> inp_data (ArithDataID::Inp, 80);
-    arith_data_distr.push_back (inp_data);
+    arith.arith_data_distr.push_back (inp_data);
     Probability<ArithDataID> const_data (ArithDataID::Const, 20);
-    arith_data_distr.push_back (const_data);
-    rand_val_gen->shuffle_prob(arith_data_distr);
+    arith.arith_data_distr.push_back (const_data);
+    rand_val_gen->shuffle_prob(arith.arith_data_distr);
+    reset_arith_ssp_variants();
 
     Probability<ArithCSEGenID> add_cse (ArithCSEGenID::Add, 20);
-    arith_cse_gen.push_back (add_cse);
+    base.arith_cse_gen.push_back (add_cse);
     Probability<ArithCSEGenID> max_cse_gen (ArithCSEGenID::MAX_CSE_GEN_ID, 80);
-    arith_cse_gen.push_back (max_cse_gen);
-    rand_val_gen->shuffle_prob(arith_cse_gen);
+    base.arith_cse_gen.push_back (max_cse_gen);
+    rand_val_gen->shuffle_prob(base.arith_cse_gen);
 
     Probability<ArithSSP::ConstUse> const_branch (ArithSSP::ConstUse::CONST_BRANCH, 5);
-    allowed_arith_ssp_const_use.push_back(const_branch);
+    base.allowed_arith_ssp_const_use.push_back(const_branch);
     Probability<ArithSSP::ConstUse> half_const (ArithSSP::ConstUse::HALF_CONST, 5);
-    allowed_arith_ssp_const_use.push_back(half_const);
+    base.allowed_arith_ssp_const_use.push_back(half_const);
     Probability<ArithSSP::ConstUse> no_ssp_const_use (ArithSSP::ConstUse::MAX_CONST_USE, 90);
-    allowed_arith_ssp_const_use.push_back(no_ssp_const_use);
-    rand_val_gen->shuffle_prob(allowed_arith_ssp_const_use);
+    base.allowed_arith_ssp_const_use.push_back(no_ssp_const_use);
+    rand_val_gen->shuffle_prob(base.allowed_arith_ssp_const_use);
 
     chosen_arith_ssp_const_use = ArithSSP::ConstUse::MAX_CONST_USE;
 
     Probability<ArithSSP::SimilarOp> additive (ArithSSP::SimilarOp::ADDITIVE, 5);
-    allowed_arith_ssp_similar_op.push_back(additive);
+    base.allowed_arith_ssp_similar_op.push_back(additive);
     Probability<ArithSSP::SimilarOp> bitwise (ArithSSP::SimilarOp::BITWISE, 5);
-    allowed_arith_ssp_similar_op.push_back(bitwise);
+    base.allowed_arith_ssp_similar_op.push_back(bitwise);
     Probability<ArithSSP::SimilarOp> logic (ArithSSP::SimilarOp::LOGIC, 5);
-    allowed_arith_ssp_similar_op.push_back(logic);
+    base.allowed_arith_ssp_similar_op.push_back(logic);
     Probability<ArithSSP::SimilarOp> mul (ArithSSP::SimilarOp::MUL, 5);
-    allowed_arith_ssp_similar_op.push_back(mul);
+    base.allowed_arith_ssp_similar_op.push_back(mul);
     Probability<ArithSSP::SimilarOp> bit_sh (ArithSSP::SimilarOp::BIT_SH, 5);
-    allowed_arith_ssp_similar_op.push_back(bit_sh);
+    base.allowed_arith_ssp_similar_op.push_back(bit_sh);
     Probability<ArithSSP::SimilarOp> add_mul (ArithSSP::SimilarOp::ADD_MUL, 5);
-    allowed_arith_ssp_similar_op.push_back(add_mul);
+    base.allowed_arith_ssp_similar_op.push_back(add_mul);
     Probability<ArithSSP::SimilarOp> no_ssp_similar_op (ArithSSP::SimilarOp::MAX_SIMILAR_OP, 70);
-    allowed_arith_ssp_similar_op.push_back(no_ssp_similar_op);
-    rand_val_gen->shuffle_prob(allowed_arith_ssp_similar_op);
+    base.allowed_arith_ssp_similar_op.push_back(no_ssp_similar_op);
+    rand_val_gen->shuffle_prob(base.allowed_arith_ssp_similar_op);
 
     chosen_arith_ssp_similar_op = ArithSSP::SimilarOp::MAX_SIMILAR_OP;
 
-    const_buffer_size = CONST_BUFFER_SIZE;
-    new_const_prob.emplace_back(Probability<bool>(true, 50));
-    new_const_prob.emplace_back(Probability<bool>(false, 50));
-    rand_val_gen->shuffle_prob(new_const_prob);
-    new_const_type_prob.emplace_back(Probability<bool>(true, 50));
-    new_const_type_prob.emplace_back(Probability<bool>(false, 50));
-    rand_val_gen->shuffle_prob(new_const_type_prob);
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Zero, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::One, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Two, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Three, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Four, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Eight, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Sixteen, 10));
-    special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::MAX_SPECIAL_CONST, 10));
-    rand_val_gen->shuffle_prob(special_const_prob);
-    new_const_kind_prob.emplace_back(Probability<ConstPattern::NewConstKind>(ConstPattern::EndBits, 25));
-    new_const_kind_prob.emplace_back(Probability<ConstPattern::NewConstKind>(ConstPattern::BitBlock, 25));
-    new_const_kind_prob.emplace_back(Probability<ConstPattern::NewConstKind>(ConstPattern::MAX_NEW_CONST_KIND, 50));
-    rand_val_gen->shuffle_prob(new_const_kind_prob);
-    const_transform_prob.emplace_back(Probability<UnaryExpr::Op>(UnaryExpr::Op::Negate, 33));
-    const_transform_prob.emplace_back(Probability<UnaryExpr::Op>(UnaryExpr::Op::BitNot, 33));
-    const_transform_prob.emplace_back(Probability<UnaryExpr::Op>(UnaryExpr::Op::Plus, 33));
-    rand_val_gen->shuffle_prob(const_transform_prob);
+    base.const_buffer_size = profile.const_buffer_size;
+    base.new_const_prob.emplace_back(Probability<bool>(true, 50));
+    base.new_const_prob.emplace_back(Probability<bool>(false, 50));
+    rand_val_gen->shuffle_prob(base.new_const_prob);
+    base.new_const_type_prob.emplace_back(Probability<bool>(true, 50));
+    base.new_const_type_prob.emplace_back(Probability<bool>(false, 50));
+    rand_val_gen->shuffle_prob(base.new_const_type_prob);
+    base.special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Zero, 10));
+    base.special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::One, 10));
+    base.special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Two, 10));
+    base.special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Three, 10));
+    base.special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Four, 10));
+    base.special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Eight, 10));
+    base.special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::Sixteen, 10));
+    base.special_const_prob.emplace_back(Probability<ConstPattern::SpecialConst>(ConstPattern::MAX_SPECIAL_CONST, 10));
+    rand_val_gen->shuffle_prob(base.special_const_prob);
+    base.new_const_kind_prob.emplace_back(Probability<ConstPattern::NewConstKind>(ConstPattern::EndBits, 25));
+    base.new_const_kind_prob.emplace_back(Probability<ConstPattern::NewConstKind>(ConstPattern::BitBlock, 25));
+    base.new_const_kind_prob.emplace_back(Probability<ConstPattern::NewConstKind>(ConstPattern::MAX_NEW_CONST_KIND, 50));
+    rand_val_gen->shuffle_prob(base.new_const_kind_prob);
+    base.const_transform_prob.emplace_back(Probability<UnaryExpr::Op>(UnaryExpr::Op::Negate, 33));
+    base.const_transform_prob.emplace_back(Probability<UnaryExpr::Op>(UnaryExpr::Op::BitNot, 33));
+    base.const_transform_prob.emplace_back(Probability<UnaryExpr::Op>(UnaryExpr::Op::Plus, 33));
+    rand_val_gen->shuffle_prob(base.const_transform_prob);
 
     Probability<bool> else_exist (true, 50);
-    else_prob.push_back(else_exist);
+    base.else_prob.push_back(else_exist);
     Probability<bool> no_else (false, 50);
-    else_prob.push_back(no_else);
-    rand_val_gen->shuffle_prob(else_prob);
+    base.else_prob.push_back(no_else);
+    rand_val_gen->shuffle_prob(base.else_prob);
 
-    max_if_depth = MAX_IF_DEPTH;
+    base.max_if_depth = profile.max_if_depth;
 
-    decl_stmt_gen_id_prob.emplace_back(Probability<GenPolicy::DeclStmtGenID>(GenPolicy::DeclStmtGenID::Variable, 80));
-    decl_stmt_gen_id_prob.emplace_back(Probability<GenPolicy::DeclStmtGenID>(GenPolicy::DeclStmtGenID::Pointer, 20));
-    rand_val_gen->shuffle_prob(decl_stmt_gen_id_prob);
+    base.decl_stmt_gen_id_prob.emplace_back(Probability<GenPolicy::DeclStmtGenID>(GenPolicy::DeclStmtGenID::Variable, 80));
+    base.decl_stmt_gen_id_prob.emplace_back(Probability<GenPolicy::DeclStmtGenID>(GenPolicy::DeclStmtGenID::Pointer, 20));
+    rand_val_gen->shuffle_prob(base.decl_stmt_gen_id_prob);
 
-    max_test_complexity = MAX_TEST_COMPLEXITY;
+    base.max_test_complexity = profile.max_test_complexity;
 
     default_was_loaded = true;
 }
 
 void GenPolicy::copy_data (std::shared_ptr<GenPolicy> old) {
-    cse = old->get_cse();
+    cse = old->cse;
 }
 
 GenPolicy GenPolicy::apply_arith_ssp_const_use (ArithSSP::ConstUse pattern_id) {
     chosen_arith_ssp_const_use = pattern_id;
     GenPolicy new_policy = *this;
+    new_policy.arith_layer = get_arith_ssp_variant(chosen_arith_ssp_const_use, chosen_arith_ssp_similar_op);
+    return new_policy;
+}
+
+GenPolicy GenPolicy::apply_arith_ssp_similar_op (ArithSSP::SimilarOp pattern_id) {
+    chosen_arith_ssp_similar_op = pattern_id;
+    GenPolicy new_policy = *this;
+    new_policy.arith_layer = get_arith_ssp_variant(chosen_arith_ssp_const_use, chosen_arith_ssp_similar_op);
+    return new_policy;
+}
+
+CowPtr<GenPolicy::ArithLayer> GenPolicy::get_arith_ssp_variant (ArithSSP::ConstUse const_use,
+                                                                ArithSSP::SimilarOp similar_op) {
+    std::shared_ptr<ArithLayer>& orig = arith_ssp_variants->layers[ArithSSP::MAX_CONST_USE][ArithSSP::MAX_SIMILAR_OP];
+    if (orig == nullptr)
+        orig = arith_layer.share();
+    std::shared_ptr<ArithLayer>& variant = arith_ssp_variants->layers[const_use][similar_op];
+    if (variant == nullptr) {
+        variant = std::make_shared<ArithLayer>(*orig);
+        fill_arith_ssp_const_use(*variant, const_use);
+        fill_arith_ssp_similar_op(*variant, similar_op);
+    }
+    return CowPtr<ArithLayer>(variant);
+}
+
+void GenPolicy::fill_arith_ssp_const_use (ArithLayer& layer, ArithSSP::ConstUse pattern_id) {
     if (pattern_id == ArithSSP::ConstUse::CONST_BRANCH) {
-        new_policy.arith_data_distr.clear();
+        layer.arith_data_distr.clear();
         Probability<ArithDataID> const_data (ArithDataID::Const, 100);
-        new_policy.arith_data_distr.push_back (const_data);
+        layer.arith_data_distr.push_back (const_data);
     }
     else if (pattern_id == ArithSSP::ConstUse::HALF_CONST) {
-        new_policy.arith_data_distr.clear();
+        layer.arith_data_distr.clear();
         Probability<ArithDataID> inp_data (ArithDataID::Inp, 50);
-        new_policy.arith_data_distr.push_back (inp_data);
+        layer.arith_data_distr.push_back (inp_data);
         Probability<ArithDataID> const_data (ArithDataID::Const, 50);
-        new_policy.arith_data_distr.push_back (const_data);
+        layer.arith_data_distr.push_back (const_data);
     }
-    return new_policy;
 }
 
-GenPolicy GenPolicy::apply_arith_ssp_similar_op (ArithSSP::SimilarOp pattern_id) {
-    chosen_arith_ssp_similar_op = pattern_id;
-    GenPolicy new_policy = *this;
+void GenPolicy::fill_arith_ssp_similar_op (ArithLayer& layer, ArithSSP::SimilarOp pattern_id) {
     if (pattern_id == ArithSSP::SimilarOp::ADDITIVE || pattern_id == ArithSSP::SimilarOp::ADD_MUL) {
-        new_policy.allowed_unary_op.clear();
+        layer.allowed_unary_op.clear();
         // TODO: add default probability to gen_policy;
         Probability<UnaryExpr::Op> plus (UnaryExpr::Op::Plus, 50);
-        new_policy.allowed_unary_op.push_back (plus);
+        layer.allowed_unary_op.push_back (plus);
         Probability<UnaryExpr::Op> negate (UnaryExpr::Op::Negate, 50);
-        new_policy.allowed_unary_op.push_back (negate);
+        layer.allowed_unary_op.push_back (negate);
 
-        new_policy.allowed_binary_op.clear();
+        layer.allowed_binary_op.clear();
         // TODO: add default probability to gen_policy;
         Probability<BinaryExpr::Op> add (BinaryExpr::Op::Add, 33);
-        new_policy.allowed_binary_op.push_back (add);
+        layer.allowed_binary_op.push_back (add);
         Probability<BinaryExpr::Op> sub (BinaryExpr::Op::Sub, 33);
-        new_policy.allowed_binary_op.push_back (sub);
+        layer.allowed_binary_op.push_back (sub);
 
         if (pattern_id == ArithSSP::SimilarOp::ADD_MUL) {
             Probability<BinaryExpr::Op> mul (BinaryExpr::Op::Mul, 33);
-            new_policy.allowed_binary_op.push_back (mul);
+            layer.allowed_binary_op.push_back (mul);
         }
     }
     else if (pattern_id == ArithSSP::SimilarOp::BITWISE || pattern_id == ArithSSP::SimilarOp::BIT_SH) {
-        new_policy.allowed_unary_op.clear();
+        layer.allowed_unary_op.clear();
         Probability<UnaryExpr::Op> bit_not (UnaryExpr::Op::BitNot, 100);
-        new_policy.allowed_unary_op.push_back (bit_not);
+        layer.allowed_unary_op.push_back (bit_not);
 
-        new_policy.allowed_binary_op.clear();
+        layer.allowed_binary_op.clear();
         Probability<BinaryExpr::Op> bit_and (BinaryExpr::Op::BitAnd, 20);
-        new_policy.allowed_binary_op.push_back (bit_and);
+        layer.allowed_binary_op.push_back (bit_and);
         Probability<BinaryExpr::Op> bit_xor (BinaryExpr::Op::BitXor, 20);
-        new_policy.allowed_binary_op.push_back (bit_xor);
+        layer.allowed_binary_op.push_back (bit_xor);
         Probability<BinaryExpr::Op> bit_or (BinaryExpr::Op::BitOr, 20);
-        new_policy.allowed_binary_op.push_back (bit_or);
+        layer.allowed_binary_op.push_back (bit_or);
 
         if (pattern_id == ArithSSP::SimilarOp::BIT_SH) {
             Probability<BinaryExpr::Op> shl (BinaryExpr::Op::Shl, 20);
-            new_policy.allowed_binary_op.push_back (shl);
+            layer.allowed_binary_op.push_back (shl);
             Probability<BinaryExpr::Op> shr (BinaryExpr::Op::Shr, 20);
-            new_policy.allowed_binary_op.push_back (shr);
+            layer.allowed_binary_op.push_back (shr);
         }
     }
     else if (pattern_id == ArithSSP::SimilarOp::LOGIC) {
-        new_policy.allowed_unary_op.clear();
+        layer.allowed_unary_op.clear();
         Probability<UnaryExpr::Op> log_not (UnaryExpr::Op::LogNot, 100);
-        new_policy.allowed_unary_op.push_back (log_not);
+        layer.allowed_unary_op.push_back (log_not);
 
-        new_policy.allowed_binary_op.clear();
+        layer.allowed_binary_op.clear();
         Probability<BinaryExpr::Op> log_and (BinaryExpr::Op::LogAnd, 50);
-        new_policy.allowed_binary_op.push_back (log_and);
+        layer.allowed_binary_op.push_back (log_and);
         Probability<BinaryExpr::Op> log_or (BinaryExpr::Op::LogOr, 50);
-        new_policy.allowed_binary_op.push_back (log_or);
+        layer.allowed_binary_op.push_back (log_or);
     }
     else if (pattern_id == ArithSSP::SimilarOp::MUL) {
         // TODO: what about unary expr?
-        new_policy.allowed_binary_op.clear();
+        layer.allowed_binary_op.clear();
         Probability<BinaryExpr::Op> mul (BinaryExpr::Op::Mul, 100);
-        new_policy.allowed_binary_op.push_back (mul);
+        layer.allowed_binary_op.push_back (mul);
     }
-    return new_policy;
 }
 
 void GenPolicy::rand_init_allowed_int_types () {
-    allowed_int_types.clear ();
+    RAND_CALL_SITE("GenPolicy::rand_init_allowed_int_types");
+    BaseLayer& base = base_layer.mut();
+    base.allowed_int_types.clear ();
     std::vector<IntegerType::IntegerTypeID> tmp_allowed_int_types;
     uint32_t gen_types = 0;
-    while (gen_types < num_of_allowed_int_types) {
+    while (gen_types < base.num_of_allowed_int_types) {
         auto type = (IntegerType::IntegerTypeID) rand_val_gen->get_rand_value(0, IntegerType::IntegerTypeID::MAX_INT_ID - 1);
         if (type == IntegerType::IntegerTypeID::BOOL && options->is_c())
             continue;
@@ -879,19 +977,20 @@ void GenPolicy::rand_init_allowed_int_types () {
     }
     for (auto i : tmp_allowed_int_types) {
         Probability<IntegerType::IntegerTypeID> prob (i, 1);
-        allowed_int_types.push_back (prob);
+        base.allowed_int_types.push_back (prob);
     }
 }
 
 void GenPolicy::set_cv_qual(bool value, Type::CV_Qual cv_qual) {
+    BaseLayer& base = base_layer.mut();
     if (value)
-        allowed_cv_qual.push_back (cv_qual);
+        base.allowed_cv_qual.push_back (cv_qual);
     else
-        allowed_cv_qual.erase (std::remove (allowed_cv_qual.begin(), allowed_cv_qual.end(), cv_qual), allowed_cv_qual.end());
+        base.allowed_cv_qual.erase (std::remove (base.allowed_cv_qual.begin(), base.allowed_cv_qual.end(), cv_qual), base.allowed_cv_qual.end());
 }
 
 bool GenPolicy::get_cv_qual(Type::CV_Qual cv_qual) {
-    return (std::find(allowed_cv_qual.begin(), allowed_cv_qual.end(), cv_qual) != allowed_cv_qual.end());
+    return (std::find(base_layer->allowed_cv_qual.begin(), base_layer->allowed_cv_qual.end(), cv_qual) != base_layer->allowed_cv_qual.end());
 }
 
 // Abstract measure of complexity of execution
@@ -915,34 +1014,197 @@ static const std::map<Node::NodeID, uint64_t> NodeComplexity {
 };
 
 uint64_t GenPolicy::test_complexity = 0;
+uint64_t GenPolicy::func_complexity = 0;
+uint64_t GenPolicy::reserved_complexity = 0;
 
-void GenPolicy::add_to_complexity(Node::NodeID node_id) {
-    test_complexity += NodeComplexity.at(node_id);
+void GenPolicy::add_to_complexity(Node::NodeID node_id, uint32_t depth) {
+    uint64_t node_complexity = NodeComplexity.at(node_id) * (1 + depth);
+    test_complexity += node_complexity;
+    func_complexity += node_complexity;
 }
 
+void GenPolicy::reserve_complexity (Node::NodeID node_id, uint32_t depth) {
+    reserved_complexity += NodeComplexity.at(node_id) * (1 + depth);
+}
 
-// Abstract measure of complexity of execution
-static const std::map<Node::NodeID, uint64_t> NodeComplexity {
-    {Node::NodeID::ASSIGN, 5},
-    {Node::NodeID::BINARY, 10},
-    {Node::NodeID::CONST, 5},
-    {Node::NodeID::TYPE_CAST, 10},
-    {Node::NodeID::UNARY, 5},
-    {Node::NodeID::VAR_USE, 5},
-    {Node::NodeID::MEMBER, 10},
-    {Node::NodeID::REFERENCE, 10},
-    {Node::NodeID::DEREFERENCE, 10},
-    {Node::NodeID::MAX_EXPR_ID, UINT64_MAX},
-    {Node::NodeID::MIN_STMT_ID, UINT64_MAX},
-    {Node::NodeID::DECL, 30},
-    {Node::NodeID::EXPR, 20},
-    {Node::NodeID::SCOPE, 5},
-    {Node::NodeID::IF, 50},
-    {Node::NodeID::MAX_STMT_ID, UINT64_MAX}
-};
+void GenPolicy::release_complexity (Node::NodeID node_id, uint32_t depth) {
+    uint64_t node_complexity = NodeComplexity.at(node_id) * (1 + depth);
+    if (node_complexity > reserved_complexity)
+        ERROR("release of complexity, which wasn't reserved");
+    reserved_complexity -= node_complexity;
+}
 
-uint64_t GenPolicy::test_complexity = 0;
+uint64_t GenPolicy::get_free_func_complexity () {
+    uint64_t used = func_complexity + reserved_complexity;
+    uint64_t max_func_complexity = get_max_func_complexity();
+    return used >= max_func_complexity ? 0 : max_func_complexity - used;
+}
+
+uint64_t GenPolicy::get_max_arith_leaf_complexity () {
+    return std::max({NodeComplexity.at(Node::NodeID::CONST), NodeComplexity.at(Node::NodeID::VAR_USE),
+                     NodeComplexity.at(Node::NodeID::MEMBER), NodeComplexity.at(Node::NodeID::DEREFERENCE)});
+}
+
+bool GenPolicy::can_add_arith_node (uint32_t pending_arg_count) {
+    // The most expensive operator is conditional one, it has three arguments
+    uint64_t worst_complexity = NodeComplexity.at(Node::NodeID::BINARY) +
+                                (pending_arg_count + 3ULL) * get_max_arith_leaf_complexity();
+    return get_free_func_complexity() >= worst_complexity;
+}
+
+// Total complexity and number of generated statements for each statement kind and depth of nested if statements.
+// They are collected through the whole test.
+static std::map<std::pair<Node::NodeID, uint32_t>, std::pair<uint64_t, uint64_t>> stmt_complexity_stats;
+
+void GenPolicy::zero_out_func_complexity () {
+    func_complexity = 0;
+    reserved_complexity = 0;
+}
+
+// Returns average complexity of generated statements or the given estimate, if there are no such statements
+static double measured_stmt_complexity (Node::NodeID stmt_id, uint32_t if_depth, double estimate) {
+    auto stats = stmt_complexity_stats.find(std::make_pair(stmt_id, if_depth));
+    if (stats == stmt_complexity_stats.end())
+        return estimate;
+    return static_cast<double>(stats->second.first) / stats->second.second;
+}
 
-void GenPolicy::add_to_complexity(Node::NodeID node_id) {
-    test_complexity += NodeComplexity.at(node_id);
+// Expected complexity of arithmetic expression tree. Every level of the tree is a mix of leaves and
+// operators, so it is computed from the depth limit to the root.
+double GenPolicy::estimate_arith_complexity () {
+    double leaf_complexity = 0;
+    uint64_t data_prob_sum = 0;
+    for (const auto& i : get_arith_data_distr()) {
+        Node::NodeID data_id = i.get_id() == ArithDataID::Const ? Node::NodeID::CONST : Node::NodeID::VAR_USE;
+        leaf_complexity += i.get_prob() * NodeComplexity.at(data_id);
+        data_prob_sum += i.get_prob();
+    }
+    leaf_complexity /= data_prob_sum;
+
+    uint64_t leaf_prob_sum = 0;
+    for (const auto& i : get_arith_leaves())
+        leaf_prob_sum += i.get_prob();
+
+    double ret = leaf_complexity;
+    double max_complexity = NodeComplexity.at(Node::NodeID::BINARY) * static_cast<double>(get_max_arith_node_count());
+    for (uint32_t depth = 0; depth < get_max_arith_depth(); ++depth) {
+        double level_complexity = 0;
+        for (const auto& i : get_arith_leaves()) {
+            double node_complexity = 0;
+            switch (i.get_id()) {
+                case ArithLeafID::Data:
+                    node_complexity = leaf_complexity;
+                    break;
+                case ArithLeafID::Unary:
+                    node_complexity = NodeComplexity.at(Node::NodeID::UNARY) + ret;
+                    break;
+                case ArithLeafID::Binary:
+                    node_complexity = NodeComplexity.at(Node::NodeID::BINARY) + 2 * ret;
+                    break;
+                case ArithLeafID::Conditional:
+                    node_complexity = NodeComplexity.at(Node::NodeID::BINARY) + 3 * ret;
+                    break;
+                case ArithLeafID::TypeCast:
+                    node_complexity = NodeComplexity.at(Node::NodeID::TYPE_CAST) + ret;
+                    break;
+                // Common subexpressions are generated separately
+                case ArithLeafID::CSE:
+                case ArithLeafID::MAX_LEAF_ID:
+                    break;
+            }
+            level_complexity += i.get_prob() * node_complexity;
+        }
+        level_complexity /= leaf_prob_sum;
+        // Deeper levels don't change the estimate anymore
+        if (level_complexity == ret)
+            break;
+        ret = level_complexity;
+        // Tree can't grow beyond the node limit, even if it is expected to be infinite
+        if (ret >= max_complexity)
+            return max_complexity;
+    }
+    return ret;
+}
+
+// Expected complexity of statement. Branches of if statement consist of statements at the next depth of nesting,
+// so they are estimated from the depth limit up to the given depth.
+double GenPolicy::estimate_stmt_complexity (Node::NodeID stmt_id, uint32_t if_depth) {
+    double arith_complexity = estimate_arith_complexity();
+    if (stmt_id == Node::NodeID::DECL)
+        return NodeComplexity.at(Node::NodeID::DECL) + arith_complexity;
+    if (stmt_id == Node::NodeID::EXPR)
+        return NodeComplexity.at(Node::NodeID::EXPR) + NodeComplexity.at(Node::NodeID::ASSIGN) + arith_complexity;
+    if (stmt_id != Node::NodeID::IF)
+        ERROR("bad statement id");
+
+    double else_share = 0;
+    uint64_t else_prob_sum = 0;
+    for (const auto& i : get_else_prob()) {
+        else_share += i.get_id() ? i.get_prob() : 0;
+        else_prob_sum += i.get_prob();
+    }
+    else_share /= else_prob_sum;
+    uint64_t stmt_prob_sum = 0;
+    for (const auto& i : get_stmt_gen_prob())
+        stmt_prob_sum += i.get_prob();
+    double mean_stmt_count = (get_min_scope_stmt_count() + get_max_scope_stmt_count()) / 2.0;
+
+    // Complexity of if statement, which branches are at the depth of the current iteration
+    double if_complexity = 0;
+    for (uint32_t depth = get_max_if_depth(); depth > if_depth; --depth) {
+        double stmt_complexity = 0;
+        for (const auto& i : get_stmt_gen_prob()) {
+            double estimate = 0;
+            // If statement can't be generated at depth limit, declaration is generated instead
+            Node::NodeID branch_stmt_id = i.get_id();
+            if (branch_stmt_id == Node::NodeID::IF && depth == get_max_if_depth())
+                branch_stmt_id = Node::NodeID::DECL;
+            if (branch_stmt_id == Node::NodeID::IF)
+                estimate = if_complexity;
+            else
+                estimate = estimate_stmt_complexity(branch_stmt_id, depth);
+            stmt_complexity += i.get_prob() * measured_stmt_complexity(branch_stmt_id, depth, estimate);
+        }
+        stmt_complexity /= stmt_prob_sum;
+        // Each level of nested if statements adds two levels of contexts (see Context)
+        double scope_complexity = NodeComplexity.at(Node::NodeID::SCOPE) * (1 + 2 * depth) +
+                                  mean_stmt_count * stmt_complexity;
+        if_complexity = NodeComplexity.at(Node::NodeID::IF) + arith_complexity + (1 + else_share) * scope_complexity;
+    }
+    return if_complexity;
 }
+
+// The cheapest statement of the kind: arithmetic expression is a single leaf, and branches are empty
+uint64_t GenPolicy::min_stmt_complexity (Node::NodeID stmt_id, uint32_t if_depth) {
+    uint64_t leaf_complexity = get_max_arith_leaf_complexity();
+    switch (stmt_id) {
+        case Node::NodeID::DECL:
+            return NodeComplexity.at(Node::NodeID::DECL) + leaf_complexity;
+        case Node::NodeID::EXPR:
+            return NodeComplexity.at(Node::NodeID::EXPR) + NodeComplexity.at(Node::NodeID::ASSIGN) + leaf_complexity;
+        case Node::NodeID::IF:
+            return NodeComplexity.at(Node::NodeID::IF) + leaf_complexity +
+                   2 * NodeComplexity.at(Node::NodeID::SCOPE) * (1 + 2 * (if_depth + 1ULL));
+        default:
+            ERROR("bad statement id");
+    }
+}
+
+uint64_t GenPolicy::predict_stmt_complexity (Node::NodeID stmt_id, uint32_t if_depth) {
+    double prediction = measured_stmt_complexity(stmt_id, if_depth, -1);
+    if (prediction < 0)
+        prediction = estimate_stmt_complexity(stmt_id, if_depth);
+    uint64_t min_complexity = min_stmt_complexity(stmt_id, if_depth);
+    if (prediction <= min_complexity)
+        return min_complexity;
+    if (prediction >= static_cast<double>(UINT64_MAX))
+        return UINT64_MAX;
+    return std::ceil(prediction);
+}
+
+void GenPolicy::record_stmt_complexity (Node::NodeID stmt_id, uint32_t if_depth, uint64_t complexity) {
+    std::pair<uint64_t, uint64_t>& stats = stmt_complexity_stats[std::make_pair(stmt_id, if_depth)];
+    stats.first += complexity;
+    stats.second++;
+}
+
@@ -1,14 +1,19 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <random>
+#include <unordered_map>
 
+#include "rand_engine.h"
 #include "type.h"
 #include "variable.h"
 #include "expr.h"
 #include "stmt.h"
+#include "util.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -20,9 +25,10 @@ namespace oorgen {
 template<typename T>
 class Probability {
     public:
+        Probability () : id(), prob(0) {}
         Probability (T _id, uint64_t _prob) : id(_id), prob (_prob) {}
-        T get_id () { return id; }
-        uint64_t get_prob () { return prob; }
+        T get_id () const { return id; }
+        uint64_t get_prob () const { return prob; }
         void increase_prob(uint64_t add_prob) { prob += add_prob; }
 
     private:
@@ -30,81 +36,415 @@ class Probability {
         uint64_t prob;
 };
 
+// Maximal number of variants in ProbabilityVector<T>. All IDs are small enums, so the storage
+// can be inline and fixed-size. It is specialized for every ID with its maximal value,
+// so each vector is only as large as its enum. MAX_* value itself is a valid variant
+// (it often means "none of them"), so it is counted too.
+template<typename T>
+struct ProbabilityCapacity;
+
+#define PROBABILITY_CAPACITY(type, max_value)                                           \
+template<>                                                                              \
+struct ProbabilityCapacity<type> { static const uint32_t value = max_value + 1; };
+
+PROBABILITY_CAPACITY(bool, true)
+PROBABILITY_CAPACITY(Node::NodeID, Node::NodeID::MAX_STMT_ID)
+PROBABILITY_CAPACITY(Type::TypeID, Type::TypeID::MAX_TYPE_ID)
+PROBABILITY_CAPACITY(IntegerType::IntegerTypeID, IntegerType::IntegerTypeID::MAX_INT_ID)
+PROBABILITY_CAPACITY(ArrayType::Kind, ArrayType::Kind::MAX_KIND)
+PROBABILITY_CAPACITY(ArrayType::ElementSubscript, ArrayType::ElementSubscript::MaxElementSubscript)
+PROBABILITY_CAPACITY(Data::VarClassID, Data::VarClassID::MAX_CLASS_ID)
+PROBABILITY_CAPACITY(UnaryExpr::Op, UnaryExpr::Op::MaxOp)
+PROBABILITY_CAPACITY(BinaryExpr::Op, BinaryExpr::Op::MaxOp)
+
+// Walker/Vose alias table for one set of probabilities.
+// Every bucket holds its own id and (optionally) an alias, so a random choice costs only
+// one bucket index and one point in [0, total) instead of building std::discrete_distribution.
+// All computations are integer, so the result doesn't depend on floating point rounding.
+// The table is stored inline and doesn't allocate memory.
+template<typename T, uint32_t N>
+class AliasTable {
+    public:
+        AliasTable () : built(false), size(0), total(0) {}
+
+        bool is_built () const { return built; }
+        void reset () { built = false; }
+        uint64_t get_size () const { return size; }
+        uint64_t get_total () const { return total; }
+
+        void build (const Probability<T>* probs, uint32_t _size) {
+            size = _size;
+            total = 0;
+            for (uint32_t i = 0; i < size; ++i) {
+                ids[i] = probs[i].get_id();
+                total += probs[i].get_prob();
+            }
+            // All buckets are full by default, i.e. they never redirect to alias
+            for (uint32_t i = 0; i < size; ++i) {
+                threshold[i] = total;
+                alias[i] = 0;
+            }
+            if (total == 0) {
+                // Degenerate set: every id is equally possible
+                total = 1;
+                for (uint32_t i = 0; i < size; ++i)
+                    threshold[i] = total;
+                built = true;
+                return;
+            }
+
+            // Each bucket has capacity "total", probability of i-th id is scaled by size.
+            // Small and large are used as stacks.
+            uint64_t scaled [N];
+            uint32_t small [N];
+            uint32_t large [N];
+            uint32_t small_count = 0;
+            uint32_t large_count = 0;
+            for (uint32_t i = 0; i < size; ++i) {
+                scaled[i] = probs[i].get_prob() * size;
+                if (scaled[i] < total)
+                    small[small_count++] = i;
+                else
+                    large[large_count++] = i;
+            }
+            while (small_count > 0 && large_count > 0) {
+                uint32_t less = small[--small_count];
+                uint32_t more = large[large_count - 1];
+                threshold[less] = scaled[less];
+                alias[less] = more;
+                scaled[more] -= total - scaled[less];
+                if (scaled[more] < total) {
+                    large_count--;
+                    small[small_count++] = more;
+                }
+            }
+            built = true;
+        }
+
+        // bucket should be in [0, size), point - in [0, total)
+        T pick (uint64_t bucket, uint64_t point) const {
+            return point < threshold[bucket] ? ids[bucket] : ids[alias[bucket]];
+        }
+
+    private:
+        bool built;
+        uint32_t size;
+        uint64_t total;
+        T ids [N];
+        uint64_t threshold [N];
+        uint8_t alias [N];
+};
+
+// Container for Probability<id>, which also caches the alias table for it.
+// Everything is stored inline in fixed-size arrays (see ProbabilityCapacity), so the container is
+// trivially copyable and neither copying nor sampling touches the allocator.
+// Probabilities can be read via const iterators only, all modifications go through
+// the member functions below and invalidate the table.
+template<typename T>
+class ProbabilityVector {
+    public:
+        static const uint32_t CAPACITY = ProbabilityCapacity<T>::value;
+        typedef const Probability<T>* const_iterator;
+
+        ProbabilityVector () : count(0) {}
+        ProbabilityVector (std::initializer_list<Probability<T>> init) : count(0) {
+            for (auto& i : init)
+                push_back(i);
+        }
+
+        void push_back (const Probability<T>& prob) {
+            if (count == CAPACITY)
+                ERROR("too many variants in probability vector");
+            invalidate();
+            probs[count++] = prob;
+        }
+        template<typename... Args>
+        void emplace_back (Args&&... args) { push_back(Probability<T>(std::forward<Args>(args)...)); }
+        void clear () { invalidate(); count = 0; }
+        Probability<T>& at (size_t idx) { invalidate(); return probs[check_idx(idx)]; }
+        const Probability<T>& at (size_t idx) const { return probs[check_idx(idx)]; }
+
+        size_t size () const { return count; }
+        bool empty () const { return count == 0; }
+        const_iterator begin () const { return probs; }
+        const_iterator end () const { return probs + count; }
+
+        // Returns up-to-date alias table
+        const AliasTable<T, CAPACITY>& get_alias_table () const {
+            if (!alias_table.is_built())
+                alias_table.build(probs, count);
+            return alias_table;
+        }
+
+    private:
+        void invalidate () { alias_table.reset(); }
+        size_t check_idx (size_t idx) const {
+            if (idx >= count)
+                ERROR("index is out of range of probability vector");
+            return idx;
+        }
+
+        uint32_t count;
+        Probability<T> probs [CAPACITY];
+        mutable AliasTable<T, CAPACITY> alias_table;
+};
+
 // 根据协议，随机值生成器是在OOR生成器中获取任何随机值的唯一方法。
 // 它用于整个源代码中的不同随机决策。
 // 它还跟踪所有生成的变量，结构等的名称编号。
 // 此外，它还对默认生成策略的初始参数进行改组。
 class RandValGen {
     public:
+        // Available pseudo-random engines.
+        // MT19937_64 is the legacy one: it relies on standard distributions, so its output depends on
+        // the standard library. It is kept to reproduce seeds, which don't specify engine.
+        // Other engines use library-independent algorithms for all random decisions.
+        // XOSHIRO256SS_X4 runs four xoshiro256** generators in parallel (with AVX2, if it is available).
+        enum EngineID {
+            MT19937_64, XOSHIRO256SS, PCG64, XOSHIRO256SS_X4, MAX_ENGINE_ID
+        };
+
+        static const std::map<std::string, EngineID> str_to_engine;
+        static std::string get_engine_name (EngineID engine_id);
+
         //特定的种子可以传递给构造函数以重现测试。
         //保留零值（则表明RandValGen可以选择任何值）
-        RandValGen (uint64_t _seed);
+        RandValGen (uint64_t _seed, EngineID _engine_id = MT19937_64);
+
+        EngineID get_engine_id () { return engine_id; }
+        // Returns seed in the form, which is accepted by --seed option
+        std::string get_seed_str ();
+
+        // Creates generator for independent random stream with the same engine.
+        // Its seed is derived from the seed of current generator and stream_id, so the stream
+        // doesn't depend on the number of values, which were taken from current generator.
+        std::shared_ptr<RandValGen> get_stream (uint64_t stream_id);
 
         template<typename T>
         T get_rand_value (T from, T to) {
-            // Using long long instead of T is a hack.
-            // get_rand_value is used with all kind of integer types, including chars.
-            // While standard is not allowing it to be used with uniform_int_distribution<>
-            // algorithm. Though, clang and gcc ok with it, but VS doesn't compile such code.
-            // For details see C++17, $26.5.1.1e [rand.req.genl]. This issue is also discussed
-            // in issue 2326 (closed as not a defect and reopened as feature request N4296).
-            std::uniform_int_distribution<long long> dis(from, to);
-            return dis(rand_gen);
+            DrawScope draw;
+            T ret = gen_rand_value(from, to);
+            draw.record(static_cast<uint64_t>(ret));
+            return ret;
         }
 
-        // Randomly chooses one of IDs, basing on std::vector<Probability<id>>.
+        // Randomly chooses one of IDs, basing on ProbabilityVector<id>.
+        // Alias table of the vector is reused between calls, so it is O(1) and doesn't allocate memory.
+        // Legacy engine keeps std::discrete_distribution, so old seeds draw the same values.
         template<typename T>
-        T get_rand_id (std::vector<Probability<T>> vec) {
-            std::vector<double> discrete_dis_init;
-            for (auto i : vec)
-                discrete_dis_init.push_back(i.get_prob());
-            std::discrete_distribution<int> discrete_dis(discrete_dis_init.begin(), discrete_dis_init.end());
-            return vec.at(discrete_dis(rand_gen)).get_id();
+        T get_rand_id (const ProbabilityVector<T>& vec) {
+            DrawScope draw;
+            if (engine_id == MT19937_64) {
+                std::vector<double> discrete_dis_init;
+                for (auto& i : vec)
+                    discrete_dis_init.push_back(i.get_prob());
+                std::discrete_distribution<int> discrete_dis(discrete_dis_init.begin(), discrete_dis_init.end());
+                T ret = vec.at(discrete_dis(rand_gen)).get_id();
+                draw.record(static_cast<uint64_t>(ret));
+                return ret;
+            }
+            const auto& table = vec.get_alias_table();
+            if (table.get_size() == 0)
+                ERROR("can't choose id from empty probability vector (RandValGen)");
+            uint64_t bucket = gen_rand_value<uint64_t>(0, table.get_size() - 1);
+            uint64_t point = gen_rand_value<uint64_t>(0, table.get_total() - 1);
+            T ret = table.pick(bucket, point);
+            draw.record(static_cast<uint64_t>(ret));
+            return ret;
         }
 
         // Randomly chooses one of vec elements
         template<typename T>
         T& get_rand_elem (std::vector<T>& vec) {
-            uint64_t idx = get_rand_value<uint64_t>(0, vec.size() - 1);
+            DrawScope draw;
+            uint64_t idx = gen_rand_value<uint64_t>(0, vec.size() - 1);
+            draw.record(idx);
+            return vec.at(idx);
+        }
+
+        // Any container with size() and at() can be used, e.g. InpExprIndex
+        template<typename C>
+        auto get_rand_elem (const C& vec) -> decltype(vec.at(0)) {
+            DrawScope draw;
+            uint64_t idx = gen_rand_value<uint64_t>(0, vec.size() - 1);
+            draw.record(idx);
             return vec.at(idx);
         }
 
         // 为了改善生成的测试的多样性，我们实现了输入概率的改组（它们存储在GenPolicy中）。
         // TODO：有时此操作会增加测试的复杂性，并且测试变得不可生成。
         template <typename T>
-        void shuffle_prob(std::vector<Probability<T>> &prob_vec) {
+        void shuffle_prob(ProbabilityVector<T> &prob_vec) {
+            CallSite call_site ("RandValGen::shuffle_prob");
+            DrawScope draw;
             int total_prob = 0;
             std::vector<double> discrete_dis_init;
-            std::vector<Probability<T>> new_prob;
-            for (auto i : prob_vec) {
+            ProbabilityVector<T> new_prob;
+            for (auto& i : prob_vec) {
                 total_prob += i.get_prob();
                 discrete_dis_init.push_back(i.get_prob());
                 new_prob.push_back(Probability<T>(i.get_id(), 0));
             }
 
-            std::uniform_int_distribution<int> dis (1, total_prob);
-            int delta = round(((double) total_prob) / dis(rand_gen));
+            if (engine_id == MT19937_64) {
+                std::uniform_int_distribution<int> dis (1, total_prob);
+                int delta = round(((double) total_prob) / dis(rand_gen));
 
-            std::discrete_distribution<int> discrete_dis(discrete_dis_init.begin(), discrete_dis_init.end());
-            for (int i = 0; i < total_prob; i += delta)
-                new_prob.at(discrete_dis(rand_gen)).increase_prob(delta);
+                std::discrete_distribution<int> discrete_dis(discrete_dis_init.begin(), discrete_dis_init.end());
+                for (int i = 0; i < total_prob; i += delta)
+                    new_prob.at(discrete_dis(rand_gen)).increase_prob(delta);
+            }
+            else {
+                int delta = round(((double) total_prob) / gen_rand_value<int>(1, total_prob));
+                for (int i = 0; i < total_prob; i += delta) {
+                    // Linear search is fine here: shuffling happens only during initialization
+                    uint64_t point = get_bounded_value(total_prob);
+                    uint32_t idx = 0;
+                    while (point >= prob_vec.at(idx).get_prob())
+                        point -= prob_vec.at(idx++).get_prob();
+                    new_prob.at(idx).increase_prob(delta);
+                }
+            }
 
             prob_vec = new_prob;
+            uint64_t shuffled = 0;
+            for (auto& i : prob_vec)
+                shuffled = shuffled * 101 + i.get_prob();
+            draw.record(shuffled);
         }
 
+        // Draw accounting. If it is enabled, every random decision is attributed to the innermost
+        // active CallSite (see RAND_CALL_SITE). For every call site we collect number of draws,
+        // time spent in RandValGen and hash of drawn values. The latter allows to detect any change
+        // of draw sequence, which breaks reproduction of old seeds.
+        // Statistics is shared between all generators, including the ones for independent streams.
+        class CallSite {
+            public:
+                CallSite (const char* name) : prev_call_site(cur_call_site) { cur_call_site = name; }
+                ~CallSite () { cur_call_site = prev_call_site; }
+            private:
+                const char* prev_call_site;
+        };
+
+        static void enable_stats () { collect_stats = true; }
+        static bool get_collect_stats () { return collect_stats; }
+        static void dump_stats (std::ostream& stream);
+
     private:
+        struct DrawStats {
+            DrawStats () : draws(0), time(0), hash(FNV_OFFSET) {}
+            uint64_t draws;
+            std::chrono::nanoseconds time;
+            uint64_t hash;
+        };
+
+        static const uint64_t FNV_OFFSET = 0xCBF29CE484222325ULL;
+        static const uint64_t FNV_PRIME = 0x100000001B3ULL;
+
+        static void add_draw (uint64_t value, std::chrono::nanoseconds time);
+
+        // Top-level public functions are measured, nested draws (e.g. get_rand_value inside get_rand_id)
+        // are accounted as a part of the outer one.
+        class DrawScope {
+            public:
+                DrawScope () : active(false) {
+                    if (!collect_stats)
+                        return;
+                    active = draw_depth++ == 0;
+                    if (active)
+                        start = std::chrono::steady_clock::now();
+                }
+                ~DrawScope () {
+                    if (collect_stats)
+                        draw_depth--;
+                }
+                void record (uint64_t value) {
+                    if (active)
+                        add_draw(value, std::chrono::steady_clock::now() - start);
+                }
+            private:
+                bool active;
+                std::chrono::steady_clock::time_point start;
+        };
+
+        static bool collect_stats;
+        static uint32_t draw_depth;
+        static const char* cur_call_site;
+        static std::unordered_map<const char*, DrawStats> stats;
+        static DrawStats total_stats;
+
+        template<typename T>
+        T gen_rand_value (T from, T to) {
+            if (engine_id != MT19937_64) {
+                // Computations are performed modulo 2^64, so they are correct for signed types too
+                uint64_t range = static_cast<uint64_t>(to) - static_cast<uint64_t>(from);
+                uint64_t offset = (range == UINT64_MAX) ? get_raw_value() : get_bounded_value(range + 1);
+                return static_cast<T>(static_cast<uint64_t>(from) + offset);
+            }
+            // Using long long instead of T is a hack.
+            // get_rand_value is used with all kind of integer types, including chars.
+            // While standard is not allowing it to be used with uniform_int_distribution<>
+            // algorithm. Though, clang and gcc ok with it, but VS doesn't compile such code.
+            // For details see C++17, $26.5.1.1e [rand.req.genl]. This issue is also discussed
+            // in issue 2326 (closed as not a defect and reopened as feature request N4296).
+            std::uniform_int_distribution<long long> dis(from, to);
+            return dis(rand_gen);
+        }
+
+        void init_engine ();
+
+        // Returns next raw 64-bit value of chosen engine.
+        // All engines, except legacy one, produce values in blocks, which are stored in rand_pool.
+        uint64_t get_raw_value () {
+            if (engine_id == MT19937_64)
+                return rand_gen();
+            if (rand_pool_pos == RAND_POOL_SIZE)
+                fill_rand_pool();
+            return rand_pool[rand_pool_pos++];
+        }
+
+        void fill_rand_pool ();
+
+        // Returns value in [0, range) without modulo bias.
+        // See D. Lemire, "Fast Random Integer Generation in an Interval", 2019.
+        uint64_t get_bounded_value (uint64_t range) {
+            uint64_t hi = 0;
+            uint64_t lo = 0;
+            mul_64x64_128(get_raw_value(), range, hi, lo);
+            if (lo < range) {
+                uint64_t threshold = (0 - range) % range;
+                while (lo < threshold)
+                    mul_64x64_128(get_raw_value(), range, hi, lo);
+            }
+            return hi;
+        }
+
         uint64_t seed;
+        EngineID engine_id;
         std::mt19937_64 rand_gen;
+        Xoshiro256StarStar xoshiro_gen;
+        oorgen::PCG64 pcg_gen;
+        Xoshiro256StarStarX4 xoshiro_x4_gen;
+
+        // It should be multiple of Xoshiro256StarStarX4::LANES
+        static const uint32_t RAND_POOL_SIZE = 256;
+        uint64_t rand_pool [RAND_POOL_SIZE];
+        uint32_t rand_pool_pos;
 };
 
 template <>
-inline bool RandValGen::get_rand_value<bool> (bool from, bool to) {
+inline bool RandValGen::gen_rand_value<bool> (bool from, bool to) {
+    if (engine_id != MT19937_64)
+        return from == to ? from : (bool) get_bounded_value(2);
     std::uniform_int_distribution<int> dis((int)from, (int)to);
     return (bool)dis(rand_gen);
 }
 
 extern std::shared_ptr<RandValGen> rand_val_gen;
 
+// Attributes all random draws in the current scope to call site "name" (see RandValGen::CallSite)
+#define RAND_CALL_SITE(name) RandValGen::CallSite rand_call_site_guard (name)
+
 // Singleton class which handles name's creation of all variables, structures, etc.
 // 处理所有变量、结构的name的创建
 class NameHandler {
@@ -119,22 +459,28 @@ class NameHandler {
         NameHandler(const NameHandler& root) = delete;
         NameHandler& operator=(const NameHandler&) = delete;
 
-        void set_test_func_prefix (uint32_t prefix) { test_func_prefix = common_test_func_prefix +
-                                                                         std::to_string(prefix) + "_"; }
-        std::string get_struct_type_name() { return test_func_prefix + "struct_" + std::to_string(++struct_type_count); }
+        void set_test_func_prefix (uint32_t prefix) { test_func_idx = prefix; }
+        std::string get_struct_type_name() { return get_test_func_prefix() + "struct_" + std::to_string(++struct_type_count); }
         uint32_t    get_struct_type_count() { return struct_type_count; }
-        std::string get_scalar_var_name() { return test_func_prefix + "var_" + std::to_string(++scalar_var_count); }
-        std::string get_struct_var_name() { return test_func_prefix + "struct_obj_" + std::to_string(++struct_var_count); }
-        std::string get_array_var_name() { return test_func_prefix + "array_" + std::to_string(++array_var_count); }
-        std::string get_ptr_var_name() { return test_func_prefix + "ptr_" + std::to_string(++ptr_var_count); }
+        // Names of data are spelled only during emission (see Name)
+        Name get_scalar_var_name() { return Name(Name::SCALAR_VAR, test_func_idx, ++scalar_var_count); }
+        void skip_scalar_var_names(uint32_t count) { scalar_var_count += count; }
+        Name get_struct_var_name() { return Name(Name::STRUCT_VAR, test_func_idx, ++struct_var_count); }
+        Name get_array_var_name() { return Name(Name::ARRAY_VAR, test_func_idx, ++array_var_count); }
+        Name get_ptr_var_name() { return Name(Name::PTR_VAR, test_func_idx, ++ptr_var_count); }
         void zero_out_counters () { struct_type_count = scalar_var_count = struct_var_count =
                                     array_var_count = ptr_var_count = 0; }
 
     private:
-        NameHandler() : struct_type_count(0), scalar_var_count(0), struct_var_count(0), ptr_var_count(0) {};
+        NameHandler() : test_func_idx(Name::NO_SCOPE), struct_type_count(0), scalar_var_count(0), struct_var_count(0),
+                        array_var_count(0), ptr_var_count(0) {};
+
+        std::string get_test_func_prefix () {
+            return test_func_idx == Name::NO_SCOPE ? "" : common_test_func_prefix + std::to_string(test_func_idx) + "_";
+        }
 
         // Test function prefix is required for multiple functions in one test
-        std::string test_func_prefix;
+        uint32_t test_func_idx;
         uint32_t struct_type_count;
         uint32_t scalar_var_count;
         uint32_t struct_var_count;
@@ -190,63 +536,233 @@ struct ConstPattern : public Pattern {
         MAX_NEW_CONST_KIND // New non-special constant
     };
 };
+
+PROBABILITY_CAPACITY(ArithSSP::ConstUse, ArithSSP::MAX_CONST_USE)
+PROBABILITY_CAPACITY(ArithSSP::SimilarOp, ArithSSP::MAX_SIMILAR_OP)
+PROBABILITY_CAPACITY(ConstPattern::SpecialConst, ConstPattern::MAX_SPECIAL_CONST)
+PROBABILITY_CAPACITY(ConstPattern::NewConstKind, ConstPattern::MAX_NEW_CONST_KIND)
 ///////////////////////////////////////////////////////////////////////////////
-// GenPolicy 存储了随机决策过程中使用的所有可用参数的实际分布（分布，应用的模式等）。此参数负责输出测试的属性。
-// 开始时，所有参数都是从config加载的，然后其中一些会被随机发出。
-// GenPolicy 可以在生成过程中进行修改，以调整输出测试的形状并赋予其所需的属性。
-// 每个随机生成的实体都需要其Context，并且Context包含其唯一的GenPolicy对象。
-class GenPolicy {
+// GenProfile contains sizing knobs, which are used by GenPolicy::init_from_config.
+// Default values form "balanced" preset. Other presets or profile files can be chosen at runtime
+// with --profile option, so the size of tests can be tuned without rebuilding the generator.
+// Profile file consists of "knob = value" lines, where knob is a name of any field below.
+// Line "preset = <name>" resets all knobs to the values of the preset. Everything after '#' is a comment.
+// Values must fit into uint32_t (except max_test_complexity and disable_arrays), sizes of arrays, scopes
+// and structs must be positive. Weights of arithmetic nodes are limited by 10000.
+struct GenProfile {
+        uint64_t test_func_count = 5;
+
+        uint64_t max_allowed_int_types = 3;
+
+        uint64_t max_arith_depth = 5;
+        // Limit of nodes in one arithmetic expression tree, including copies of common subexpressions.
+        // It keeps deep trees (see max_arith_depth) finite, while shallow ones almost never reach it.
+        uint64_t max_arith_node_count = 16384;
+        // Weights of node kinds in arithmetic expression tree (their sum must be positive)
+        uint64_t arith_data_weight = 11;
+        uint64_t arith_unary_weight = 21;
+        uint64_t arith_binary_weight = 46;
+        uint64_t arith_conditional_weight = 3;
+        uint64_t arith_type_cast_weight = 11;
+        uint64_t arith_cse_weight = 8;
+        uint64_t max_total_expr_count = 50000000;
+        uint64_t max_func_expr_count = 10000000;
+
+        uint64_t min_scope_stmt_count = 5;
+        uint64_t max_scope_stmt_count = 10;
+
+        uint64_t max_total_stmt_count = 5000;
+        uint64_t max_func_stmt_count = 1000;
+
+        uint64_t min_inp_var_count = 20;
+        uint64_t max_inp_var_count = 60;
+        uint64_t min_mix_var_count = 20;
+        uint64_t max_mix_var_count = 60;
+
+        uint64_t max_cse_count = 5;
+
+        uint64_t max_if_depth = 3;
+
+        uint64_t max_test_complexity = UINT64_MAX;
+
+        uint64_t min_struct_types_count = 0;
+        uint64_t max_struct_types_count = 6;
+        uint64_t min_inp_struct_count = 0;
+        uint64_t max_inp_struct_count = 6;
+        uint64_t min_mix_struct_count = 0;
+        uint64_t max_mix_struct_count = 6;
+        uint64_t min_out_struct_count = 0;
+        uint64_t max_out_struct_count = 8;
+        uint64_t min_struct_member_count = 1;
+        uint64_t max_struct_member_count = 10;
+        uint64_t max_struct_depth = 5;
+        uint64_t min_bit_field_size = 8;
+        uint64_t max_bit_field_size = 2; //TODO: unused, because it cause different result for LLVM and GCC. See pr70733
+
+        uint64_t const_buffer_size = 4;
+
+        // Non-zero value totally disables array in generated tests
+        uint64_t disable_arrays = 0;
+        uint64_t min_array_size = 2;
+        uint64_t max_array_size = 10;
+        uint64_t min_array_types_count = 0;
+        uint64_t max_array_types_count = 6;
+        uint64_t min_inp_array_count = 0;
+        uint64_t max_inp_array_count = 6;
+        uint64_t min_mix_array_count = 0;
+        uint64_t max_mix_array_count = 6;
+        uint64_t min_out_array_count = 0;
+        uint64_t max_out_array_count = 8;
+
+        uint64_t min_inp_ptr_count = 0;
+        uint64_t max_inp_ptr_count = 10;
+        uint64_t min_mix_ptr_count = 0;
+        uint64_t max_mix_ptr_count = 10;
+        uint64_t min_out_ptr_count = 0;
+        uint64_t max_out_ptr_count = 10;
+
+        // Returns preset with the given name or loads profile file
+        static GenProfile load (std::string name);
+        // Prints all knobs in the format of profile file
+        void dump (std::ostream& stream);
+
+        // Fits profile to the target compile and run time (in seconds, zero means "no target") with the help
+        // of the log of previous runs. Each line of the log describes one run with "key=value" pairs, separated
+        // by spaces: compile_time, run_time and complexity are required, everything else is ignored.
+        // Run time and compile time are assumed to be linear functions of test complexity, so the fitted
+        // lines determine complexity budget. Statement limits are scaled to the same ratio, so the
+        // generation usually ends before it is cut by the budget. Scope knobs (min_scope_stmt_count,
+        // max_scope_stmt_count and max_if_depth) are fitted to the budget with the knobs and complexity
+        // of the recorded runs (see --run-record).
+        static GenProfile autotune (GenProfile base, std::string log_file,
+                                    double target_compile_time, double target_run_time,
+                                    std::ostream& report);
+
+        static const std::map<std::string, GenProfile> presets;
+        static const std::map<std::string, uint64_t GenProfile::*> knobs;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Copy-on-write pointer. Copies of it share the same object, which is cloned only
+// when it is requested for modification while it still has other owners.
+template <typename T>
+class CowPtr {
     public:
-        // Utility enums. They are used as IDs in Probability<ID>
-        enum ArithLeafID {
-            Data, Unary, Binary, Conditional, TypeCast, CSE, MAX_LEAF_ID
-        };
+        CowPtr () : ptr(std::make_shared<T>()) {}
+        explicit CowPtr (std::shared_ptr<T> _ptr) : ptr(_ptr) {}
 
-        enum ArithDataID {
-            Inp, Const, MAX_DATA_ID
-        };
+        const T& operator* () const { return *ptr; }
+        const T* operator-> () const { return ptr.get(); }
 
-        // TODO: this can be replaced with true/false
-        enum ArithCSEGenID {
-            Add, MAX_CSE_GEN_ID
-        };
+        T& mut () {
+            if (ptr.use_count() > 1)
+                ptr = std::make_shared<T>(*ptr);
+            return *ptr;
+        }
 
-        enum OutDataTypeID {
-            VAR, MEMBER, VAR_IN_ARRAY, MEMBER_IN_ARRAY, DEREFERENCE, POINTER, MAX_OUT_DATA_TYPE_ID
-        };
+        // Returns underlying object. It mustn't be modified through this pointer.
+        std::shared_ptr<T> share () const { return ptr; }
 
-        enum OutDataCategoryID {
-            MIX, OUT, MAX_OUT_DATA_CATEGORY_ID
-        };
+    private:
+        std::shared_ptr<T> ptr;
+};
 
-        enum DeclStmtGenID {
-            Variable, Pointer, MAX_DECL_STMT_GEN_ID
-        };
+// Utility enums of GenPolicy. They are used as IDs in Probability<ID>.
+// They are declared outside of GenPolicy, so ProbabilityCapacity can be specialized for them before it.
+struct GenPolicyIDs {
+    enum ArithLeafID {
+        Data, Unary, Binary, Conditional, TypeCast, CSE, MAX_LEAF_ID
+    };
 
-        enum BitFieldID {
-            UNNAMED, NAMED, MAX_BIT_FIELD_ID
-        };
-        ///////////////////////////////////////////////////////////////////////
+    enum ArithDataID {
+        Inp, Const, MAX_DATA_ID
+    };
+
+    // TODO: this can be replaced with true/false
+    enum ArithCSEGenID {
+        Add, MAX_CSE_GEN_ID
+    };
+
+    enum OutDataTypeID {
+        VAR, MEMBER, VAR_IN_ARRAY, MEMBER_IN_ARRAY, DEREFERENCE, POINTER, MAX_OUT_DATA_TYPE_ID
+    };
+
+    enum OutDataCategoryID {
+        MIX, OUT, MAX_OUT_DATA_CATEGORY_ID
+    };
+
+    enum DeclStmtGenID {
+        Variable, Pointer, MAX_DECL_STMT_GEN_ID
+    };
+
+    enum BitFieldID {
+        UNNAMED, NAMED, MAX_BIT_FIELD_ID
+    };
+};
 
+PROBABILITY_CAPACITY(GenPolicyIDs::ArithLeafID, GenPolicyIDs::MAX_LEAF_ID)
+PROBABILITY_CAPACITY(GenPolicyIDs::ArithDataID, GenPolicyIDs::MAX_DATA_ID)
+PROBABILITY_CAPACITY(GenPolicyIDs::ArithCSEGenID, GenPolicyIDs::MAX_CSE_GEN_ID)
+PROBABILITY_CAPACITY(GenPolicyIDs::OutDataTypeID, GenPolicyIDs::MAX_OUT_DATA_TYPE_ID)
+PROBABILITY_CAPACITY(GenPolicyIDs::OutDataCategoryID, GenPolicyIDs::MAX_OUT_DATA_CATEGORY_ID)
+PROBABILITY_CAPACITY(GenPolicyIDs::DeclStmtGenID, GenPolicyIDs::MAX_DECL_STMT_GEN_ID)
+PROBABILITY_CAPACITY(GenPolicyIDs::BitFieldID, GenPolicyIDs::MAX_BIT_FIELD_ID)
+
+///////////////////////////////////////////////////////////////////////////////
+// GenPolicy 存储了随机决策过程中使用的所有可用参数的实际分布（分布，应用的模式等）。此参数负责输出测试的属性。
+// 开始时，所有参数都是从config加载的，然后其中一些会被随机发出。
+// GenPolicy 可以在生成过程中进行修改，以调整输出测试的形状并赋予其所需的属性。
+// 每个随机生成的实体都需要其Context，并且Context包含其唯一的GenPolicy对象。
+class GenPolicy : public GenPolicyIDs {
+    public:
         // General functions
         GenPolicy ();
         void copy_data (std::shared_ptr<GenPolicy> old);
         void init_from_config();
 
-        uint32_t get_test_func_count () { return test_func_count; }
+        uint32_t get_test_func_count () { return base_layer->test_func_count; }
+        const GenProfile& get_profile () { return base_layer->profile; }
 
         // Complexity section
-        static void add_to_complexity(Node::NodeID node_id);
-        void set_max_test_complexity (uint64_t _compl) { max_test_complexity = _compl; }
-        uint64_t get_max_test_complexity () { return max_test_complexity; }
+        // Complexity estimates compile and run cost of the test. Cost of nested scopes grows with their depth.
+        static void add_to_complexity(Node::NodeID node_id, uint32_t depth = 0);
+        // Complexity of the nodes, which are already decided on, but are generated later (e.g. branches
+        // of if statement after its condition), is reserved, so the nodes in between can't take it.
+        static void reserve_complexity (Node::NodeID node_id, uint32_t depth = 0);
+        static void release_complexity (Node::NodeID node_id, uint32_t depth = 0);
+        // Test complexity is kept under max_test_complexity, which is split evenly between test functions.
+        // Statement is generated only if its predicted complexity fits into the rest of the function's budget,
+        // and arithmetic expressions stop growing before they exceed it (see can_add_arith_node).
+        // Prediction is an average complexity of already generated statements of the same kind
+        // at the same depth of nested if statements. Until there are such statements, it is the expected
+        // complexity, which follows from the probabilities of the policy (see estimate_stmt_complexity).
+        uint64_t predict_stmt_complexity (Node::NodeID stmt_id, uint32_t if_depth);
+        static void record_stmt_complexity (Node::NodeID stmt_id, uint32_t if_depth, uint64_t complexity);
+        static uint64_t min_stmt_complexity (Node::NodeID stmt_id, uint32_t if_depth);
+        uint64_t get_free_func_complexity ();
+        // Returns true if the most expensive operator node still fits into the budget, when it and the given
+        // number of arguments, which are not generated yet, get the most expensive leaves
+        bool can_add_arith_node (uint32_t pending_arg_count);
+        static uint64_t get_max_arith_leaf_complexity ();
+        void set_max_test_complexity (uint64_t _compl) { base_layer.mut().max_test_complexity = _compl; }
+        uint64_t get_max_test_complexity () { return base_layer->max_test_complexity; }
+        uint64_t get_max_func_complexity () {
+            if (base_layer->max_test_complexity == UINT64_MAX)
+                return UINT64_MAX;
+            return base_layer->max_test_complexity / base_layer->test_func_count;
+        }
         static uint64_t  get_test_complexity () { return test_complexity; }
+        static uint64_t  get_func_complexity () { return func_complexity; }
+        // Complexity of the function is reset for every test function. Statistics of statements are kept,
+        // so the predictions in the next functions are more precise.
+        static void zero_out_func_complexity ();
 
         // Integer types section - defines number and type (bool, char ...) of available integer types
         void rand_init_allowed_int_types ();
-        void set_num_of_allowed_int_types (uint32_t _num_of_allowed_int_types) { num_of_allowed_int_types = _num_of_allowed_int_types; }
-        uint32_t get_num_of_allowed_int_types () { return num_of_allowed_int_types; }
-        std::vector<Probability<IntegerType::IntegerTypeID>>& get_allowed_int_types () { return allowed_int_types; }
-        void add_allowed_int_type (Probability<IntegerType::IntegerTypeID> allowed_int_type) { allowed_int_types.push_back(allowed_int_type); }
+        void set_num_of_allowed_int_types (uint32_t _num_of_allowed_int_types) { base_layer.mut().num_of_allowed_int_types = _num_of_allowed_int_types; }
+        uint32_t get_num_of_allowed_int_types () { return base_layer->num_of_allowed_int_types; }
+        const ProbabilityVector<IntegerType::IntegerTypeID>& get_allowed_int_types () { return base_layer->allowed_int_types; }
+        void add_allowed_int_type (Probability<IntegerType::IntegerTypeID> allowed_int_type) { base_layer.mut().allowed_int_types.push_back(allowed_int_type); }
 
         // cv-qualifiers section - defines available cv-qualifiers (nothing, const, volatile, const volatile)
         // TODO: Add check for options compability? Should allow_volatile + allow_const be equal to allow_const_volatile?
@@ -257,278 +773,320 @@ class GenPolicy {
         void set_allow_const_volatile (bool _allow_const_volatile) {
             set_cv_qual(_allow_const_volatile, Type::CV_Qual::CONST_VOLAT); }
         bool get_allow_const_volatile () { return get_cv_qual(Type::CV_Qual::CONST_VOLAT); }
-        std::vector<Type::CV_Qual>& get_allowed_cv_qual() { return allowed_cv_qual; }
+        const std::vector<Type::CV_Qual>& get_allowed_cv_qual() { return base_layer->allowed_cv_qual; }
 
         // Static specifier section
-        void set_allow_static_var (bool _allow_static_var) { allow_static_var = _allow_static_var; }
-        bool get_allow_static_var () { return allow_static_var; }
+        void set_allow_static_var (bool _allow_static_var) { base_layer.mut().allow_static_var = _allow_static_var; }
+        bool get_allow_static_var () { return base_layer->allow_static_var; }
 
         // Struct section - defines everything, related to struct types: their total number, range for number of members,
         // trigger for cv-qualifiers and specifiers of members, range for depth of nested struct types,
         // distribution of bit fields properties ...
-        void set_allow_struct (bool _allow_struct) { allow_struct = _allow_struct; }
-        bool get_allow_struct () { return allow_struct; }
-        void set_min_struct_type_count (uint32_t _min_struct_type_count) { min_struct_type_count = _min_struct_type_count; }
-        uint32_t get_min_struct_type_count () { return min_struct_type_count; }
-        void set_max_struct_type_count (uint32_t _max_struct_type_count) { max_struct_type_count = _max_struct_type_count; }
-        uint32_t get_max_struct_type_count () { return max_struct_type_count; }
-        void set_min_struct_member_count (uint32_t _min_struct_member_count) { min_struct_member_count = _min_struct_member_count; }
-        uint32_t get_min_struct_member_count () { return min_struct_member_count; }
-        void set_max_struct_member_count (uint32_t _max_struct_member_count) { max_struct_member_count = _max_struct_member_count; }
-        uint32_t get_max_struct_member_count () { return max_struct_member_count; }
-        void set_allow_mix_cv_qual_in_struct(bool mix) { allow_mix_cv_qual_in_struct = mix; }
-        bool get_allow_mix_cv_qual_in_struct() { return allow_mix_cv_qual_in_struct; }
-        void set_allow_static_members (bool _allow_static_members) { allow_static_members = _allow_static_members; }
-        bool get_allow_static_members () { return allow_static_members; }
-        void set_allow_mix_static_in_struct (bool mix) { allow_mix_static_in_struct = mix; }
-        bool get_allow_mix_static_in_struct () { return allow_mix_static_in_struct; }
-        void set_allow_mix_types_in_struct (bool mix) { allow_mix_types_in_struct = mix; }
-        bool get_allow_mix_types_in_struct () { return allow_mix_types_in_struct; }
-        std::vector<Probability<bool>> get_member_use_prob () { return member_use_prob; }
-        void set_max_struct_depth (uint32_t _max_struct_depth) { max_struct_depth = _max_struct_depth; }
-        uint32_t get_max_struct_depth () { return max_struct_depth; }
-        std::vector<Probability<Data::VarClassID>>& get_member_class_prob () { return member_class_prob; }
-        void set_min_bit_field_size (uint32_t _min_bit_field_size) { min_bit_field_size = _min_bit_field_size; }
-        uint32_t get_min_bit_field_size () { return min_bit_field_size; }
-        void set_max_bit_field_size (uint32_t _max_bit_field_size) { max_bit_field_size = _max_bit_field_size; }
-        uint32_t get_max_bit_field_size () { return max_bit_field_size; }
-        std::vector<Probability<BitFieldID>>& get_bit_field_prob () { return bit_field_prob; }
-        void add_bit_field_prob(Probability<BitFieldID> prob) { bit_field_prob.push_back(prob); }
+        void set_allow_struct (bool _allow_struct) { base_layer.mut().allow_struct = _allow_struct; }
+        bool get_allow_struct () { return base_layer->allow_struct; }
+        void set_min_struct_type_count (uint32_t _min_struct_type_count) { base_layer.mut().min_struct_type_count = _min_struct_type_count; }
+        uint32_t get_min_struct_type_count () { return base_layer->min_struct_type_count; }
+        void set_max_struct_type_count (uint32_t _max_struct_type_count) { base_layer.mut().max_struct_type_count = _max_struct_type_count; }
+        uint32_t get_max_struct_type_count () { return base_layer->max_struct_type_count; }
+        void set_min_struct_member_count (uint32_t _min_struct_member_count) { base_layer.mut().min_struct_member_count = _min_struct_member_count; }
+        uint32_t get_min_struct_member_count () { return base_layer->min_struct_member_count; }
+        void set_max_struct_member_count (uint32_t _max_struct_member_count) { base_layer.mut().max_struct_member_count = _max_struct_member_count; }
+        uint32_t get_max_struct_member_count () { return base_layer->max_struct_member_count; }
+        void set_allow_mix_cv_qual_in_struct(bool mix) { base_layer.mut().allow_mix_cv_qual_in_struct = mix; }
+        bool get_allow_mix_cv_qual_in_struct() { return base_layer->allow_mix_cv_qual_in_struct; }
+        void set_allow_static_members (bool _allow_static_members) { base_layer.mut().allow_static_members = _allow_static_members; }
+        bool get_allow_static_members () { return base_layer->allow_static_members; }
+        void set_allow_mix_static_in_struct (bool mix) { base_layer.mut().allow_mix_static_in_struct = mix; }
+        bool get_allow_mix_static_in_struct () { return base_layer->allow_mix_static_in_struct; }
+        void set_allow_mix_types_in_struct (bool mix) { base_layer.mut().allow_mix_types_in_struct = mix; }
+        bool get_allow_mix_types_in_struct () { return base_layer->allow_mix_types_in_struct; }
+        const ProbabilityVector<bool>& get_member_use_prob () { return base_layer->member_use_prob; }
+        void set_max_struct_depth (uint32_t _max_struct_depth) { base_layer.mut().max_struct_depth = _max_struct_depth; }
+        uint32_t get_max_struct_depth () { return base_layer->max_struct_depth; }
+        const ProbabilityVector<Data::VarClassID>& get_member_class_prob () { return base_layer->member_class_prob; }
+        void set_min_bit_field_size (uint32_t _min_bit_field_size) { base_layer.mut().min_bit_field_size = _min_bit_field_size; }
+        uint32_t get_min_bit_field_size () { return base_layer->min_bit_field_size; }
+        void set_max_bit_field_size (uint32_t _max_bit_field_size) { base_layer.mut().max_bit_field_size = _max_bit_field_size; }
+        uint32_t get_max_bit_field_size () { return base_layer->max_bit_field_size; }
+        const ProbabilityVector<BitFieldID>& get_bit_field_prob () { return base_layer->bit_field_prob; }
+        void add_bit_field_prob(Probability<BitFieldID> prob) { base_layer.mut().bit_field_prob.push_back(prob); }
 
         // Variables section - defines total number of variables of each kind (input and mix),
         // distribution of type of output variables.
-        void add_out_data_type_prob(Probability<OutDataTypeID> prob) { out_data_type_prob.push_back(prob); }
-        std::vector<Probability<OutDataTypeID>> get_out_data_type_prob() { return out_data_type_prob; }
-        void add_out_data_category_prob(Probability<OutDataCategoryID > prob) { out_data_category_prob.push_back(prob); }
-        std::vector<Probability<OutDataCategoryID>> get_out_data_category_prob() { return out_data_category_prob; }
-        void set_min_inp_var_count (uint32_t _min_inp_var_count) { min_inp_var_count = _min_inp_var_count; }
-        uint32_t get_min_inp_var_count () { return min_inp_var_count; }
-        void set_max_inp_var_count (uint32_t _max_inp_var_count) { max_inp_var_count = _max_inp_var_count; }
-        uint32_t get_max_inp_var_count () { return max_inp_var_count; }
-        void set_min_mix_var_count (uint32_t _min_mix_var_count) { min_mix_var_count = _min_mix_var_count; }
-        uint32_t get_min_mix_var_count () { return min_mix_var_count; }
-        void set_max_mix_var_count (uint32_t _max_mix_var_count) { max_mix_var_count = _max_mix_var_count; }
-        uint32_t get_max_mix_var_count () { return max_mix_var_count; }
-        void set_min_out_var_count (uint32_t _min_out_var_count) { min_out_var_count = _min_out_var_count; }
-        uint32_t get_min_out_var_count () { return min_out_var_count; }
-        void set_max_out_var_count (uint32_t _max_out_var_count) { max_out_var_count = _max_out_var_count; }
-        uint32_t get_max_out_var_count () { return max_out_var_count; }
-        void set_min_inp_struct_count (uint32_t _min_inp_struct_count) { min_inp_struct_count = _min_inp_struct_count; }
-        uint32_t get_min_inp_struct_count () { return min_inp_struct_count; }
-        void set_max_inp_struct_count (uint32_t _max_inp_struct_count) { max_inp_struct_count = _max_inp_struct_count; }
-        uint32_t get_max_inp_struct_count () { return max_inp_struct_count; }
-        void set_min_mix_struct_count (uint32_t _min_mix_struct_count) { min_mix_struct_count = _min_mix_struct_count; }
-        uint32_t get_min_mix_struct_count () { return min_mix_struct_count; }
-        void set_max_mix_struct_count (uint32_t _max_mix_struct_count) { max_mix_struct_count = _max_mix_struct_count; }
-        uint32_t get_max_mix_struct_count () { return max_mix_struct_count; }
-        void set_min_out_struct_count (uint32_t _min_out_struct_count) { min_out_struct_count = _min_out_struct_count; }
-        uint32_t get_min_out_struct_count () { return min_out_struct_count; }
-        void set_max_out_struct_count (uint32_t _max_out_struct_count) { max_out_struct_count = _max_out_struct_count; }
-        uint32_t get_max_out_struct_count () { return max_out_struct_count; }
-        void set_min_inp_array_count (uint32_t _min_inp_array_count) { min_inp_array_count = _min_inp_array_count; }
-        uint32_t get_min_inp_array_count () { return min_inp_array_count; }
-        void set_max_inp_array_count (uint32_t _max_inp_array_count) { max_inp_array_count = _max_inp_array_count; }
-        uint32_t get_max_inp_array_count () { return max_inp_array_count; }
-        void set_min_mix_array_count (uint32_t _min_mix_array_count) { min_mix_array_count = _min_mix_array_count; }
-        uint32_t get_min_mix_array_count () { return min_mix_array_count; }
-        void set_max_mix_array_count (uint32_t _max_mix_array_count) { max_mix_array_count = _max_mix_array_count; }
-        uint32_t get_max_mix_array_count () { return max_mix_array_count; }
-        void set_min_out_array_count (uint32_t _min_out_array_count) { min_out_array_count = _min_out_array_count; }
-        uint32_t get_min_out_array_count () { return min_out_array_count; }
-        void set_max_out_array_count (uint32_t _max_out_array_count) { max_out_array_count = _max_out_array_count; }
-        uint32_t get_max_out_array_count () { return max_out_array_count; }
-        uint32_t get_min_inp_ptr_count () { return min_inp_ptr_count; }
-        void set_max_inp_ptr_count (uint32_t _max_inp_ptr_count) { max_inp_ptr_count = _max_inp_ptr_count; }
-        uint32_t get_max_inp_ptr_count () { return max_inp_ptr_count; }
-        void set_min_mix_ptr_count (uint32_t _min_mix_ptr_count) { min_mix_ptr_count = _min_mix_ptr_count; }
-        uint32_t get_min_mix_ptr_count () { return min_mix_ptr_count; }
-        void set_max_mix_ptr_count (uint32_t _max_mix_ptr_count) { max_mix_ptr_count = _max_mix_ptr_count; }
-        uint32_t get_max_mix_ptr_count () { return max_mix_ptr_count; }
-        void set_min_out_ptr_count (uint32_t _min_out_ptr_count) { min_out_ptr_count = _min_out_ptr_count; }
-        uint32_t get_min_out_ptr_count () { return min_out_ptr_count; }
-        void set_max_out_ptr_count (uint32_t _max_out_ptr_count) { max_out_ptr_count = _max_out_ptr_count; }
-        uint32_t get_max_out_ptr_count () { return max_out_ptr_count; }
+        void add_out_data_type_prob(Probability<OutDataTypeID> prob) { base_layer.mut().out_data_type_prob.push_back(prob); }
+        const ProbabilityVector<OutDataTypeID>& get_out_data_type_prob () { return base_layer->out_data_type_prob; }
+        void add_out_data_category_prob(Probability<OutDataCategoryID > prob) { base_layer.mut().out_data_category_prob.push_back(prob); }
+        const ProbabilityVector<OutDataCategoryID>& get_out_data_category_prob () { return base_layer->out_data_category_prob; }
+        void set_min_inp_var_count (uint32_t _min_inp_var_count) { base_layer.mut().min_inp_var_count = _min_inp_var_count; }
+        uint32_t get_min_inp_var_count () { return base_layer->min_inp_var_count; }
+        void set_max_inp_var_count (uint32_t _max_inp_var_count) { base_layer.mut().max_inp_var_count = _max_inp_var_count; }
+        uint32_t get_max_inp_var_count () { return base_layer->max_inp_var_count; }
+        void set_min_mix_var_count (uint32_t _min_mix_var_count) { base_layer.mut().min_mix_var_count = _min_mix_var_count; }
+        uint32_t get_min_mix_var_count () { return base_layer->min_mix_var_count; }
+        void set_max_mix_var_count (uint32_t _max_mix_var_count) { base_layer.mut().max_mix_var_count = _max_mix_var_count; }
+        uint32_t get_max_mix_var_count () { return base_layer->max_mix_var_count; }
+        void set_min_out_var_count (uint32_t _min_out_var_count) { base_layer.mut().min_out_var_count = _min_out_var_count; }
+        uint32_t get_min_out_var_count () { return base_layer->min_out_var_count; }
+        void set_max_out_var_count (uint32_t _max_out_var_count) { base_layer.mut().max_out_var_count = _max_out_var_count; }
+        uint32_t get_max_out_var_count () { return base_layer->max_out_var_count; }
+        void set_min_inp_struct_count (uint32_t _min_inp_struct_count) { base_layer.mut().min_inp_struct_count = _min_inp_struct_count; }
+        uint32_t get_min_inp_struct_count () { return base_layer->min_inp_struct_count; }
+        void set_max_inp_struct_count (uint32_t _max_inp_struct_count) { base_layer.mut().max_inp_struct_count = _max_inp_struct_count; }
+        uint32_t get_max_inp_struct_count () { return base_layer->max_inp_struct_count; }
+        void set_min_mix_struct_count (uint32_t _min_mix_struct_count) { base_layer.mut().min_mix_struct_count = _min_mix_struct_count; }
+        uint32_t get_min_mix_struct_count () { return base_layer->min_mix_struct_count; }
+        void set_max_mix_struct_count (uint32_t _max_mix_struct_count) { base_layer.mut().max_mix_struct_count = _max_mix_struct_count; }
+        uint32_t get_max_mix_struct_count () { return base_layer->max_mix_struct_count; }
+        void set_min_out_struct_count (uint32_t _min_out_struct_count) { base_layer.mut().min_out_struct_count = _min_out_struct_count; }
+        uint32_t get_min_out_struct_count () { return base_layer->min_out_struct_count; }
+        void set_max_out_struct_count (uint32_t _max_out_struct_count) { base_layer.mut().max_out_struct_count = _max_out_struct_count; }
+        uint32_t get_max_out_struct_count () { return base_layer->max_out_struct_count; }
+        void set_min_inp_array_count (uint32_t _min_inp_array_count) { base_layer.mut().min_inp_array_count = _min_inp_array_count; }
+        uint32_t get_min_inp_array_count () { return base_layer->min_inp_array_count; }
+        void set_max_inp_array_count (uint32_t _max_inp_array_count) { base_layer.mut().max_inp_array_count = _max_inp_array_count; }
+        uint32_t get_max_inp_array_count () { return base_layer->max_inp_array_count; }
+        void set_min_mix_array_count (uint32_t _min_mix_array_count) { base_layer.mut().min_mix_array_count = _min_mix_array_count; }
+        uint32_t get_min_mix_array_count () { return base_layer->min_mix_array_count; }
+        void set_max_mix_array_count (uint32_t _max_mix_array_count) { base_layer.mut().max_mix_array_count = _max_mix_array_count; }
+        uint32_t get_max_mix_array_count () { return base_layer->max_mix_array_count; }
+        void set_min_out_array_count (uint32_t _min_out_array_count) { base_layer.mut().min_out_array_count = _min_out_array_count; }
+        uint32_t get_min_out_array_count () { return base_layer->min_out_array_count; }
+        void set_max_out_array_count (uint32_t _max_out_array_count) { base_layer.mut().max_out_array_count = _max_out_array_count; }
+        uint32_t get_max_out_array_count () { return base_layer->max_out_array_count; }
+        uint32_t get_min_inp_ptr_count () { return base_layer->min_inp_ptr_count; }
+        void set_max_inp_ptr_count (uint32_t _max_inp_ptr_count) { base_layer.mut().max_inp_ptr_count = _max_inp_ptr_count; }
+        uint32_t get_max_inp_ptr_count () { return base_layer->max_inp_ptr_count; }
+        void set_min_mix_ptr_count (uint32_t _min_mix_ptr_count) { base_layer.mut().min_mix_ptr_count = _min_mix_ptr_count; }
+        uint32_t get_min_mix_ptr_count () { return base_layer->min_mix_ptr_count; }
+        void set_max_mix_ptr_count (uint32_t _max_mix_ptr_count) { base_layer.mut().max_mix_ptr_count = _max_mix_ptr_count; }
+        uint32_t get_max_mix_ptr_count () { return base_layer->max_mix_ptr_count; }
+        void set_min_out_ptr_count (uint32_t _min_out_ptr_count) { base_layer.mut().min_out_ptr_count = _min_out_ptr_count; }
+        uint32_t get_min_out_ptr_count () { return base_layer->min_out_ptr_count; }
+        void set_max_out_ptr_count (uint32_t _max_out_ptr_count) { base_layer.mut().max_out_ptr_count = _max_out_ptr_count; }
+        uint32_t get_max_out_ptr_count () { return base_layer->max_out_ptr_count; }
 
         // Arrays section - defines arrays' sizes, their kind, base type probability
-        uint32_t get_min_array_size () { return min_array_size; }
-        void set_min_array_size (uint32_t _min_array_size) { min_array_size = _min_array_size; }
-        uint32_t get_max_array_size () { return max_array_size; }
-        void set_max_array_size (uint32_t _max_array_size) { max_array_size = _max_array_size; }
-        std::vector<Probability<ArrayType::Kind>>& get_array_kind_prob () { return array_kind_prob; }
-        std::vector<Probability<Type::TypeID>>& get_array_base_type_prob () { return array_base_type_prob; }
-        void set_min_array_type_count (uint32_t _min_array_type_count) { min_array_type_count = _min_array_type_count; }
-        uint32_t get_min_array_type_count () { return min_array_type_count; }
-        void set_max_array_type_count (uint32_t _max_array_type_count) { max_array_type_count = _max_array_type_count; }
-        uint32_t get_max_array_type_count () { return max_array_type_count; }
-        std::vector<Probability<ArrayType::ElementSubscript>>& get_array_elem_subs_prob () { return array_elem_subs_prob; }
+        uint32_t get_min_array_size () { return base_layer->min_array_size; }
+        void set_min_array_size (uint32_t _min_array_size) { base_layer.mut().min_array_size = _min_array_size; }
+        uint32_t get_max_array_size () { return base_layer->max_array_size; }
+        void set_max_array_size (uint32_t _max_array_size) { base_layer.mut().max_array_size = _max_array_size; }
+        const ProbabilityVector<ArrayType::Kind>& get_array_kind_prob () { return base_layer->array_kind_prob; }
+        const ProbabilityVector<Type::TypeID>& get_array_base_type_prob () { return base_layer->array_base_type_prob; }
+        void set_min_array_type_count (uint32_t _min_array_type_count) { base_layer.mut().min_array_type_count = _min_array_type_count; }
+        uint32_t get_min_array_type_count () { return base_layer->min_array_type_count; }
+        void set_max_array_type_count (uint32_t _max_array_type_count) { base_layer.mut().max_array_type_count = _max_array_type_count; }
+        uint32_t get_max_array_type_count () { return base_layer->max_array_type_count; }
+        const ProbabilityVector<ArrayType::ElementSubscript>& get_array_elem_subs_prob () { return base_layer->array_elem_subs_prob; }
 
         // Arithmetic expression tree section - defines depth, operators distribution, kind of leaves
-        void set_max_arith_depth (uint32_t _max_arith_depth) { max_arith_depth = _max_arith_depth; }
-        uint32_t get_max_arith_depth () { return max_arith_depth; }
-        void add_unary_op (Probability<UnaryExpr::Op> prob) { allowed_unary_op.push_back(prob); }
-        std::vector<Probability<UnaryExpr::Op>>& get_allowed_unary_op () { return allowed_unary_op; }
-        void add_binary_op (Probability<BinaryExpr::Op> prob) { allowed_binary_op.push_back(prob); }
-        std::vector<Probability<BinaryExpr::Op>>& get_allowed_binary_op () { return allowed_binary_op; }
-        std::vector<Probability<ArithLeafID>>& get_arith_leaves () { return arith_leaves; }
-        std::vector<Probability<ArithDataID>>& get_arith_data_distr () { return arith_data_distr; }
-        void set_max_total_expr_count(uint32_t max_count) { max_total_expr_count = max_count; }
-        uint32_t get_max_total_expr_count() { return max_total_expr_count; }
-        void set_max_func_expr_count(uint32_t max_count) { max_func_expr_count = max_count; }
-        uint32_t get_max_func_expr_count() { return max_func_expr_count; }
+        void set_max_arith_depth (uint32_t _max_arith_depth) { base_layer.mut().max_arith_depth = _max_arith_depth; }
+        uint32_t get_max_arith_depth () { return base_layer->max_arith_depth; }
+        uint32_t get_max_arith_node_count () { return base_layer->max_arith_node_count; }
+        void add_unary_op (Probability<UnaryExpr::Op> prob) { arith_layer.mut().allowed_unary_op.push_back(prob);
+                                                              reset_arith_ssp_variants(); }
+        const ProbabilityVector<UnaryExpr::Op>& get_allowed_unary_op () { return arith_layer->allowed_unary_op; }
+        void add_binary_op (Probability<BinaryExpr::Op> prob) { arith_layer.mut().allowed_binary_op.push_back(prob);
+                                                                reset_arith_ssp_variants(); }
+        const ProbabilityVector<BinaryExpr::Op>& get_allowed_binary_op () { return arith_layer->allowed_binary_op; }
+        const ProbabilityVector<ArithLeafID>& get_arith_leaves () { return base_layer->arith_leaves; }
+        const ProbabilityVector<ArithDataID>& get_arith_data_distr () { return arith_layer->arith_data_distr; }
+        void set_max_total_expr_count(uint32_t max_count) { base_layer.mut().max_total_expr_count = max_count; }
+        uint32_t get_max_total_expr_count() { return base_layer->max_total_expr_count; }
+        void set_max_func_expr_count(uint32_t max_count) { base_layer.mut().max_func_expr_count = max_count; }
+        uint32_t get_max_func_expr_count() { return base_layer->max_func_expr_count; }
 
         // CSE section
-        void set_max_cse_count (uint32_t _max_cse_count) { max_cse_count = _max_cse_count; }
-        uint32_t get_max_cse_count () { return max_cse_count; }
+        void set_max_cse_count (uint32_t _max_cse_count) { base_layer.mut().max_cse_count = _max_cse_count; }
+        uint32_t get_max_cse_count () { return base_layer->max_cse_count; }
         // TODO: add depth control
-        std::vector<std::shared_ptr<Expr>>& get_cse () { return cse; };
-        void add_cse (std::shared_ptr<Expr> expr) { cse.push_back(expr); }
-        std::vector<Probability<ArithCSEGenID>>& get_arith_cse_gen () { return arith_cse_gen; }
+        const std::vector<std::shared_ptr<Expr>>& get_cse () { return *cse; };
+        void add_cse (std::shared_ptr<Expr> expr) { cse.mut().push_back(expr); }
+        const ProbabilityVector<ArithCSEGenID>& get_arith_cse_gen () { return base_layer->arith_cse_gen; }
 
         // Single statement pattern
-        std::vector<Probability<ArithSSP::ConstUse>>& get_allowed_arith_ssp_const_use () { return allowed_arith_ssp_const_use; }
+        const ProbabilityVector<ArithSSP::ConstUse>& get_allowed_arith_ssp_const_use () { return base_layer->allowed_arith_ssp_const_use; }
         ArithSSP::ConstUse get_chosen_arith_ssp_const_use () { return chosen_arith_ssp_const_use; }
         GenPolicy apply_arith_ssp_const_use (ArithSSP::ConstUse pattern_id);
-        std::vector<Probability<ArithSSP::SimilarOp>>& get_allowed_arith_ssp_similar_op () { return allowed_arith_ssp_similar_op; }
+        const ProbabilityVector<ArithSSP::SimilarOp>& get_allowed_arith_ssp_similar_op () { return base_layer->allowed_arith_ssp_similar_op; }
         ArithSSP::SimilarOp get_chosen_arith_ssp_similar_op () { return chosen_arith_ssp_similar_op; }
         GenPolicy apply_arith_ssp_similar_op (ArithSSP::SimilarOp pattern_id);
 
         // Constant generation
-        uint32_t get_const_buffer_size () { return const_buffer_size; }
-        std::vector<Probability<bool>>& get_new_const_prob () { return new_const_prob; }
-        std::vector<Probability<bool>>& get_new_const_type_prob () { return new_const_type_prob; }
-        std::vector<Probability<ConstPattern::SpecialConst>>& get_special_const_prob () { return special_const_prob; }
-        std::vector<Probability<ConstPattern::NewConstKind>>& get_new_const_kind_prob () { return new_const_kind_prob; }
-        std::vector<Probability<UnaryExpr::Op>>& get_const_transform_prob () { return const_transform_prob; }
+        uint32_t get_const_buffer_size () { return base_layer->const_buffer_size; }
+        const ProbabilityVector<bool>& get_new_const_prob () { return base_layer->new_const_prob; }
+        const ProbabilityVector<bool>& get_new_const_type_prob () { return base_layer->new_const_type_prob; }
+        const ProbabilityVector<ConstPattern::SpecialConst>& get_special_const_prob () { return base_layer->special_const_prob; }
+        const ProbabilityVector<ConstPattern::NewConstKind>& get_new_const_kind_prob () { return base_layer->new_const_kind_prob; }
+        const ProbabilityVector<UnaryExpr::Op>& get_const_transform_prob () { return base_layer->const_transform_prob; }
 
         // Statement section - defines their number (per scope and total), distribution and properties
-        std::vector<Probability<Node::NodeID>>& get_stmt_gen_prob () { return stmt_gen_prob; }
-        void set_min_scope_stmt_count (uint32_t _min_scope_stmt_count) { min_scope_stmt_count = _min_scope_stmt_count; }
-        uint32_t get_min_scope_stmt_count () { return min_scope_stmt_count; }
-        void set_max_scope_stmt_count (uint32_t _max_scope_stmt_count) { max_scope_stmt_count = _max_scope_stmt_count; }
-        uint32_t get_max_scope_stmt_count () { return max_scope_stmt_count; }
-        void set_max_total_stmt_count (uint32_t _max_total_stmt_count) { max_total_stmt_count = _max_total_stmt_count; }
-        uint32_t get_max_total_stmt_count () { return max_total_stmt_count; }
-        void set_max_func_stmt_count (uint32_t _max_func_stmt_count) { max_func_stmt_count = _max_func_stmt_count; }
-        uint32_t get_max_func_stmt_count () { return max_func_stmt_count; }
-        std::vector<Probability<bool>>& get_else_prob () { return else_prob; }
-        void set_max_if_depth (uint32_t _max_if_depth) { max_if_depth = _max_if_depth; }
-        uint32_t get_max_if_depth () { return max_if_depth; }
-        std::vector<Probability<GenPolicy::DeclStmtGenID>>& get_decl_stmt_gen_id_prob() { return decl_stmt_gen_id_prob; }
+        const ProbabilityVector<Node::NodeID>& get_stmt_gen_prob () { return base_layer->stmt_gen_prob; }
+        void set_min_scope_stmt_count (uint32_t _min_scope_stmt_count) { base_layer.mut().min_scope_stmt_count = _min_scope_stmt_count; }
+        uint32_t get_min_scope_stmt_count () { return base_layer->min_scope_stmt_count; }
+        void set_max_scope_stmt_count (uint32_t _max_scope_stmt_count) { base_layer.mut().max_scope_stmt_count = _max_scope_stmt_count; }
+        uint32_t get_max_scope_stmt_count () { return base_layer->max_scope_stmt_count; }
+        void set_max_total_stmt_count (uint32_t _max_total_stmt_count) { base_layer.mut().max_total_stmt_count = _max_total_stmt_count; }
+        uint32_t get_max_total_stmt_count () { return base_layer->max_total_stmt_count; }
+        void set_max_func_stmt_count (uint32_t _max_func_stmt_count) { base_layer.mut().max_func_stmt_count = _max_func_stmt_count; }
+        uint32_t get_max_func_stmt_count () { return base_layer->max_func_stmt_count; }
+        const ProbabilityVector<bool>& get_else_prob () { return base_layer->else_prob; }
+        void set_max_if_depth (uint32_t _max_if_depth) { base_layer.mut().max_if_depth = _max_if_depth; }
+        uint32_t get_max_if_depth () { return base_layer->max_if_depth; }
+        const ProbabilityVector<GenPolicy::DeclStmtGenID>& get_decl_stmt_gen_id_prob() { return base_layer->decl_stmt_gen_id_prob; }
         ///////////////////////////////////////////////////////////////////////
 
     private:
         static bool default_was_loaded;
 
-        // Number of independent test functions in one test
-        uint32_t test_func_count;
-
         // Complexity
         static uint64_t test_complexity;
-        uint64_t max_test_complexity;
-
-        // Types
-        uint32_t num_of_allowed_int_types;
-        std::vector<Probability<IntegerType::IntegerTypeID>> allowed_int_types;
+        static uint64_t func_complexity;
+        static uint64_t reserved_complexity;
+        double estimate_arith_complexity ();
+        double estimate_stmt_complexity (Node::NodeID stmt_id, uint32_t if_depth);
 
-        // cv-qualifiers
         void set_cv_qual(bool value, Type::CV_Qual cv_qual);
         bool get_cv_qual(Type::CV_Qual cv_qual);
-        std::vector<Type::CV_Qual> allowed_cv_qual;
-
-        // Static specifier
-        bool allow_static_var;
-
-        // Struct
-        bool allow_struct;
-        uint32_t min_struct_type_count;
-        uint32_t max_struct_type_count;
-        uint32_t min_struct_member_count;
-        uint32_t max_struct_member_count;
-        bool allow_mix_cv_qual_in_struct;
-        bool allow_mix_static_in_struct;
-        bool allow_mix_types_in_struct;
-        bool allow_static_members;
-        std::vector<Probability<bool>> member_use_prob;
-        std::vector<Probability<Data::VarClassID>> member_class_prob;
-        uint32_t max_struct_depth;
-        uint32_t min_bit_field_size;
-        uint32_t max_bit_field_size;
-        std::vector<Probability<BitFieldID>> bit_field_prob;
-
-        // Variable
-        std::vector<Probability<OutDataTypeID>> out_data_type_prob;
-        std::vector<Probability<OutDataCategoryID>> out_data_category_prob;
-        uint32_t min_inp_var_count;
-        uint32_t max_inp_var_count;
-        uint32_t min_mix_var_count;
-        uint32_t max_mix_var_count;
-        uint32_t min_out_var_count;
-        uint32_t max_out_var_count;
-        uint32_t min_inp_struct_count;
-        uint32_t max_inp_struct_count;
-        uint32_t min_mix_struct_count;
-        uint32_t max_mix_struct_count;
-        uint32_t min_out_struct_count;
-        uint32_t max_out_struct_count;
-        uint32_t min_inp_array_count;
-        uint32_t max_inp_array_count;
-        uint32_t min_mix_array_count;
-        uint32_t max_mix_array_count;
-        uint32_t min_out_array_count;
-        uint32_t max_out_array_count;
-        uint32_t min_inp_ptr_count;
-        uint32_t max_inp_ptr_count;
-        uint32_t min_mix_ptr_count;
-        uint32_t max_mix_ptr_count;
-        uint32_t min_out_ptr_count;
-        uint32_t max_out_ptr_count;
-
-        // Array
-        uint32_t min_array_size;
-        uint32_t max_array_size;
-        std::vector<Probability<ArrayType::Kind>> array_kind_prob;
-        std::vector<Probability<Type::TypeID>> array_base_type_prob;
-        uint32_t min_array_type_count;
-        uint32_t max_array_type_count;
-        std::vector<Probability<ArrayType::ElementSubscript>> array_elem_subs_prob;
-
-        // Arithmetic expression tree
-        uint32_t max_arith_depth;
-        std::vector<Probability<UnaryExpr::Op>> allowed_unary_op;
-        std::vector<Probability<BinaryExpr::Op>> allowed_binary_op;
-        std::vector<Probability<ArithLeafID>> arith_leaves;
-        std::vector<Probability<ArithDataID>> arith_data_distr;
-        uint32_t max_total_expr_count;
-        uint32_t max_func_expr_count;
-
-        // CSE
-        uint32_t max_cse_count;
-        std::vector<Probability<ArithCSEGenID>> arith_cse_gen;
-        std::vector<std::shared_ptr<Expr>> cse;
+
+        // Policy is split into layers, which are shared between copies. Base layer is loaded from config
+        // and almost never changes, so all contexts of a test share it. Arithmetic layer contains distributions,
+        // which are overridden by single statement patterns. Each layer is cloned only on modification (see CowPtr).
+        struct BaseLayer {
+            // Profile, which was used for initialization
+            GenProfile profile;
+
+            // Number of independent test functions in one test
+            uint32_t test_func_count;
+
+            // Complexity
+            uint64_t max_test_complexity;
+
+            // Types
+            uint32_t num_of_allowed_int_types;
+            ProbabilityVector<IntegerType::IntegerTypeID> allowed_int_types;
+
+            // cv-qualifiers
+            std::vector<Type::CV_Qual> allowed_cv_qual;
+
+            // Static specifier
+            bool allow_static_var;
+
+            // Struct
+            bool allow_struct;
+            uint32_t min_struct_type_count;
+            uint32_t max_struct_type_count;
+            uint32_t min_struct_member_count;
+            uint32_t max_struct_member_count;
+            bool allow_mix_cv_qual_in_struct;
+            bool allow_mix_static_in_struct;
+            bool allow_mix_types_in_struct;
+            bool allow_static_members;
+            ProbabilityVector<bool> member_use_prob;
+            ProbabilityVector<Data::VarClassID> member_class_prob;
+            uint32_t max_struct_depth;
+            uint32_t min_bit_field_size;
+            uint32_t max_bit_field_size;
+            ProbabilityVector<BitFieldID> bit_field_prob;
+
+            // Variable
+            ProbabilityVector<OutDataTypeID> out_data_type_prob;
+            ProbabilityVector<OutDataCategoryID> out_data_category_prob;
+            uint32_t min_inp_var_count;
+            uint32_t max_inp_var_count;
+            uint32_t min_mix_var_count;
+            uint32_t max_mix_var_count;
+            uint32_t min_out_var_count;
+            uint32_t max_out_var_count;
+            uint32_t min_inp_struct_count;
+            uint32_t max_inp_struct_count;
+            uint32_t min_mix_struct_count;
+            uint32_t max_mix_struct_count;
+            uint32_t min_out_struct_count;
+            uint32_t max_out_struct_count;
+            uint32_t min_inp_array_count;
+            uint32_t max_inp_array_count;
+            uint32_t min_mix_array_count;
+            uint32_t max_mix_array_count;
+            uint32_t min_out_array_count;
+            uint32_t max_out_array_count;
+            uint32_t min_inp_ptr_count;
+            uint32_t max_inp_ptr_count;
+            uint32_t min_mix_ptr_count;
+            uint32_t max_mix_ptr_count;
+            uint32_t min_out_ptr_count;
+            uint32_t max_out_ptr_count;
+
+            // Array
+            uint32_t min_array_size;
+            uint32_t max_array_size;
+            ProbabilityVector<ArrayType::Kind> array_kind_prob;
+            ProbabilityVector<Type::TypeID> array_base_type_prob;
+            uint32_t min_array_type_count;
+            uint32_t max_array_type_count;
+            ProbabilityVector<ArrayType::ElementSubscript> array_elem_subs_prob;
+
+            // Arithmetic expression tree
+            uint32_t max_arith_depth;
+            uint32_t max_arith_node_count;
+            ProbabilityVector<ArithLeafID> arith_leaves;
+            uint32_t max_total_expr_count;
+            uint32_t max_func_expr_count;
+
+            // CSE
+            uint32_t max_cse_count;
+            ProbabilityVector<ArithCSEGenID> arith_cse_gen;
+
+            // Single statement pattern
+            ProbabilityVector<ArithSSP::ConstUse> allowed_arith_ssp_const_use;
+            ProbabilityVector<ArithSSP::SimilarOp> allowed_arith_ssp_similar_op;
+
+            // Constant generation
+            uint32_t const_buffer_size;
+            ProbabilityVector<bool> new_const_prob;
+            ProbabilityVector<bool> new_const_type_prob;
+            ProbabilityVector<ConstPattern::SpecialConst> special_const_prob;
+            ProbabilityVector<ConstPattern::NewConstKind> new_const_kind_prob;
+            ProbabilityVector<UnaryExpr::Op> const_transform_prob;
+
+            // Statements
+            uint32_t min_scope_stmt_count;
+            uint32_t max_scope_stmt_count;
+            uint32_t max_total_stmt_count;
+            uint32_t max_func_stmt_count;
+            ProbabilityVector<Node::NodeID> stmt_gen_prob;
+            ProbabilityVector<bool> else_prob;
+            uint32_t max_if_depth;
+            ProbabilityVector<GenPolicy::DeclStmtGenID> decl_stmt_gen_id_prob;
+        };
+
+        struct ArithLayer {
+            ProbabilityVector<UnaryExpr::Op> allowed_unary_op;
+            ProbabilityVector<BinaryExpr::Op> allowed_binary_op;
+            ProbabilityVector<ArithDataID> arith_data_distr;
+        };
+
+        // Arithmetic layers with applied single statement patterns, indexed by [ConstUse][SimilarOp].
+        // MAX_CONST_USE and MAX_SIMILAR_OP mean that pattern of this kind isn't applied,
+        // so layers[MAX_CONST_USE][MAX_SIMILAR_OP] is the original arithmetic layer.
+        // The table is shared by all copies of the policy, so each variant is built only once.
+        struct ArithSSPVariants {
+            std::shared_ptr<ArithLayer> layers [ArithSSP::MAX_CONST_USE + 1][ArithSSP::MAX_SIMILAR_OP + 1];
+        };
+
+        static void fill_arith_ssp_const_use (ArithLayer& layer, ArithSSP::ConstUse pattern_id);
+        static void fill_arith_ssp_similar_op (ArithLayer& layer, ArithSSP::SimilarOp pattern_id);
+        CowPtr<ArithLayer> get_arith_ssp_variant (ArithSSP::ConstUse const_use, ArithSSP::SimilarOp similar_op);
+        // Should be called after every modification of original arithmetic layer
+        void reset_arith_ssp_variants () { arith_ssp_variants = std::make_shared<ArithSSPVariants>(); }
+
+        CowPtr<BaseLayer> base_layer;
+        CowPtr<ArithLayer> arith_layer;
+        std::shared_ptr<ArithSSPVariants> arith_ssp_variants;
+        CowPtr<std::vector<std::shared_ptr<Expr>>> cse;
 
         // Single statement pattern
-        std::vector<Probability<ArithSSP::ConstUse>> allowed_arith_ssp_const_use;
         ArithSSP::ConstUse chosen_arith_ssp_const_use;
-        std::vector<Probability<ArithSSP::SimilarOp>> allowed_arith_ssp_similar_op;
         ArithSSP::SimilarOp chosen_arith_ssp_similar_op;
-
-        // Constant generation
-        uint32_t const_buffer_size;
-        std::vector<Probability<bool>> new_const_prob;
-        std::vector<Probability<bool>> new_const_type_prob;
-        std::vector<Probability<ConstPattern::SpecialConst>> special_const_prob;
-        std::vector<Probability<ConstPattern::NewConstKind>> new_const_kind_prob;
-        std::vector<Probability<UnaryExpr::Op>> const_transform_prob;
-
-        // Statements
-        uint32_t min_scope_stmt_count;
-        uint32_t max_scope_stmt_count;
-        uint32_t max_total_stmt_count;
-        uint32_t max_func_stmt_count;
-        std::vector<Probability<Node::NodeID>> stmt_gen_prob;
-        std::vector<Probability<bool>> else_prob;
-        uint32_t max_if_depth;
-        std::vector<Probability<GenPolicy::DeclStmtGenID>> decl_stmt_gen_id_prob;
 };
 
 extern GenPolicy default_gen_policy;
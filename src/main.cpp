@@ -2,6 +2,7 @@
 #include <cstring>
 #include <cstdint>
 #include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <sstream>
@@ -30,6 +31,7 @@ void printVersion () {
 }
 
 extern void self_test();
+extern void bench_scalar_ops(std::ostream& stream);
 
 bool option_starts_with (char* option, const char* test) {
     return !strncmp(option, test, strlen(test));
@@ -49,7 +51,37 @@ void print_usage_and_exit (std::string error_msg = "") {
     std::cout << "\t-q                        Quiet mode\n";
     std::cout << "\t-v, --version             Print oorgen version\n";
     std::cout << "\t-d, --out-dir=<out-dir>   Output directory\n";
-    std::cout << "\t-s, --seed=<seed>         Predefined seed (it is accepted in form of SSS or VV_SSS)\n";
+    std::cout << "\t-s, --seed=<seed>         Predefined seed (it is accepted in form of SSS, VV_SSS or VV_EEE_SSS)\n";
+    std::cout << "\t--rand-engine=<engine>    Pseudo-random engine\n";
+    std::cout << "\t\t\t\t  Default: " << RandValGen::get_engine_name(RandValGen::EngineID::XOSHIRO256SS_X4) <<
+                 " (" << RandValGen::get_engine_name(RandValGen::EngineID::MT19937_64) <<
+                 " for seeds without engine)\n";
+    std::string all_engines = "\t\t\t\t  Possible variants are:";
+    for (const auto &iter : RandValGen::str_to_engine)
+        all_engines += " " + iter.first + ",";
+    all_engines.pop_back();
+    std::cout << all_engines << std::endl;
+    std::cout << "\t--rand-stats              Print statistics of random draws for every call site to stderr\n";
+    std::cout << "\t--arena                   Allocate IR in arena, which is released at once after emission\n";
+    std::cout << "\t--test-func=<N>           Generate only test function tf_N. It is the same as in the full test\n";
+    std::cout << "\t\t\t\t  with the same seed (it isn't supported by " <<
+                 RandValGen::get_engine_name(RandValGen::EngineID::MT19937_64) << ")\n";
+    std::cout << "\t--profile=<profile>       Generation profile: name of preset or path to profile file\n";
+    std::cout << "\t\t\t\t  Default: " << options->profile << "\n";
+    std::string all_presets = "\t\t\t\t  Possible presets are:";
+    for (const auto &iter : GenProfile::presets)
+        all_presets += " " + iter.first + ",";
+    all_presets.pop_back();
+    std::cout << all_presets << std::endl;
+    std::cout << "\t--run-record=<file>       Append description of the run (seed, profile, node counts) to file.\n";
+    std::cout << "\t\t\t\t  Log of such records with added compile_time=<sec> and run_time=<sec>\n";
+    std::cout << "\t\t\t\t  can be used for autotuning\n";
+    std::cout << "\t--autotune=<log>          Fit profile (see --profile) to the target compile and run time,\n";
+    std::cout << "\t\t\t\t  print tuned profile and exit\n";
+    std::cout << "\t--tune-compile-time=<sec> Target compile time for autotuning\n";
+    std::cout << "\t--tune-run-time=<sec>     Target run time for autotuning\n";
+    std::cout << "\t--bench-scalar-ops        Compare performance of operators on scalar values with their reference\n";
+    std::cout << "\t\t\t\t  implementation in the chosen bit mode and standard and exit\n";
     std::cout << "\t-m, --bit-mode=<32/64>    Generated test's bit mode\n";
     std::cout << "\t--std=<standard>          Generated test's language standard\n";
     auto search_for_default_std = [] (const std::pair<std::string, Options::StandardID> &pair) {
@@ -101,12 +133,35 @@ bool parse_long_and_short_args (int argc, int &argv_iter, char** &argv, std::str
            parse_short_args(argc, argv_iter, argv, short_arg, action, error_msg);
 }
 
+// Appends description of the current run to file (see --run-record)
+void write_run_record (std::string file_name) {
+    std::ofstream file (file_name, std::ios::app);
+    if (!file.is_open())
+        ERROR("can't open run record file " + file_name);
+    file << "seed=" << rand_val_gen->get_seed_str() << " profile=" << options->profile <<
+            " complexity=" << GenPolicy::get_test_complexity() << " stmt_count=" << Stmt::get_total_stmt_count() <<
+            " expr_count=" << Expr::get_total_expr_count();
+    GenProfile profile = default_gen_policy.get_profile();
+    for (const auto& knob : GenProfile::knobs)
+        file << " " << knob.first << "=" << profile.*(knob.second);
+    file << std::endl;
+}
+
 // 程序入口
 int main (int argc, char* argv[128]) {
     options = new Options;
     uint64_t seed = 0;
+    // Engine, which was specified in seed or by option
+    std::string seed_engine;
+    bool explicit_seed_engine = false;
+    std::string option_engine;
     std::string out_dir = "./";
     bool quiet = false;
+    std::string run_record_file;
+    std::string autotune_log;
+    double target_compile_time = 0;
+    double target_run_time = 0;
+    bool bench_scalar = false;
 
     // Utility functions. They are necessary for copy-paste reduction. They perform main actions during option parsing.
     // Detects output directory
@@ -117,7 +172,7 @@ int main (int argc, char* argv[128]) {
     };
 
     // 检测预定义的seed
-    auto seed_action = [&seed] (std::string arg) {
+    auto seed_action = [&seed, &seed_engine, &explicit_seed_engine] (std::string arg) {
         size_t *pEnd = nullptr;
         std::stringstream arg_ss(arg);
         std::string segment;
@@ -126,9 +181,18 @@ int main (int argc, char* argv[128]) {
             seed_list.push_back(segment);
 
         if ((seed_list.size() > 1 && seed_list.at(0) != options->plane_oorgen_version) ||
-            seed_list.size() > 2)
+            seed_list.size() > 3)
             ERROR("Incompatible oorgen version in seed: " + arg);
 
+        // Seeds without engine belong to legacy engine
+        seed_engine = RandValGen::get_engine_name(RandValGen::EngineID::MT19937_64);
+        if (seed_list.size() == 3) {
+            explicit_seed_engine = true;
+            seed_engine = seed_list.at(1);
+            if (RandValGen::str_to_engine.find(seed_engine) == RandValGen::str_to_engine.end())
+                print_usage_and_exit("Can't recognize engine in seed: " + arg);
+        }
+
         try {
             seed = std::stoull(seed_list.back(), pEnd, 10);
         }
@@ -165,6 +229,54 @@ int main (int argc, char* argv[128]) {
         }
     };
 
+    // 检测伪随机数引擎
+    auto engine_action = [&option_engine] (std::string arg) {
+        if (RandValGen::str_to_engine.find(arg) == RandValGen::str_to_engine.end())
+            print_usage_and_exit("Can't recognize pseudo-random engine: --rand-engine=" + arg + "\n");
+        option_engine = arg;
+    };
+
+    // 检测生成配置
+    auto profile_action = [] (std::string arg) {
+        options->profile = arg;
+    };
+
+    // 检测单独生成的测试函数
+    auto test_func_action = [] (std::string arg) {
+        try {
+            options->only_test_func = std::stoll(arg);
+        }
+        catch (std::exception& e) {
+            print_usage_and_exit("Can't recognize test function: " + arg);
+        }
+        if (options->only_test_func < 0)
+            print_usage_and_exit("Can't recognize test function: " + arg);
+    };
+
+    auto run_record_action = [&run_record_file] (std::string arg) {
+        run_record_file = arg;
+    };
+
+    auto autotune_action = [&autotune_log] (std::string arg) {
+        autotune_log = arg;
+    };
+
+    // 检测自动调优的目标时间
+    auto time_action = [] (double &time, std::string arg) {
+        try {
+            time = std::stod(arg);
+        }
+        catch (std::exception& e) {
+            print_usage_and_exit("Can't recognize time: " + arg);
+        }
+    };
+    auto compile_time_action = [&time_action, &target_compile_time] (std::string arg) {
+        time_action(target_compile_time, arg);
+    };
+    auto run_time_action = [&time_action, &target_run_time] (std::string arg) {
+        time_action(target_run_time, arg);
+    };
+
     // 解析命令行选项的主循环
     for (int i = 0; i < argc; ++i) {
         if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h")) {
@@ -177,8 +289,31 @@ int main (int argc, char* argv[128]) {
         else if (!strcmp(argv[i], "-q")) {
             quiet = true;
         }
+        else if (!strcmp(argv[i], "--rand-stats")) {
+            RandValGen::enable_stats();
+        }
+        else if (!strcmp(argv[i], "--arena")) {
+            options->use_arena = true;
+        }
+        else if (!strcmp(argv[i], "--bench-scalar-ops")) {
+            bench_scalar = true;
+        }
         else if (parse_long_args(i, argv, "--std", standard_action,
                                  "Can't recognize language standard:")) {}
+        else if (parse_long_args(i, argv, "--rand-engine", engine_action,
+                                 "Can't recognize pseudo-random engine:")) {}
+        else if (parse_long_args(i, argv, "--profile", profile_action,
+                                 "Profile wasn't specified.")) {}
+        else if (parse_long_args(i, argv, "--test-func", test_func_action,
+                                 "Test function wasn't specified.")) {}
+        else if (parse_long_args(i, argv, "--run-record", run_record_action,
+                                 "Run record file wasn't specified.")) {}
+        else if (parse_long_args(i, argv, "--autotune", autotune_action,
+                                 "Run log wasn't specified.")) {}
+        else if (parse_long_args(i, argv, "--tune-compile-time", compile_time_action,
+                                 "Target compile time wasn't specified.")) {}
+        else if (parse_long_args(i, argv, "--tune-run-time", run_time_action,
+                                 "Target run time wasn't specified.")) {}
         else if (parse_long_and_short_args(argc, i, argv, "-d", "--out-dir", out_dir_action,
                                            "Output directory wasn't specified.")) {}
         else if (parse_long_and_short_args(argc, i, argv, "-s", "--seed", seed_action,
@@ -195,9 +330,42 @@ int main (int argc, char* argv[128]) {
         std::cerr << "For help type " << argv [0] << " -h" << std::endl;
     }
 
-    rand_val_gen = std::make_shared<RandValGen>(RandValGen (seed));
+    if (autotune_log != "") {
+        if (target_compile_time <= 0 && target_run_time <= 0)
+            print_usage_and_exit("Autotuning requires --tune-compile-time or --tune-run-time");
+        GenProfile tuned = GenProfile::autotune(GenProfile::load(options->profile), autotune_log,
+                                                target_compile_time, target_run_time, std::cout);
+        tuned.dump(std::cout);
+        exit(0);
+    }
+
+    if (bench_scalar) {
+        bench_scalar_ops(std::cout);
+        exit(0);
+    }
+
+    // Engine from option overrides legacy engine of seeds without engine,
+    // but it can't contradict with engine, which was explicitly specified in seed.
+    RandValGen::EngineID engine_id = RandValGen::EngineID::XOSHIRO256SS_X4;
+    if (option_engine != "") {
+        if (explicit_seed_engine && seed_engine != option_engine)
+            print_usage_and_exit("Engine in seed contradicts with --rand-engine=" + option_engine);
+        engine_id = RandValGen::str_to_engine.at(option_engine);
+    }
+    else if (seed_engine != "")
+        engine_id = RandValGen::str_to_engine.at(seed_engine);
+
+    rand_val_gen = std::make_shared<RandValGen>(RandValGen (seed, engine_id));
     default_gen_policy.init_from_config();
 
+    // Legacy engine generates all test functions from one stream, so one of them can't be generated alone
+    if (options->only_test_func >= 0) {
+        if (engine_id == RandValGen::EngineID::MT19937_64)
+            print_usage_and_exit("--test-func is not supported by " + RandValGen::get_engine_name(engine_id));
+        if (options->only_test_func >= default_gen_policy.get_test_func_count())
+            print_usage_and_exit("There is no test function " + std::to_string(options->only_test_func));
+    }
+
 //    self_test();
 
     Program mas (out_dir);
@@ -206,6 +374,12 @@ int main (int argc, char* argv[128]) {
     mas.emit_decl ();
     mas.emit_main ();
 
+    if (RandValGen::get_collect_stats())
+        RandValGen::dump_stats(std::cerr);
+
+    if (run_record_file != "")
+        write_run_record(run_record_file);
+
     delete(options);
 
     return 0;
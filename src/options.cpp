@@ -9,7 +9,8 @@ Options* oorgen::options;
 
 // 对象初始化默认参数设置
 Options::Options() : standard_id(CXX11), mode_64bit(true),
-                     include_valarray(false), include_vector(false), include_array(false) {
+                     include_valarray(false), include_vector(false), include_array(false),
+                     profile("balanced"), use_arena(false), only_test_func(-1) {
     plane_oorgen_version = oorgen_version;
     plane_oorgen_version.erase(std::remove(plane_oorgen_version.begin(), plane_oorgen_version.end(), '.'),
                                 plane_oorgen_version.end());
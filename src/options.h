@@ -35,6 +35,15 @@ struct Options {
         bool include_valarray;
         bool include_vector;
         bool include_array;
+
+        // 生成配置：预设名称或配置文件路径（见 GenProfile）
+        std::string profile;
+
+        // IR of the test is allocated in arena and is released at once (see Arena)
+        bool use_arena;
+
+        // If it isn't negative, only test function with this number is generated (see Program::generate)
+        int64_t only_test_func;
     };
     
 extern Options *options;
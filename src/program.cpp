@@ -5,6 +5,8 @@ using namespace oorgen;
 
 Program::Program (std::string _out_folder) {
     out_folder = _out_folder;
+    if (options->use_arena)
+        arena.reset(new Arena());
     uint32_t test_func_count = gen_policy.get_test_func_count();
     extern_inp_sym_table.reserve(test_func_count);
     extern_mix_sym_table.reserve(test_func_count);
@@ -13,27 +15,64 @@ Program::Program (std::string _out_folder) {
 }
 
 // It initializes global Context and launches generation process.
+// Every test function is generated with its own random stream, so it doesn't depend on the previous ones
+// and can be regenerated alone (see Options::only_test_func).
+// Legacy engine uses single stream for all functions to reproduce old seeds.
 void Program::generate () {
+    ArenaScope arena_scope (arena.get());
     NameHandler& name_handler = NameHandler::get_instance();
-    for (unsigned int i = 0; i < gen_policy.get_test_func_count(); ++i) {
-        name_handler.set_test_func_prefix(i);
+    std::shared_ptr<RandValGen> master_rand_val_gen = rand_val_gen;
+    bool use_streams = master_rand_val_gen->get_engine_id() != RandValGen::EngineID::MT19937_64;
+    uint32_t test_func_count = gen_policy.get_test_func_count();
+    for (unsigned int i = 0; i < test_func_count; ++i) {
+        extern_inp_sym_table.push_back(ir_make_shared<SymbolTable>());
+        extern_mix_sym_table.push_back(ir_make_shared<SymbolTable>());
+        extern_out_sym_table.push_back(ir_make_shared<SymbolTable>());
+        // Complexity predictions depend on the statements of the previous functions (see GenPolicy),
+        // so they are generated even if they aren't needed
+        bool has_complexity_budget = gen_policy.get_max_func_complexity() != UINT64_MAX;
+        if (!is_generated(i) && (!has_complexity_budget || options->only_test_func < i)) {
+            functions.push_back(nullptr);
+            continue;
+        }
 
-        extern_inp_sym_table.push_back(std::make_shared<SymbolTable>());
-        extern_mix_sym_table.push_back(std::make_shared<SymbolTable>());
-        extern_out_sym_table.push_back(std::make_shared<SymbolTable>());
+        name_handler.set_test_func_prefix(i);
+        if (use_streams)
+            rand_val_gen = master_rand_val_gen->get_stream(i);
+
+        // Every function gets an even share of complexity budget (see GenPolicy::get_max_func_complexity)
+        GenPolicy::zero_out_func_complexity();
+
+        // Limits on total number of statements and expressions are split evenly too,
+        // so the function doesn't depend on the previous ones
+        GenPolicy func_gen_policy = gen_policy;
+        if (use_streams) {
+            func_gen_policy.set_max_func_stmt_count(std::min(gen_policy.get_max_func_stmt_count(),
+                                                             gen_policy.get_max_total_stmt_count() / test_func_count));
+            func_gen_policy.set_max_total_stmt_count(UINT32_MAX);
+            func_gen_policy.set_max_func_expr_count(std::min(gen_policy.get_max_func_expr_count(),
+                                                             gen_policy.get_max_total_expr_count() / test_func_count));
+            func_gen_policy.set_max_total_expr_count(UINT32_MAX);
+        }
 
-        Context ctx(gen_policy, nullptr, Node::NodeID::MAX_STMT_ID, true);
+        Context ctx(func_gen_policy, nullptr, Node::NodeID::MAX_STMT_ID, true);
         ctx.set_extern_inp_sym_table(extern_inp_sym_table.back());
         ctx.set_extern_mix_sym_table(extern_mix_sym_table.back());
         ctx.set_extern_out_sym_table(extern_out_sym_table.back());
-        std::shared_ptr<Context> ctx_ptr = std::make_shared<Context>(ctx);
+        std::shared_ptr<Context> ctx_ptr = ir_make_shared<Context>(ctx);
         form_extern_sym_table(ctx_ptr);
-        functions.push_back(ScopeStmt::generate(ctx_ptr));
+        std::shared_ptr<ScopeStmt> function = ScopeStmt::generate(ctx_ptr);
+        functions.push_back(is_generated(i) ? function : nullptr);
 
         name_handler.zero_out_counters();
         Stmt::zero_out_func_stmt_count();
         Expr::zero_out_func_expr_count();
     }
+    rand_val_gen = master_rand_val_gen;
+}
+
+bool Program::is_generated (uint32_t test_func_id) {
+    return options->only_test_func < 0 || options->only_test_func == test_func_id;
 }
 
 // Utility function which generates pointers (including nested)
@@ -42,10 +81,11 @@ void Program::generate () {
 // only_invariants 允许排除指向非 const 成员的指针
 inline void ptr_generation (const std::shared_ptr<SymbolTable> &sym_table, uint32_t min_count,
                             uint32_t max_count, bool only_invariants) {
+    RAND_CALL_SITE("ptr_generation");
     NameHandler& name_handler = NameHandler::get_instance();
 
     // Collect all suitable VarUseExpr and MemberExpr
-    std::vector<std::shared_ptr<Expr>> all_var_use_exprs = sym_table->get_all_var_use_exprs(true);
+    InpExprIndex all_var_use_exprs = sym_table->get_all_var_use_exprs(true);
 
     std::vector<std::shared_ptr<MemberExpr>>& members_in_structs =
             only_invariants ? sym_table->get_const_members_in_structs() : sym_table->get_members_in_structs() ;
@@ -68,7 +108,7 @@ inline void ptr_generation (const std::shared_ptr<SymbolTable> &sym_table, uint3
     // Choose number of pointers
     uint32_t ptr_count = rand_val_gen->get_rand_value(min_count, max_count);
     for (uint32_t i = 0; i < ptr_count; ++i) {
-        std::shared_ptr<Expr>& picked_expr = rand_val_gen->get_rand_elem(all_var_use_exprs);
+        std::shared_ptr<Expr> picked_expr = rand_val_gen->get_rand_elem(all_var_use_exprs);
 
         // Extract shared_ptr to raw value of picked expression
         std::shared_ptr<Data> data;
@@ -84,18 +124,19 @@ inline void ptr_generation (const std::shared_ptr<SymbolTable> &sym_table, uint3
             ERROR("bad NodeID");
 
         // Create new pointer
-        std::shared_ptr<Pointer> new_ptr = std::make_shared<Pointer>(name_handler.get_ptr_var_name(), data);
+        std::shared_ptr<Pointer> new_ptr = ir_make_shared<Pointer>(name_handler.get_ptr_var_name(), data);
         sym_table->add_pointer(new_ptr, picked_expr);
-        all_var_use_exprs.push_back(std::make_shared<VarUseExpr>(new_ptr));
+        all_var_use_exprs.push_back(ir_make_shared<VarUseExpr>(new_ptr));
     }
 }
 
 // This function initially fills extern symbol table with inp and mix variables. It also creates type structs definitions.
 // 此函数最初使用输入和混合变量填充 extern 符号表。创建包括基本变量、结构体、array和指针
 void Program::form_extern_sym_table(std::shared_ptr<Context> ctx) {
+    RAND_CALL_SITE("Program::form_extern_sym_table");
     auto p = ctx->get_gen_policy();
     // Allow const cv-qualifier in gen_policy, pass it to new Context
-    std::shared_ptr<Context> const_ctx = std::make_shared<Context>(*(ctx));
+    std::shared_ptr<Context> const_ctx = ir_make_shared<Context>(*(ctx));
     GenPolicy const_gen_policy = *(const_ctx->get_gen_policy());
     const_gen_policy.set_allow_const(true);
     const_ctx->set_gen_policy(const_gen_policy);
@@ -213,6 +254,9 @@ void Program::form_extern_sym_table(std::shared_ptr<Context> ctx) {
 
     // Same for output pointers
     ptr_generation(ctx->get_extern_out_sym_table(), p->get_min_out_ptr_count(), p->get_max_out_ptr_count(), false);
+
+    // All output data is ready, so we can form pools of assignment targets
+    ctx->get_extern_out_sym_table()->form_out_slot_pools();
 }
 
 static std::string get_file_ext () {
@@ -225,6 +269,7 @@ static std::string get_file_ext () {
 
 // 输出声明
 void Program::emit_decl () {
+    ArenaScope arena_scope (arena.get());
     std::ofstream out_file;
     // 打开文件
     out_file.open(out_folder + "/" + "init.h");
@@ -238,6 +283,8 @@ void Program::emit_decl () {
 
     // 输出初始化后的变量
     for (unsigned int i = 0; i < gen_policy.get_test_func_count(); ++i) {
+        if (!is_generated(i))
+            continue;
         extern_inp_sym_table.at(i)->emit_variable_extern_decl(out_file);
         out_file << "\n\n";
         extern_mix_sym_table.at(i)->emit_variable_extern_decl(out_file);
@@ -272,11 +319,14 @@ void Program::emit_decl () {
 
 // 输出函数
 void Program::emit_func () {
+    ArenaScope arena_scope (arena.get());
     std::ofstream out_file;
     out_file.open(out_folder + "/" + "func." + get_file_ext());
     out_file << "#include \"init.h\"\n\n";
 
     for (unsigned int i = 0; i < gen_policy.get_test_func_count(); ++i) {
+        if (!is_generated(i))
+            continue;
         out_file << "void " << NameHandler::common_test_func_prefix << i << "_foo ()\n";
         functions.at(i)->emit(out_file);
         out_file << "\n";
@@ -286,6 +336,7 @@ void Program::emit_func () {
 
 // 输出main函数
 void Program::emit_main () {
+    ArenaScope arena_scope (arena.get());
     std::ofstream out_file;
     out_file.open(out_folder + "/" + "driver." + get_file_ext());
 
@@ -296,15 +347,15 @@ void Program::emit_main () {
 
     // Hash
     //////////////////////////////////////////////////////////
-    std::shared_ptr<ScalarVariable> seed = std::make_shared<ScalarVariable>("seed", IntegerType::init(
+    std::shared_ptr<ScalarVariable> seed = ir_make_shared<ScalarVariable>("seed", IntegerType::init(
                                                                             Type::IntegerTypeID::ULLINT));
-    std::shared_ptr<VarUseExpr> seed_use = std::make_shared<VarUseExpr>(seed);
+    std::shared_ptr<VarUseExpr> seed_use = ir_make_shared<VarUseExpr>(seed);
 
     BuiltinType::ScalarTypedVal zero_init(Type::IntegerTypeID::ULLINT);
     zero_init.val.ullint_val = 0;
-    std::shared_ptr<ConstExpr> const_init = std::make_shared<ConstExpr>(zero_init);
+    std::shared_ptr<ConstExpr> const_init = ir_make_shared<ConstExpr>(zero_init);
 
-    std::shared_ptr<DeclStmt> seed_decl = std::make_shared<DeclStmt>(seed, const_init);
+    std::shared_ptr<DeclStmt> seed_decl = ir_make_shared<DeclStmt>(seed, const_init);
     seed_decl->emit(out_file);
     out_file << "\n\n";
 
@@ -313,6 +364,8 @@ void Program::emit_main () {
     out_file << "}\n\n";
 
     for (unsigned int i = 0; i < gen_policy.get_test_func_count(); ++i) {
+        if (!is_generated(i))
+            continue;
         // Definitions and initialization
         //////////////////////////////////////////////////////////
         extern_inp_sym_table.at(i)->emit_variable_def(out_file);
@@ -349,6 +402,9 @@ void Program::emit_main () {
         extern_inp_sym_table.at(i)->emit_struct_init(out_file, "    ");
         extern_mix_sym_table.at(i)->emit_struct_init(out_file, "    ");
         extern_out_sym_table.at(i)->emit_struct_init(out_file, "    ");
+        extern_inp_sym_table.at(i)->emit_array_init(out_file, "    ");
+        extern_mix_sym_table.at(i)->emit_array_init(out_file, "    ");
+        extern_out_sym_table.at(i)->emit_array_init(out_file, "    ");
         out_file << "}\n\n";
 
         // Check
@@ -382,6 +438,8 @@ void Program::emit_main () {
     out_file << "int main () {\n";
     std::string tf_prefix;
     for (unsigned int i = 0; i < gen_policy.get_test_func_count(); ++i) {
+        if (!is_generated(i))
+            continue;
         tf_prefix = NameHandler::common_test_func_prefix + std::to_string(i) + "_";
         out_file << "    " << tf_prefix << "init ();\n";
         out_file << "    " << tf_prefix << "foo ();\n";
@@ -39,7 +39,12 @@ class Program {
     private:
 
         void form_extern_sym_table(std::shared_ptr<Context> ctx);
+        // All test functions are generated, unless only one of them was requested (see Options::only_test_func)
+        bool is_generated (uint32_t test_func_id);
 
+        // Arena for all IR of the test (if Options::use_arena is set). Generation and emission allocate in it.
+        // It is declared first, so it is destroyed after everything, which can refer to it.
+        std::unique_ptr<Arena> arena;
         GenPolicy gen_policy;
         std::vector<std::shared_ptr<ScopeStmt>> functions;
         // There are three kind of global variables which exist in test.
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace oorgen {
+
+// Pseudo-random engines, which can be used by RandValGen instead of std::mt19937_64.
+// Unlike standard distributions, everything here is fully specified by its algorithm,
+// so the same seed produces the same sequence with any compiler and standard library.
+
+// Full 128-bit product of two 64-bit values
+inline void mul_64x64_128 (uint64_t a, uint64_t b, uint64_t &hi, uint64_t &lo) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 res = (unsigned __int128) a * b;
+    hi = (uint64_t) (res >> 64);
+    lo = (uint64_t) res;
+#else
+    uint64_t a_lo = a & 0xFFFFFFFF;
+    uint64_t a_hi = a >> 32;
+    uint64_t b_lo = b & 0xFFFFFFFF;
+    uint64_t b_hi = b >> 32;
+
+    uint64_t lo_lo = a_lo * b_lo;
+    uint64_t hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi;
+    uint64_t hi_hi = a_hi * b_hi;
+
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    lo = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+#endif
+}
+
+// SplitMix64 is used to expand user's seed to the state of other engines
+inline uint64_t splitmix64 (uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256** 1.0 by David Blackman and Sebastiano Vigna
+class Xoshiro256StarStar {
+    public:
+        Xoshiro256StarStar () { seed(0); }
+
+        void seed (uint64_t _seed) {
+            uint64_t sm_state = _seed;
+            for (auto &i : state)
+                i = splitmix64(sm_state);
+        }
+
+        // Fills buf with next count values
+        void fill (uint64_t* buf, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                buf[i] = (*this)();
+        }
+
+        uint64_t operator() () {
+            uint64_t ret = rotl(state[1] * 5, 7) * 9;
+            uint64_t t = state[1] << 17;
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = rotl(state[3], 45);
+            return ret;
+        }
+
+    private:
+        static uint64_t rotl (uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        uint64_t state [4];
+};
+
+// Four interleaved xoshiro256** generators, which are advanced simultaneously.
+// Output is lane 0, lane 1, lane 2, lane 3, lane 0, ... - it is the same for AVX2 and scalar implementation,
+// only the speed differs. Values can be produced only in blocks, which are multiple of LANES.
+class Xoshiro256StarStarX4 {
+    public:
+        static const size_t LANES = 4;
+
+        Xoshiro256StarStarX4 () { seed(0); }
+
+        void seed (uint64_t _seed) {
+            uint64_t sm_state = _seed;
+            for (size_t j = 0; j < LANES; ++j)
+                for (size_t k = 0; k < 4; ++k)
+                    state[k][j] = splitmix64(sm_state);
+        }
+
+        void fill (uint64_t* buf, size_t count) {
+#ifdef __AVX2__
+            __m256i s0 = _mm256_loadu_si256((const __m256i*) state[0]);
+            __m256i s1 = _mm256_loadu_si256((const __m256i*) state[1]);
+            __m256i s2 = _mm256_loadu_si256((const __m256i*) state[2]);
+            __m256i s3 = _mm256_loadu_si256((const __m256i*) state[3]);
+            for (size_t i = 0; i < count; i += LANES) {
+                // AVX2 doesn't have 64-bit multiplication, so x * 5 and x * 9 are computed with shifts
+                __m256i mul5 = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+                __m256i rot = _mm256_or_si256(_mm256_slli_epi64(mul5, 7), _mm256_srli_epi64(mul5, 57));
+                __m256i ret = _mm256_add_epi64(_mm256_slli_epi64(rot, 3), rot);
+                _mm256_storeu_si256((__m256i*) (buf + i), ret);
+
+                __m256i t = _mm256_slli_epi64(s1, 17);
+                s2 = _mm256_xor_si256(s2, s0);
+                s3 = _mm256_xor_si256(s3, s1);
+                s1 = _mm256_xor_si256(s1, s2);
+                s0 = _mm256_xor_si256(s0, s3);
+                s2 = _mm256_xor_si256(s2, t);
+                s3 = _mm256_or_si256(_mm256_slli_epi64(s3, 45), _mm256_srli_epi64(s3, 19));
+            }
+            _mm256_storeu_si256((__m256i*) state[0], s0);
+            _mm256_storeu_si256((__m256i*) state[1], s1);
+            _mm256_storeu_si256((__m256i*) state[2], s2);
+            _mm256_storeu_si256((__m256i*) state[3], s3);
+#else
+            for (size_t i = 0; i < count; i += LANES)
+                for (size_t j = 0; j < LANES; ++j) {
+                    buf[i + j] = rotl(state[1][j] * 5, 7) * 9;
+                    uint64_t t = state[1][j] << 17;
+                    state[2][j] ^= state[0][j];
+                    state[3][j] ^= state[1][j];
+                    state[1][j] ^= state[2][j];
+                    state[0][j] ^= state[3][j];
+                    state[2][j] ^= t;
+                    state[3][j] = rotl(state[3][j], 45);
+                }
+#endif
+        }
+
+    private:
+        static uint64_t rotl (uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        // state[k][j] is k-th word of state of j-th lane
+        uint64_t state [4][LANES];
+};
+
+// PCG64 (XSL-RR output function over 128-bit LCG) by Melissa O'Neill.
+// 128-bit arithmetic is emulated with pairs of 64-bit values.
+class PCG64 {
+    public:
+        PCG64 () { seed(0); }
+
+        void seed (uint64_t _seed) {
+            uint64_t sm_state = _seed;
+            uint64_t init_state_hi = splitmix64(sm_state);
+            uint64_t init_state_lo = splitmix64(sm_state);
+            uint64_t init_seq_hi = splitmix64(sm_state);
+            uint64_t init_seq_lo = splitmix64(sm_state);
+
+            state_hi = state_lo = 0;
+            inc_hi = (init_seq_hi << 1) | (init_seq_lo >> 63);
+            inc_lo = (init_seq_lo << 1) | 1;
+            step();
+            add_128(state_hi, state_lo, init_state_hi, init_state_lo);
+            step();
+        }
+
+        // Fills buf with next count values
+        void fill (uint64_t* buf, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                buf[i] = (*this)();
+        }
+
+        uint64_t operator() () {
+            step();
+            uint64_t xored = state_hi ^ state_lo;
+            uint32_t rot = state_hi >> 58;
+            return (xored >> rot) | (xored << ((64 - rot) & 63));
+        }
+
+    private:
+        static const uint64_t MULT_HI = 0x2360ED051FC65DA4ULL;
+        static const uint64_t MULT_LO = 0x4385DF649FCCF645ULL;
+
+        static void add_128 (uint64_t &hi, uint64_t &lo, uint64_t add_hi, uint64_t add_lo) {
+            uint64_t new_lo = lo + add_lo;
+            hi += add_hi + (new_lo < lo);
+            lo = new_lo;
+        }
+
+        // state = state * MULT + inc (mod 2^128)
+        void step () {
+            uint64_t prod_hi = 0;
+            uint64_t prod_lo = 0;
+            mul_64x64_128(state_lo, MULT_LO, prod_hi, prod_lo);
+            prod_hi += state_hi * MULT_LO + state_lo * MULT_HI;
+            state_hi = prod_hi;
+            state_lo = prod_lo;
+            add_128(state_hi, state_lo, inc_hi, inc_lo);
+        }
+
+        uint64_t state_hi;
+        uint64_t state_lo;
+        uint64_t inc_hi;
+        uint64_t inc_lo;
+};
+}
@@ -0,0 +1,763 @@
+#include <chrono>
+#include <climits>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "options.h"
+#include "type.h"
+#include "util.h"
+
+using namespace oorgen;
+
+// Microbenchmark of BuiltinType::ScalarTypedVal operators (see bench_scalar_ops).
+// Below is the previous implementation of some operators, which dispatches through switches over IntegerTypeID.
+
+#define LINT_DOUBLE_OPT(op, sign)                                                                   \
+    if (options->mode_64bit)                                                                        \
+        ret.val.sign##lint64_val = lhs.val.sign##lint64_val op rhs.val.sign##lint64_val;            \
+    else                                                                                            \
+        ret.val.sign##lint32_val = lhs.val.sign##lint32_val op rhs.val.sign##lint32_val;
+
+static BuiltinType::ScalarTypedVal legacy_add (BuiltinType::ScalarTypedVal lhs, BuiltinType::ScalarTypedVal rhs) {
+    BuiltinType::ScalarTypedVal ret = lhs;
+
+    int64_t s_tmp = 0;
+    uint64_t u_tmp = 0;
+
+    switch (lhs.get_int_type_id()) {
+        case IntegerType::IntegerTypeID::BOOL:
+        case IntegerType::IntegerTypeID::CHAR:
+        case IntegerType::IntegerTypeID::UCHAR:
+        case IntegerType::IntegerTypeID::SHRT:
+        case IntegerType::IntegerTypeID::USHRT:
+        case IntegerType::IntegerTypeID::MAX_INT_ID:
+            ERROR("perform propagate_type (BuiltinType::ScalarTypedVal)");
+        case IntegerType::IntegerTypeID::INT:
+            s_tmp = (long long int) lhs.val.int_val + (long long int) rhs.val.int_val;
+            if (s_tmp < INT_MIN || s_tmp > INT_MAX)
+                ret.set_ub(SignOvf);
+            else
+                ret.val.int_val = (int) s_tmp;
+            break;
+        case IntegerType::IntegerTypeID::UINT:
+            ret.val.uint_val = lhs.val.uint_val + rhs.val.uint_val;
+            break;
+        case IntegerType::IntegerTypeID::LINT:
+            if (options->mode_64bit) {
+                uint64_t ua = lhs.val.lint64_val;
+                uint64_t ub = rhs.val.lint64_val;
+                u_tmp = ua + ub;
+                ua = (ua >> 63) + LLONG_MAX;
+                if ((int64_t) ((ua ^ ub) | ~(ub ^ u_tmp)) >= 0)
+                    ret.set_ub(SignOvf);
+                else
+                    ret.val.lint64_val = (long long int) u_tmp;
+            }
+            else {
+                s_tmp = (long long int) lhs.val.lint32_val + (long long int) rhs.val.lint32_val;
+                if (s_tmp < INT_MIN || s_tmp > INT_MAX)
+                    ret.set_ub(SignOvf);
+                else
+                    ret.val.lint32_val = (int) s_tmp;
+            }
+            break;
+        case IntegerType::IntegerTypeID::ULINT:
+            LINT_DOUBLE_OPT(+, u);
+            break;
+        case IntegerType::IntegerTypeID::LLINT:
+        {
+            uint64_t ua = lhs.val.llint_val;
+            uint64_t ub = rhs.val.llint_val;
+            u_tmp = ua + ub;
+            ua = (ua >> 63) + LLONG_MAX;
+            if ((int64_t) ((ua ^ ub) | ~(ub ^ u_tmp)) >= 0)
+                ret.set_ub(SignOvf);
+            else
+                ret.val.llint_val =  lhs.val.llint_val + rhs.val.llint_val;
+            break;
+        }
+        case IntegerType::IntegerTypeID::ULLINT:
+            ret.val.ullint_val = lhs.val.ullint_val + rhs.val.ullint_val;
+            break;
+    }
+    return ret;
+}
+
+static bool check_int64_mul (int64_t a, int64_t b, int64_t* res) {
+    uint64_t ret = 0;
+
+    int8_t sign = (((a > 0) && (b > 0)) || ((a < 0) && (b < 0))) ? 1 : -1;
+    uint64_t a_abs = 0;
+    uint64_t b_abs = 0;
+
+    if (a == INT64_MIN)
+        // Operation "-" is undefined for "INT64_MIN", as it causes overflow.
+        // But converting INT64_MIN to unsigned type yields the correct result,
+        // i.e. it will be positive value -INT64_MIN.
+        // See 6.3.1.3 section in C99 standart for more details
+        a_abs = (uint64_t) INT64_MIN;
+    else
+        a_abs = (a > 0) ? a : -a;
+
+    if (b == INT64_MIN)
+        b_abs = (uint64_t) INT64_MIN;
+    else
+        b_abs = (b > 0) ? b : -b;
+
+    uint32_t a0 = a_abs & 0xFFFFFFFF;
+    uint32_t b0 = b_abs & 0xFFFFFFFF;
+    uint32_t a1 = a_abs >> 32;
+    uint32_t b1 = b_abs >> 32;
+
+    if ((a1 != 0) && (b1 != 0))
+        return false;
+
+    uint64_t tmp = (((uint64_t) a1) * b0) + (((uint64_t) b1) * a0);
+    if (tmp > 0xFFFFFFFF)
+        return false;
+
+    ret = (tmp << 32) + (((uint64_t) a0) * b0);
+    if (ret < (tmp << 32))
+        return false;
+
+    if ((sign < 0) && (ret > (uint64_t) INT64_MIN)) {
+        return false;
+    } else if ((sign > 0) && (ret > INT64_MAX)) {
+        return false;
+    } else {
+        *res = ret * sign;
+    }
+    return true;
+}
+
+static BuiltinType::ScalarTypedVal legacy_mul (BuiltinType::ScalarTypedVal lhs, BuiltinType::ScalarTypedVal rhs) {
+    BuiltinType::ScalarTypedVal ret = lhs;
+
+    int64_t s_tmp = 0;
+
+    switch (lhs.get_int_type_id()) {
+        case IntegerType::IntegerTypeID::BOOL:
+        case IntegerType::IntegerTypeID::CHAR:
+        case IntegerType::IntegerTypeID::UCHAR:
+        case IntegerType::IntegerTypeID::SHRT:
+        case IntegerType::IntegerTypeID::USHRT:
+        case IntegerType::IntegerTypeID::MAX_INT_ID:
+            ERROR("perform propagate_type (BuiltinType::ScalarTypedVal)");
+        case IntegerType::IntegerTypeID::INT:
+            s_tmp = (long long int) lhs.val.int_val * (long long int) rhs.val.int_val;
+            if ((int) lhs.val.int_val == INT_MIN && (int) rhs.val.int_val == -1)
+                ret.set_ub(SignOvfMin);
+            else if (s_tmp < INT_MIN || s_tmp > INT_MAX)
+                ret.set_ub(SignOvf);
+            else
+                ret.val.int_val = (int) s_tmp;
+            break;
+        case IntegerType::IntegerTypeID::UINT:
+            ret.val.uint_val = lhs.val.uint_val * rhs.val.uint_val;
+            break;
+        case IntegerType::IntegerTypeID::LINT:
+            if (options->mode_64bit) {
+                if (!check_int64_mul(lhs.val.lint64_val, rhs.val.lint64_val, &s_tmp))
+                    ret.set_ub(SignOvf);
+                else
+                    ret.val.lint64_val = (long long int) s_tmp;
+            }
+            else {
+                s_tmp = (long long int) lhs.val.lint32_val * (long long int) rhs.val.lint32_val;
+                if (s_tmp < INT_MIN || s_tmp > INT_MAX)
+                    ret.set_ub(SignOvf);
+                else
+                    ret.val.lint32_val = (int) s_tmp;
+            }
+            break;
+        case IntegerType::IntegerTypeID::ULINT:
+            LINT_DOUBLE_OPT(*, u);
+            break;
+        case IntegerType::IntegerTypeID::LLINT:
+            if ((long long int) lhs.val.llint_val == LLONG_MIN && (long long int) rhs.val.llint_val == -1)
+                ret.set_ub(SignOvfMin);
+            else if (!check_int64_mul(lhs.val.llint_val, rhs.val.llint_val, &s_tmp))
+                ret.set_ub(SignOvfMin);
+            else
+                ret.val.llint_val = (long long int) s_tmp;
+            break;
+        case IntegerType::IntegerTypeID::ULLINT:
+            ret.val.ullint_val = lhs.val.ullint_val * rhs.val.ullint_val;
+            break;
+    }
+    return ret;
+}
+
+#define LegacyCmpOp(__name__, __op__)                                                               \
+static BuiltinType::ScalarTypedVal __name__ (BuiltinType::ScalarTypedVal lhs, BuiltinType::ScalarTypedVal rhs) { \
+    BuiltinType::ScalarTypedVal ret = BuiltinType::ScalarTypedVal(Type::IntegerTypeID::BOOL);       \
+                                                                                                    \
+    switch (lhs.get_int_type_id()) {                                                                \
+        case IntegerType::IntegerTypeID::BOOL:                                                      \
+            ret.val.bool_val = lhs.val.bool_val __op__ rhs.val.bool_val;                            \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::CHAR:                                                      \
+            ret.val.bool_val = lhs.val.char_val __op__ rhs.val.char_val;                            \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::UCHAR:                                                     \
+            ret.val.bool_val = lhs.val.uchar_val __op__ rhs.val.uchar_val;                          \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::SHRT:                                                      \
+            ret.val.bool_val = lhs.val.shrt_val __op__ rhs.val.shrt_val;                            \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::USHRT:                                                     \
+            ret.val.bool_val = lhs.val.ushrt_val __op__ rhs.val.ushrt_val;                          \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::INT:                                                       \
+            ret.val.bool_val = lhs.val.int_val __op__ rhs.val.int_val;                              \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::UINT:                                                      \
+            ret.val.bool_val = lhs.val.uint_val __op__ rhs.val.uint_val;                            \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::LINT:                                                      \
+            if (options->mode_64bit)                                                                \
+                ret.val.bool_val = lhs.val.lint64_val __op__ rhs.val.lint64_val;                    \
+            else                                                                                    \
+                ret.val.bool_val = lhs.val.lint32_val __op__ rhs.val.lint32_val;                    \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::ULINT:                                                     \
+            if (options->mode_64bit)                                                                \
+                ret.val.bool_val = lhs.val.ulint64_val __op__ rhs.val.ulint64_val;                  \
+            else                                                                                    \
+                ret.val.bool_val = lhs.val.ulint32_val __op__ rhs.val.ulint32_val;                  \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::LLINT:                                                     \
+            ret.val.bool_val = lhs.val.llint_val __op__ rhs.val.llint_val;                          \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::ULLINT:                                                    \
+            ret.val.bool_val = lhs.val.ullint_val __op__ rhs.val.ullint_val;                        \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::MAX_INT_ID:                                                \
+            ERROR("perform propagate_type (BuiltinType::ScalarTypedVal)");                          \
+    }                                                                                               \
+    return ret;                                                                                     \
+}
+
+LegacyCmpOp(legacy_less, <)
+
+#define LegacyLogOp(__name__, __op__)                                                               \
+static BuiltinType::ScalarTypedVal __name__ (BuiltinType::ScalarTypedVal lhs, BuiltinType::ScalarTypedVal rhs) { \
+    Type::IntegerTypeID ret_type_id = Type::IntegerTypeID::BOOL;                                    \
+    if (options->is_c())                                                                            \
+        ret_type_id = Type::IntegerTypeID::INT;                                                     \
+    BuiltinType::ScalarTypedVal ret = BuiltinType::ScalarTypedVal(ret_type_id);                     \
+                                                                                                    \
+    switch (lhs.get_int_type_id()) {                                                                \
+        case IntegerType::IntegerTypeID::BOOL:                                                      \
+            if (options->is_cxx()) {                                                                \
+                ret.val.bool_val = lhs.val.bool_val __op__ rhs.val.bool_val;                        \
+                break;                                                                              \
+            }                                                                                       \
+        case IntegerType::IntegerTypeID::INT:                                                       \
+            if (options->is_c()) {                                                                  \
+                ret.val.int_val = lhs.val.int_val __op__ rhs.val.int_val;                           \
+                break;                                                                              \
+            }                                                                                       \
+        case IntegerType::IntegerTypeID::CHAR:                                                      \
+        case IntegerType::IntegerTypeID::UCHAR:                                                     \
+        case IntegerType::IntegerTypeID::SHRT:                                                      \
+        case IntegerType::IntegerTypeID::USHRT:                                                     \
+        case IntegerType::IntegerTypeID::UINT:                                                      \
+        case IntegerType::IntegerTypeID::LINT:                                                      \
+        case IntegerType::IntegerTypeID::ULINT:                                                     \
+        case IntegerType::IntegerTypeID::LLINT:                                                     \
+        case IntegerType::IntegerTypeID::ULLINT:                                                    \
+        case IntegerType::IntegerTypeID::MAX_INT_ID:                                                \
+            ERROR("perform propagate_type (BuiltinType::ScalarTypedVal)");                          \
+    }                                                                                               \
+    return ret;                                                                                     \
+}
+
+LegacyLogOp(legacy_log_and, &&)
+
+#define LegacyBitOp(__name__, __op__)                                                               \
+static BuiltinType::ScalarTypedVal __name__ (BuiltinType::ScalarTypedVal lhs, BuiltinType::ScalarTypedVal rhs) { \
+    BuiltinType::ScalarTypedVal ret = lhs;                                                          \
+                                                                                                    \
+    switch (lhs.get_int_type_id()) {                                                                \
+        case IntegerType::IntegerTypeID::BOOL:                                                      \
+        case IntegerType::IntegerTypeID::CHAR:                                                      \
+        case IntegerType::IntegerTypeID::UCHAR:                                                     \
+        case IntegerType::IntegerTypeID::SHRT:                                                      \
+        case IntegerType::IntegerTypeID::USHRT:                                                     \
+        case IntegerType::IntegerTypeID::MAX_INT_ID:                                                \
+            ERROR("perform propagate_type (BuiltinType::ScalarTypedVal)");                          \
+        case IntegerType::IntegerTypeID::INT:                                                       \
+            ret.val.int_val = lhs.val.int_val __op__ rhs.val.int_val;                               \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::UINT:                                                      \
+            ret.val.uint_val = lhs.val.uint_val __op__ rhs.val.uint_val;                            \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::LINT:                                                      \
+            if (options->mode_64bit)                                                                \
+                ret.val.lint64_val = lhs.val.lint64_val __op__ rhs.val.lint64_val;                  \
+            else                                                                                    \
+                ret.val.lint32_val = lhs.val.lint32_val __op__ rhs.val.lint32_val;                  \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::ULINT:                                                     \
+            if (options->mode_64bit)                                                                \
+                ret.val.ulint64_val = lhs.val.ulint64_val __op__ rhs.val.ulint64_val;               \
+            else                                                                                    \
+                ret.val.ulint32_val = lhs.val.ulint32_val __op__ rhs.val.ulint32_val;               \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::LLINT:                                                     \
+            ret.val.llint_val = lhs.val.llint_val __op__ rhs.val.llint_val;                         \
+            break;                                                                                  \
+        case IntegerType::IntegerTypeID::ULLINT:                                                    \
+            ret.val.ullint_val = lhs.val.ullint_val __op__ rhs.val.ullint_val;                      \
+            break;                                                                                  \
+    }                                                                                               \
+    return ret;                                                                                     \
+}
+
+LegacyBitOp(legacy_bit_and, &)
+
+#define SHFT_CASE(__op__, ret_val, lhs_val)                                                         \
+switch (rhs.get_int_type_id()) {                                                                    \
+    case IntegerType::IntegerTypeID::BOOL:                                                          \
+    case IntegerType::IntegerTypeID::CHAR:                                                          \
+    case IntegerType::IntegerTypeID::UCHAR:                                                         \
+    case IntegerType::IntegerTypeID::SHRT:                                                          \
+    case IntegerType::IntegerTypeID::USHRT:                                                         \
+    case IntegerType::IntegerTypeID::MAX_INT_ID:                                                    \
+        ERROR("perform propagate_type (BuiltinType::ScalarTypedVal)");                              \
+    case IntegerType::IntegerTypeID::INT:                                                           \
+        ret_val = lhs_val __op__ rhs.val.int_val;                                                   \
+        break;                                                                                      \
+    case IntegerType::IntegerTypeID::UINT:                                                          \
+        ret_val = lhs_val __op__ rhs.val.uint_val;                                                  \
+        break;                                                                                      \
+    case IntegerType::IntegerTypeID::LINT:                                                          \
+        if (options->mode_64bit)                                                                    \
+            ret_val = lhs_val __op__ rhs.val.lint64_val;                                            \
+        else                                                                                        \
+            ret_val = lhs_val __op__ rhs.val.lint32_val;                                            \
+        break;                                                                                      \
+    case IntegerType::IntegerTypeID::ULINT:                                                         \
+        if (options->mode_64bit)                                                                    \
+            ret_val = lhs_val __op__ rhs.val.ulint64_val;                                           \
+        else                                                                                        \
+            ret_val = lhs_val __op__ rhs.val.ulint32_val;                                           \
+        break;                                                                                      \
+    case IntegerType::IntegerTypeID::LLINT:                                                         \
+        ret_val = lhs_val __op__ rhs.val.llint_val;                                                 \
+        break;                                                                                      \
+    case IntegerType::IntegerTypeID::ULLINT:                                                        \
+        ret_val = lhs_val __op__ rhs.val.ullint_val;                                                \
+        break;                                                                                      \
+}
+
+static uint32_t msb(uint64_t x) {
+    uint32_t ret = 0;
+    while (x != 0) {
+        ret++;
+        x = x >> 1;
+    }
+    return ret;
+}
+
+static BuiltinType::ScalarTypedVal legacy_shl (BuiltinType::ScalarTypedVal lhs, BuiltinType::ScalarTypedVal rhs) {
+    BuiltinType::ScalarTypedVal ret = lhs;
+
+    int64_t s_lhs = 0;
+//    uint64_t u_lhs = 0;
+    int64_t s_rhs = 0;
+    uint64_t u_rhs = 0;
+    switch (lhs.get_int_type_id()) {
+        case IntegerType::IntegerTypeID::BOOL:
+        case IntegerType::IntegerTypeID::CHAR:
+        case IntegerType::IntegerTypeID::UCHAR:
+        case IntegerType::IntegerTypeID::SHRT:
+        case IntegerType::IntegerTypeID::USHRT:
+        case IntegerType::IntegerTypeID::MAX_INT_ID:
+            ERROR("perform propagate_type (BuiltinType::ScalarTypedVal)");
+        case IntegerType::IntegerTypeID::INT:
+            s_lhs = lhs.val.int_val;
+            break;
+        case IntegerType::IntegerTypeID::UINT:
+//            u_lhs = lhs.val.uint_val;
+            break;
+        case IntegerType::IntegerTypeID::LINT:
+            if (options->mode_64bit)
+                s_lhs = lhs.val.lint64_val;
+            else
+                s_lhs = lhs.val.lint32_val;
+            break;
+        case IntegerType::IntegerTypeID::ULINT:
+//            if (options->mode_64bit)
+//                u_lhs = lhs.val.ulint64_val;
+//            else
+//                u_lhs = lhs.val.ulint32_val;
+            break;
+        case IntegerType::IntegerTypeID::LLINT:
+            s_lhs = lhs.val.llint_val;
+            break;
+        case IntegerType::IntegerTypeID::ULLINT:
+//            u_lhs = lhs.val.ullint_val;
+            break;
+    }
+
+    switch (rhs.get_int_type_id()) {
+        case IntegerType::IntegerTypeID::BOOL:
+        case IntegerType::IntegerTypeID::CHAR:
+        case IntegerType::IntegerTypeID::UCHAR:
+        case IntegerType::IntegerTypeID::SHRT:
+        case IntegerType::IntegerTypeID::USHRT:
+        case IntegerType::IntegerTypeID::MAX_INT_ID:
+            ERROR("perform propagate_type (BuiltinType::ScalarTypedVal)");
+        case IntegerType::IntegerTypeID::INT:
+            s_rhs = rhs.val.int_val;
+            break;
+        case IntegerType::IntegerTypeID::UINT:
+            u_rhs = rhs.val.uint_val;
+            break;
+        case IntegerType::IntegerTypeID::LINT:
+            if (options->mode_64bit)
+                s_rhs = rhs.val.lint64_val;
+            else
+                s_rhs = rhs.val.lint32_val;
+            break;
+        case IntegerType::IntegerTypeID::ULINT:
+            if (options->mode_64bit)
+                u_rhs = rhs.val.ulint64_val;
+            else
+                u_rhs = rhs.val.ulint32_val;
+            break;
+        case IntegerType::IntegerTypeID::LLINT:
+            s_rhs = rhs.val.llint_val;
+            break;
+        case IntegerType::IntegerTypeID::ULLINT:
+            u_rhs = rhs.val.ullint_val;
+            break;
+    }
+
+    bool lhs_is_signed = IntegerType::init(lhs.get_int_type_id())->get_is_signed();
+    bool rhs_is_signed = IntegerType::init(rhs.get_int_type_id())->get_is_signed();
+    if (lhs_is_signed && (s_lhs < 0)) {
+        ret.set_ub(NegShift);
+        return ret;
+    }
+    if (rhs_is_signed && (s_rhs < 0)) {
+        ret.set_ub(ShiftRhsNeg);
+        return ret;
+    }
+
+    uint32_t lhs_bit_size = IntegerType::init(lhs.get_int_type_id())->get_bit_size();
+    if (rhs_is_signed) {
+        if (s_rhs >= (int)lhs_bit_size) {
+            ret.set_ub(ShiftRhsLarge);
+            return ret;
+        }
+    }
+    else {
+        if (u_rhs >= lhs_bit_size) {
+            ret.set_ub(ShiftRhsLarge);
+            return ret;
+        }
+    }
+
+    if (lhs_is_signed) {
+        uint32_t max_avail_shft = lhs_bit_size - msb(s_lhs);
+        if (rhs_is_signed && s_rhs >= (int)max_avail_shft) {
+            ret.set_ub(ShiftRhsLarge);
+            return ret;
+        }
+        else if (!rhs_is_signed && u_rhs >= max_avail_shft) {
+            ret.set_ub(ShiftRhsLarge);
+            return ret;
+        }
+    }
+
+    if (ret.has_ub())
+        return ret;
+
+    switch (lhs.get_int_type_id()) {
+        case IntegerType::IntegerTypeID::BOOL:
+        case IntegerType::IntegerTypeID::CHAR:
+        case IntegerType::IntegerTypeID::UCHAR:
+        case IntegerType::IntegerTypeID::SHRT:
+        case IntegerType::IntegerTypeID::USHRT:
+        case IntegerType::IntegerTypeID::MAX_INT_ID:
+            ERROR("perform propagate_type (BuiltinType::ScalarTypedVal)");
+        case IntegerType::IntegerTypeID::INT:
+            SHFT_CASE(<<, ret.val.int_val, lhs.val.int_val)
+            break;
+        case IntegerType::IntegerTypeID::UINT:
+            SHFT_CASE(<<, ret.val.uint_val, lhs.val.uint_val)
+            break;
+        case IntegerType::IntegerTypeID::LINT:
+            if (options->mode_64bit)
+                SHFT_CASE(<<, ret.val.lint64_val, lhs.val.lint64_val)
+            else
+                SHFT_CASE(<<, ret.val.lint32_val, lhs.val.lint32_val)
+            break;
+        case IntegerType::IntegerTypeID::ULINT:
+            if (options->mode_64bit)
+                SHFT_CASE(<<, ret.val.ulint64_val, lhs.val.ulint64_val)
+            else
+                SHFT_CASE(<<, ret.val.ulint32_val, lhs.val.ulint32_val)
+            break;
+        case IntegerType::IntegerTypeID::LLINT:
+            SHFT_CASE(<<, ret.val.llint_val, lhs.val.llint_val)
+            break;
+        case IntegerType::IntegerTypeID::ULLINT:
+            SHFT_CASE(<<, ret.val.ullint_val, lhs.val.ullint_val)
+            break;
+    }
+    return ret;
+}
+
+#define CAST_CASE(new_val_memb)                                                                     \
+switch (lhs.get_int_type_id()) {                                                                    \
+    case Type::IntegerTypeID::BOOL:                                                                 \
+        new_val_memb = lhs.val.bool_val;                                                            \
+        break;                                                                                      \
+    case Type::IntegerTypeID::CHAR:                                                                 \
+        new_val_memb = lhs.val.char_val;                                                            \
+        break;                                                                                      \
+    case Type::IntegerTypeID::UCHAR:                                                                \
+        new_val_memb = lhs.val.uchar_val;                                                           \
+        break;                                                                                      \
+    case Type::IntegerTypeID::SHRT:                                                                 \
+        new_val_memb = lhs.val.shrt_val;                                                            \
+        break;                                                                                      \
+    case Type::IntegerTypeID::USHRT:                                                                \
+        new_val_memb = lhs.val.ushrt_val;                                                           \
+        break;                                                                                      \
+    case Type::IntegerTypeID::INT:                                                                  \
+        new_val_memb = lhs.val.int_val;                                                             \
+        break;                                                                                      \
+    case Type::IntegerTypeID::UINT:                                                                 \
+        new_val_memb = lhs.val.uint_val;                                                            \
+        break;                                                                                      \
+    case Type::IntegerTypeID::LINT:                                                                 \
+        if (options->mode_64bit)                                                                    \
+            new_val_memb = lhs.val.lint64_val;                                                      \
+        else                                                                                        \
+            new_val_memb = lhs.val.lint32_val;                                                      \
+        break;                                                                                      \
+    case Type::IntegerTypeID::ULINT:                                                                \
+        if (options->mode_64bit)                                                                    \
+            new_val_memb = lhs.val.ulint64_val;                                                     \
+        else                                                                                        \
+            new_val_memb = lhs.val.ulint32_val;                                                     \
+        break;                                                                                      \
+    case Type::IntegerTypeID::LLINT:                                                                \
+        new_val_memb = lhs.val.llint_val;                                                           \
+        break;                                                                                      \
+    case Type::IntegerTypeID::ULLINT:                                                               \
+        new_val_memb = lhs.val.ullint_val;                                                          \
+        break;                                                                                      \
+    case Type::IntegerTypeID::MAX_INT_ID:                                                           \
+        ERROR("unsupported int type (BuiltinType::ScalarTypedVal)");                                \
+}
+
+static BuiltinType::ScalarTypedVal legacy_cast_type (BuiltinType::ScalarTypedVal lhs, Type::IntegerTypeID to_type_id) {
+    BuiltinType::ScalarTypedVal new_val = BuiltinType::ScalarTypedVal (to_type_id);
+    switch (to_type_id) {
+        case Type::IntegerTypeID::BOOL:
+            CAST_CASE(new_val.val.bool_val)
+            break;
+        case Type::IntegerTypeID::CHAR:
+            CAST_CASE(new_val.val.char_val)
+            break;
+        case Type::IntegerTypeID::UCHAR:
+            CAST_CASE(new_val.val.uchar_val)
+            break;
+        case Type::IntegerTypeID::SHRT:
+            CAST_CASE(new_val.val.shrt_val)
+            break;
+        case Type::IntegerTypeID::USHRT:
+            CAST_CASE(new_val.val.ushrt_val)
+            break;
+        case Type::IntegerTypeID::INT:
+            CAST_CASE(new_val.val.int_val)
+            break;
+        case Type::IntegerTypeID::UINT:
+            CAST_CASE(new_val.val.uint_val)
+            break;
+        case Type::IntegerTypeID::LINT:
+            if (options->mode_64bit)
+                CAST_CASE(new_val.val.lint64_val)
+            else
+                CAST_CASE(new_val.val.lint32_val)
+            break;
+        case Type::IntegerTypeID::ULINT:
+            if (options->mode_64bit)
+                CAST_CASE(new_val.val.ulint64_val)
+            else
+                CAST_CASE(new_val.val.ulint32_val)
+            break;
+        case Type::IntegerTypeID::LLINT:
+            CAST_CASE(new_val.val.llint_val)
+            break;
+        case Type::IntegerTypeID::ULLINT:
+            CAST_CASE(new_val.val.ullint_val)
+            break;
+        case Type::IntegerTypeID::MAX_INT_ID:
+            ERROR("unsupported int type (BuiltinType::ScalarTypedVal)");
+    }
+    return new_val;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef BuiltinType::ScalarTypedVal (*ScalarBinaryOp) (BuiltinType::ScalarTypedVal lhs, BuiltinType::ScalarTypedVal rhs);
+typedef BuiltinType::ScalarTypedVal (BuiltinType::ScalarTypedVal::*ScalarMemberOp) (BuiltinType::ScalarTypedVal rhs);
+
+// Operands for all integer types, which are allowed in arithmetic operators
+static std::vector<std::pair<BuiltinType::ScalarTypedVal, BuiltinType::ScalarTypedVal>> bench_operands;
+// Operands of logical operators (bool in C++ and int in C)
+static std::vector<std::pair<BuiltinType::ScalarTypedVal, BuiltinType::ScalarTypedVal>> bench_log_operands;
+// Values of all integer types
+static std::vector<BuiltinType::ScalarTypedVal> bench_cast_operands;
+
+static const uint32_t bench_operand_count = 1 << 12;
+static const uint32_t bench_iter_count = 200;
+
+static BuiltinType::ScalarTypedVal rand_scalar_val (std::mt19937_64& engine, Type::IntegerTypeID int_type_id) {
+    BuiltinType::ScalarTypedVal bits (Type::IntegerTypeID::ULLINT);
+    bits.val.ullint_val = engine();
+    // Small values exercise shifts, division and extreme values exercise overflow checks
+    switch (engine() % 4) {
+        case 0:
+            bits.val.ullint_val = bits.val.ullint_val % 16 - 4;
+            break;
+        case 1:
+            bits.val.ullint_val = bits.val.ullint_val % 64;
+            break;
+        default:
+            break;
+    }
+    return legacy_cast_type(bits, int_type_id);
+}
+
+static void init_bench_operands () {
+    std::mt19937_64 engine (0);
+    for (uint32_t i = 0; i < bench_operand_count; ++i) {
+        Type::IntegerTypeID int_type_id = (Type::IntegerTypeID) (Type::IntegerTypeID::INT +
+                                          engine() % (Type::IntegerTypeID::MAX_INT_ID - Type::IntegerTypeID::INT));
+        BuiltinType::ScalarTypedVal lhs = rand_scalar_val(engine, int_type_id);
+        BuiltinType::ScalarTypedVal rhs = rand_scalar_val(engine, int_type_id);
+        bench_operands.push_back(std::make_pair(lhs, rhs));
+
+        Type::IntegerTypeID log_type_id = options->is_c() ? Type::IntegerTypeID::INT : Type::IntegerTypeID::BOOL;
+        bench_log_operands.push_back(std::make_pair(rand_scalar_val(engine, log_type_id),
+                                                    rand_scalar_val(engine, log_type_id)));
+
+        bench_cast_operands.push_back(rand_scalar_val(engine, (Type::IntegerTypeID)
+                                                      (engine() % Type::IntegerTypeID::MAX_INT_ID)));
+    }
+}
+
+static bool is_same_result (BuiltinType::ScalarTypedVal a, BuiltinType::ScalarTypedVal b) {
+    if (a.get_int_type_id() != b.get_int_type_id() || a.get_ub() != b.get_ub())
+        return false;
+    return a.has_ub() || a.val.ullint_val == b.val.ullint_val;
+}
+
+// Results are folded into checksum and stored here, so the compiler can't throw away computations
+static volatile uint64_t bench_sink = 0;
+
+// Folds results, so the compiler can't throw away computations
+static inline uint64_t fold_result (uint64_t checksum, BuiltinType::ScalarTypedVal res) {
+    return checksum * 31 + res.val.ullint_val + res.get_ub();
+}
+
+static void print_bench_result (std::ostream& stream, std::string name, uint64_t op_count,
+                                std::chrono::nanoseconds legacy_time, std::chrono::nanoseconds kernel_time) {
+    double legacy_ns = (double) legacy_time.count() / op_count;
+    double kernel_ns = (double) kernel_time.count() / op_count;
+    stream << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2) <<
+              std::setw(14) << legacy_ns << std::setw(14) << kernel_ns <<
+              std::setw(12) << legacy_ns / kernel_ns << std::endl;
+}
+
+template <typename Func>
+static std::chrono::nanoseconds measure (Func func, uint64_t& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t iter = 0; iter < bench_iter_count; ++iter)
+        checksum = func(checksum);
+    return std::chrono::steady_clock::now() - start;
+}
+
+static void bench_binary_op (std::ostream& stream, std::string name, ScalarBinaryOp legacy_op,
+                             ScalarMemberOp member_op, bool is_log_op = false) {
+    auto& operands = is_log_op ? bench_log_operands : bench_operands;
+    for (auto& i : operands) {
+        BuiltinType::ScalarTypedVal lhs = i.first;
+        if (!is_same_result(legacy_op(i.first, i.second), (lhs.*member_op)(i.second)))
+            ERROR("results of implementations differ for " + name + ": " +
+                  std::to_string(i.first.val.ullint_val) + ", " + std::to_string(i.second.val.ullint_val));
+    }
+
+    // Both implementations are called through pointers, which the compiler can't see through,
+    // so they are compared as out-of-line calls (as operators are called in the generator)
+    ScalarBinaryOp volatile legacy_ptr = legacy_op;
+    ScalarMemberOp volatile member_ptr = member_op;
+    uint64_t checksum = 0;
+    std::chrono::nanoseconds legacy_time = measure([&operands, &legacy_ptr] (uint64_t checksum) {
+        ScalarBinaryOp op = legacy_ptr;
+        for (auto& i : operands)
+            checksum = fold_result(checksum, op(i.first, i.second));
+        return checksum;
+    }, checksum);
+    std::chrono::nanoseconds kernel_time = measure([&operands, &member_ptr] (uint64_t checksum) {
+        ScalarMemberOp op = member_ptr;
+        for (auto& i : operands) {
+            BuiltinType::ScalarTypedVal lhs = i.first;
+            checksum = fold_result(checksum, (lhs.*op)(i.second));
+        }
+        return checksum;
+    }, checksum);
+    print_bench_result(stream, name, (uint64_t) operands.size() * bench_iter_count, legacy_time, kernel_time);
+    bench_sink = checksum;
+}
+
+static void bench_cast_type (std::ostream& stream) {
+    for (auto& i : bench_cast_operands)
+        for (int to_type_id = 0; to_type_id < Type::IntegerTypeID::MAX_INT_ID; ++to_type_id)
+            if (!is_same_result(legacy_cast_type(i, (Type::IntegerTypeID) to_type_id),
+                                i.cast_type((Type::IntegerTypeID) to_type_id)))
+                ERROR("results of implementations differ for cast_type: " + std::to_string(i.val.ullint_val));
+
+    uint64_t checksum = 0;
+    std::chrono::nanoseconds legacy_time = measure([] (uint64_t checksum) {
+        for (auto& i : bench_cast_operands)
+            for (int to_type_id = 0; to_type_id < Type::IntegerTypeID::MAX_INT_ID; ++to_type_id)
+                checksum = fold_result(checksum, legacy_cast_type(i, (Type::IntegerTypeID) to_type_id));
+        return checksum;
+    }, checksum);
+    std::chrono::nanoseconds kernel_time = measure([] (uint64_t checksum) {
+        for (auto& i : bench_cast_operands)
+            for (int to_type_id = 0; to_type_id < Type::IntegerTypeID::MAX_INT_ID; ++to_type_id)
+                checksum = fold_result(checksum, i.cast_type((Type::IntegerTypeID) to_type_id));
+        return checksum;
+    }, checksum);
+    print_bench_result(stream, "cast_type", (uint64_t) bench_cast_operands.size() * bench_iter_count *
+                       Type::IntegerTypeID::MAX_INT_ID, legacy_time, kernel_time);
+    bench_sink = checksum;
+}
+
+// Compares ScalarTypedVal operators with their switch-based implementation (it is kept above as reference).
+// Both implementations are checked to give the same results first. Current bit mode and language standard are used.
+void bench_scalar_ops (std::ostream& stream) {
+    init_bench_operands();
+    stream << std::left << std::setw(12) << "operator" << std::right << std::setw(14) << "switch (ns)" <<
+              std::setw(14) << "table (ns)" << std::setw(12) << "speedup" << std::endl;
+    bench_binary_op(stream, "+", legacy_add, &BuiltinType::ScalarTypedVal::operator+);
+    bench_binary_op(stream, "*", legacy_mul, &BuiltinType::ScalarTypedVal::operator*);
+    bench_binary_op(stream, "<<", legacy_shl, &BuiltinType::ScalarTypedVal::operator<<);
+    bench_binary_op(stream, "<", legacy_less, &BuiltinType::ScalarTypedVal::operator<);
+    bench_binary_op(stream, "&", legacy_bit_and, &BuiltinType::ScalarTypedVal::operator&);
+    bench_binary_op(stream, "&&", legacy_log_and, &BuiltinType::ScalarTypedVal::operator&&, true);
+    bench_cast_type(stream);
+}
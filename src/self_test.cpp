@@ -188,7 +188,7 @@ void self_test () {
     inp.push_back(lint_use);
     inp.push_back(if_val_use);
     inp.push_back(else_val_use);
-    std::shared_ptr<Expr> unary_rand = UnaryExpr::generate(ctx, inp, 0);
+    std::shared_ptr<Expr> unary_rand = ArithExpr::generate(ctx, inp);
     std::cout << "unary_rand: " << unary_rand->emit() << std::endl;
     std::cout << "\n====================="<< std::endl;
 
@@ -201,7 +201,7 @@ void self_test () {
     }
 
 
-    std::shared_ptr<Expr> unary_rand2 = UnaryExpr::generate(ctx, inp, 0);
+    std::shared_ptr<Expr> unary_rand2 = ArithExpr::generate(ctx, inp);
     std::cout << "unary_rand: " << unary_rand2->emit() << std::endl;
     std::cout << "\n====================="<< std::endl;
 
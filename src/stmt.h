@@ -19,6 +19,7 @@ class Stmt : public Node {
 
         static void increase_stmt_count() { total_stmt_count++; func_stmt_count++; }
         static void zero_out_func_stmt_count () { func_stmt_count = 0; }
+        static uint32_t get_total_stmt_count () { return total_stmt_count; }
 
     protected:
         // Count of statements over all test program
@@ -37,12 +38,12 @@ class DeclStmt : public Stmt {
         void emit (std::ostream& stream, std::string offset = "");
         // count_up_total determines whether to increase Expr::total_expr_count or not (used for CSE)
         static std::shared_ptr<DeclStmt> generate (std::shared_ptr<Context> ctx,
-                                                   std::vector<std::shared_ptr<Expr>> inp,
+                                                   const InpExprIndex& inp,
                                                    bool count_up_total);
 
     private:
         std::shared_ptr<Data> data;
-        std::shared_ptr<Expr> init;
+        FlatExpr init;
         bool is_extern;
 };
 
@@ -54,12 +55,13 @@ class ExprStmt : public Stmt {
         void emit (std::ostream& stream, std::string offset = "");
         // For info about count_up_total see note above
         static std::shared_ptr<ExprStmt> generate (std::shared_ptr<Context> ctx,
-                                                   std::vector<std::shared_ptr<Expr>> inp,
+                                                   const InpExprIndex& inp,
                                                    std::shared_ptr<Expr> out,
                                                    bool count_up_total);
 
     private:
-        std::shared_ptr<Expr> expr;
+        // Expression tree isn't needed after generation of the statement, so only its flat encoding is kept
+        FlatExpr expr;
 };
 
 // Scope statement 表示作用于和内容:
@@ -76,11 +78,8 @@ class ScopeStmt : public Stmt {
         static std::shared_ptr<ScopeStmt> generate (std::shared_ptr<Context> ctx);
 
     private:
-        using ExprVector = std::vector<std::shared_ptr<Expr>>;
-        static ExprVector extract_inp_from_ctx(std::shared_ptr<Context> ctx);
-        static ExprVector extract_locals_from_ctx(std::shared_ptr<Context> ctx);
-        static ExprVector extract_inp_and_mix_from_ctx(std::shared_ptr<Context> ctx);
-        static std::map<std::string, ExprVector> extract_all_local_ptr_exprs(std::shared_ptr<Context> ctx);
+        static InpExprIndex extract_inp_from_ctx(std::shared_ptr<Context> ctx);
+        static InpExprIndex extract_inp_and_mix_from_ctx(std::shared_ptr<Context> ctx);
 
         std::vector<std::shared_ptr<Stmt>> scope;
 };
@@ -101,13 +100,13 @@ class IfStmt : public Stmt {
         void emit (std::ostream& stream, std::string offset = "");
         // For info about count_up_total see note above
         static std::shared_ptr<IfStmt> generate (std::shared_ptr<Context> ctx,
-                                                 std::vector<std::shared_ptr<Expr>> inp,
+                                                 const InpExprIndex& inp,
                                                  bool count_up_total);
 
     private:
         // TODO: do we need it? It should indicate whether the scope is evaluated.
         bool taken;
-        std::shared_ptr<Expr> cond;
+        FlatExpr cond;
         std::shared_ptr<ScopeStmt> if_branch;
         std::shared_ptr<ScopeStmt> else_branch;
 };
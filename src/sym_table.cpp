@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <sstream>
 
@@ -7,56 +8,115 @@
 using namespace oorgen;
 
 
+void ArrayElemUseExprs::add_array (std::shared_ptr<Array> array) {
+    if (array->get_elements_count() == 0)
+        return;
+    arrays.push_back(array);
+    array_ends.push_back(size() + array->get_elements_count());
+}
+
+std::shared_ptr<Expr> ArrayElemUseExprs::at (size_t idx) const {
+    if (idx >= size())
+        ERROR("index is out of range (ArrayElemUseExprs)");
+    std::shared_ptr<Expr>& ret = created_uses[idx];
+    if (ret == nullptr) {
+        size_t array_idx = std::upper_bound(array_ends.begin(), array_ends.end(), idx) - array_ends.begin();
+        ret = ir_make_shared<VarUseExpr>(arrays[array_idx]->get_element(idx - get_array_begin(array_idx)));
+    }
+    return ret;
+}
+
+void InpExprIndex::add_segment (const ArrayElemUseExprs& uses, size_t begin, size_t end) {
+    if (begin >= end)
+        return;
+    segments.push_back({&uses, begin, &get_array_elem_use});
+    segment_ends.push_back(get_segments_size() + end - begin);
+}
+
+std::shared_ptr<Expr> InpExprIndex::at (size_t idx) const {
+    size_t segments_size = get_segments_size();
+    if (idx >= segments_size) {
+        if (idx - segments_size >= own.size())
+            ERROR("index is out of range (InpExprIndex)");
+        return own[idx - segments_size];
+    }
+    size_t seg = std::upper_bound(segment_ends.begin(), segment_ends.end(), idx) - segment_ends.begin();
+    size_t seg_begin = seg == 0 ? 0 : segment_ends[seg - 1];
+    return segments[seg].get_elem(segments[seg].vec, segments[seg].begin + idx - seg_begin);
+}
+
+std::shared_ptr<Expr> ExprSlotPool::take (size_t idx) {
+    if (idx >= slots.size())
+        ERROR("index is out of range (ExprSlotPool)");
+    std::swap(slots[idx], slots.back());
+    size_t ret = slots.back();
+    slots.pop_back();
+    return source.at(ret);
+}
+
+std::shared_ptr<Expr> ExprSlotPool::take_in_order (size_t idx) {
+    if (idx >= slots.size())
+        ERROR("index is out of range (ExprSlotPool)");
+    size_t ret = slots[idx];
+    slots.erase(slots.begin() + idx);
+    return source.at(ret);
+}
+
 void SymbolTable::add_variable (std::shared_ptr<ScalarVariable> _var) {
     variable.push_back (_var);
     // We also need to store AddressOfExpr to this variable
-    std::shared_ptr<VarUseExpr> var_use_expr = std::make_shared<VarUseExpr>(_var);
-    std::shared_ptr<AddressOfExpr> var_ref_expr = std::make_shared<AddressOfExpr>(var_use_expr);
-    std::shared_ptr<PointerType> ptr_type = std::static_pointer_cast<PointerType>(var_ref_expr->get_value()->get_type());
-    std::string ptr_key = ptr_type->get_simple_name() + ptr_type->get_type_suffix();
-    add_to_all_map(ptr_key, var_ref_expr);
+    std::shared_ptr<VarUseExpr> var_use_expr = ir_make_shared<VarUseExpr>(_var);
+    var_use_exprs.push_back(var_use_expr);
+    std::shared_ptr<AddressOfExpr> var_ref_expr = ir_make_shared<AddressOfExpr>(var_use_expr);
+    std::shared_ptr<PointerType> ptr_type = std::static_pointer_cast<PointerType>(var_ref_expr->get_value_type());
+    add_to_all_map(ptr_type->get_interned_id(), var_ref_expr);
 }
 
 void SymbolTable::add_struct (std::shared_ptr<Struct> _struct) {
     structs.push_back(_struct);
-    form_struct_member_expr(members_in_structs, nullptr, _struct);
+    form_struct_member_expr(members_in_structs, _struct);
 }
 
+// Member expressions are formed in one pass over flattened layout of structure type
 void SymbolTable::form_struct_member_expr (std::tuple<MemberVector, MemberVector>& ret,
-                                           std::shared_ptr<MemberExpr> parent_memb_expr,
-                                           std::shared_ptr<Struct> struct_var,
-                                           bool ignore_const) {
-    for (uint32_t j = 0; j < struct_var->get_member_count(); ++j) {
-        GenPolicy gen_policy;
-        if (rand_val_gen->get_rand_id(gen_policy.get_member_use_prob())) {
-            std::shared_ptr<MemberExpr> member_expr;
-            if (parent_memb_expr != nullptr)
-                member_expr = std::make_shared<MemberExpr>(parent_memb_expr, j);
-            else
-                member_expr = std::make_shared<MemberExpr>(struct_var, j);
+                                           std::shared_ptr<Struct> struct_var) {
+    RAND_CALL_SITE("SymbolTable::form_struct_member_expr");
+    GenPolicy gen_policy;
+    const auto& layout = std::static_pointer_cast<StructType>(struct_var->get_type())->get_flat_layout();
+    // Member expressions of enclosing structures for each nesting level
+    std::vector<std::shared_ptr<MemberExpr>> parent_memb_exprs;
+    for (uint32_t i = 0; i < layout.size(); ) {
+        const StructType::FlatMember& cur_member = layout.at(i);
+        // Unused structure member is skipped together with all its nested members
+        if (!rand_val_gen->get_rand_id(gen_policy.get_member_use_prob())) {
+            i = cur_member.subtree_end;
+            continue;
+        }
+        ++i;
 
-            bool is_static = struct_var->get_member(j)->get_type()->get_is_static();
+        std::shared_ptr<MemberExpr> member_expr;
+        if (cur_member.depth != 0)
+            member_expr = ir_make_shared<MemberExpr>(parent_memb_exprs.at(cur_member.depth - 1), cur_member.idx_in_parent);
+        else
+            member_expr = ir_make_shared<MemberExpr>(struct_var, cur_member.idx_in_parent);
 
-            if (struct_var->get_member(j)->get_type()->is_struct_type()) {
-                form_struct_member_expr(ret, member_expr, std::static_pointer_cast<Struct>(struct_var->get_member(j)),
-                                        is_static || ignore_const);
-            }
-            else {
-                std::get<ALL>(ret).push_back(member_expr);
-                if (!is_static && !ignore_const) {
-                    std::get<CONST>(ret).push_back(member_expr);
-                }
-
-                // Can't take address of bit-field
-                if (member_expr->get_value()->get_type()->get_is_bit_field())
-                    continue;
-                // We also need to store AddressOfExpr to this MemberExpr
-                std::shared_ptr<AddressOfExpr> memb_ref_expr = std::make_shared<AddressOfExpr>(member_expr);
-                std::shared_ptr<PointerType> ptr_type = std::static_pointer_cast<PointerType>(memb_ref_expr->get_value()->get_type());
-                std::string ptr_key = ptr_type->get_simple_name() + ptr_type->get_type_suffix();
-                add_to_all_map(ptr_key, memb_ref_expr);
-            }
+        if (cur_member.member->get_type()->is_struct_type()) {
+            parent_memb_exprs.resize(cur_member.depth + 1);
+            parent_memb_exprs.at(cur_member.depth) = member_expr;
+            continue;
         }
+
+        std::get<ALL>(ret).push_back(member_expr);
+        if (!cur_member.in_static)
+            std::get<CONST>(ret).push_back(member_expr);
+
+        // Can't take address of bit-field
+        if (member_expr->get_value_type()->get_is_bit_field())
+            continue;
+        // We also need to store AddressOfExpr to this MemberExpr
+        std::shared_ptr<AddressOfExpr> memb_ref_expr = ir_make_shared<AddressOfExpr>(member_expr);
+        std::shared_ptr<PointerType> ptr_type = std::static_pointer_cast<PointerType>(memb_ref_expr->get_value_type());
+        add_to_all_map(ptr_type->get_interned_id(), memb_ref_expr);
     }
 }
 
@@ -64,32 +124,45 @@ void SymbolTable::add_array (std::shared_ptr<Array> _array) {
     std::shared_ptr<ArrayType> new_array_type = std::static_pointer_cast<ArrayType>(_array->get_type());
     array.push_back(_array);
     std::shared_ptr<Type> base_type = new_array_type->get_base_type();
+    if (base_type->is_int_type())
+        var_use_exprs_in_arrays.add_array(_array);
     if (new_array_type->get_base_type()->is_struct_type())
         for (unsigned int i = 0; i < _array->get_elements_count(); ++i)
-            form_struct_member_expr(members_in_arrays, nullptr, std::static_pointer_cast<Struct>(_array->get_element(i)));
+            form_struct_member_expr(members_in_arrays, std::static_pointer_cast<Struct>(_array->get_element(i)));
 }
 
 
 std::shared_ptr<ExprStar> SymbolTable::deep_deref_expr_from_nest_ptr(std::shared_ptr<ExprStar> expr) {
-    if (!expr->get_value()->get_type()->is_ptr_type())
+    if (!expr->get_value_type()->is_ptr_type())
         return expr;
     // We store ExprStar at each level
-    std::shared_ptr<PointerType> ptr_type = std::static_pointer_cast<PointerType>(expr->get_value()->get_type());
-    std::string ptr_key = ptr_type->get_simple_name() + ptr_type->get_type_suffix();
-    add_to_lval_map(ptr_key, expr);
-    add_to_all_map(ptr_key, expr);
+    std::shared_ptr<PointerType> ptr_type = std::static_pointer_cast<PointerType>(expr->get_value_type());
+    add_to_lval_map(ptr_type->get_interned_id(), expr);
+    add_to_all_map(ptr_type->get_interned_id(), expr);
 
-    return deep_deref_expr_from_nest_ptr(std::make_shared<ExprStar>(expr));
+    return deep_deref_expr_from_nest_ptr(ir_make_shared<ExprStar>(expr));
 }
 
-void SymbolTable::add_to_lval_map(std::string& key, std::shared_ptr<Expr> expr) {
-    lval_expr_with_ptr_type[key].push_back(expr);
-    if (std::find(lval_ptr_map_keys.begin(), lval_ptr_map_keys.end(), key) == lval_ptr_map_keys.end())
-        lval_ptr_map_keys.push_back(key);
+void SymbolTable::add_to_ptr_map(std::vector<ExprVector>& map, std::vector<PtrTypeID>& keys,
+                                 PtrTypeID key, std::shared_ptr<Expr> expr) {
+    if (key >= map.size())
+        map.resize(key + 1);
+    if (map[key].empty())
+        keys.push_back(key);
+    map[key].push_back(expr);
 }
 
-void SymbolTable::add_to_all_map(std::string& key, std::shared_ptr<Expr> expr) {
-    all_expr_with_ptr_type[key].push_back(expr);
+const SymbolTable::ExprVector& SymbolTable::find_in_ptr_map(const std::vector<ExprVector>& map, PtrTypeID key) {
+    static const ExprVector empty_vec;
+    return key < map.size() ? map[key] : empty_vec;
+}
+
+void SymbolTable::add_to_lval_map(PtrTypeID key, std::shared_ptr<Expr> expr) {
+    add_to_ptr_map(lval_expr_with_ptr_type, lval_ptr_map_keys, key, expr);
+}
+
+void SymbolTable::add_to_all_map(PtrTypeID key, std::shared_ptr<Expr> expr) {
+    add_to_ptr_map(all_expr_with_ptr_type, all_ptr_map_keys, key, expr);
 }
 
 void SymbolTable::add_pointer(std::shared_ptr<Pointer> ptr, std::shared_ptr<Expr> init_expr) {
@@ -97,67 +170,77 @@ void SymbolTable::add_pointer(std::shared_ptr<Pointer> ptr, std::shared_ptr<Expr
         init_expr->get_id() != Node::NodeID::DEREFERENCE && init_expr->get_id() != Node::NodeID::REFERENCE)
         ERROR("can add only VarUseExpr or MemberExpr or ExprStar or AddressOfExpr");
     pointers.ptr.push_back(ptr);
-    pointers.init_expr.push_back(std::make_shared<AddressOfExpr>(init_expr));
+    pointers.init_expr.push_back(ir_make_shared<AddressOfExpr>(init_expr));
 
     // For every pointer we need to store pointer itself
-    std::shared_ptr<VarUseExpr> ptr_use_expr = std::make_shared<VarUseExpr>(ptr);
+    std::shared_ptr<VarUseExpr> ptr_use_expr = ir_make_shared<VarUseExpr>(ptr);
     std::shared_ptr<PointerType> ptr_type = std::static_pointer_cast<PointerType>(ptr->get_type());
-    std::string ptr_key = ptr_type->get_simple_name() + ptr_type->get_type_suffix();
-    add_to_lval_map(ptr_key, ptr_use_expr);
-    add_to_all_map(ptr_key, ptr_use_expr);
+    add_to_lval_map(ptr_type->get_interned_id(), ptr_use_expr);
+    add_to_all_map(ptr_type->get_interned_id(), ptr_use_expr);
 
     // Also we need to store AddressOfExpr to it
-    std::shared_ptr<AddressOfExpr> ptr_ref_expr = std::make_shared<AddressOfExpr>(ptr_use_expr);
-    ptr_type = std::static_pointer_cast<PointerType>(ptr_ref_expr->get_value()->get_type());
-    ptr_key = ptr_type->get_simple_name() + ptr_type->get_type_suffix();
-    add_to_all_map(ptr_key, ptr_ref_expr);
+    std::shared_ptr<AddressOfExpr> ptr_ref_expr = ir_make_shared<AddressOfExpr>(ptr_use_expr);
+    ptr_type = std::static_pointer_cast<PointerType>(ptr_ref_expr->get_value_type());
+    add_to_all_map(ptr_type->get_interned_id(), ptr_ref_expr);
 
     // And also all ExprStar
-    std::shared_ptr<ExprStar> deref_expr = std::make_shared<ExprStar>(ptr_use_expr);
+    std::shared_ptr<ExprStar> deref_expr = ir_make_shared<ExprStar>(ptr_use_expr);
     pointers.deref_expr.push_back(deep_deref_expr_from_nest_ptr(deref_expr));
 }
 
-void SymbolTable::del_member_in_structs(size_t idx) {
-    auto& member_exprs = std::get<ALL>(members_in_structs);
-    member_exprs.erase(member_exprs.begin() + idx);
+void SymbolTable::form_out_slot_pools () {
+    out_slots[GenPolicy::OutDataTypeID::MEMBER].fill(std::get<ALL>(members_in_structs));
+    out_slots[GenPolicy::OutDataTypeID::VAR_IN_ARRAY].fill(var_use_exprs_in_arrays);
+    out_slots[GenPolicy::OutDataTypeID::MEMBER_IN_ARRAY].fill(std::get<ALL>(members_in_arrays));
+    out_slots[GenPolicy::OutDataTypeID::DEREFERENCE].fill(pointers.deref_expr);
 }
 
-void SymbolTable::del_member_in_arrays(size_t idx) {
-    auto& member_exprs = std::get<ALL>(members_in_arrays);
-    member_exprs.erase(member_exprs.begin() + idx);
+InpExprIndex SymbolTable::get_all_var_use_exprs(bool ignore_tmp_objs) {
+    InpExprIndex ret;
+    ret.add_segment(var_use_exprs);
+    if (!ignore_tmp_objs) {
+        ret.add_segment(var_use_exprs_in_arrays);
+        return ret;
+    }
+    const std::vector<std::shared_ptr<Array>>& int_arrays = var_use_exprs_in_arrays.get_arrays();
+    for (size_t i = 0; i < int_arrays.size(); ++i) {
+        std::shared_ptr<ArrayType> array_iter_type = std::static_pointer_cast<ArrayType>(int_arrays[i]->get_type());
+        if (array_iter_type->get_kind() != ArrayType::Kind::STD_VEC ||
+            array_iter_type->get_base_type()->get_int_type_id() != IntegerType::IntegerTypeID::BOOL)
+            ret.add_segment(var_use_exprs_in_arrays, var_use_exprs_in_arrays.get_array_begin(i),
+                            var_use_exprs_in_arrays.get_array_end(i));
+    }
+    return ret;
 }
 
-void SymbolTable::var_use_exprs_from_vars_in_arrays (std::vector<std::shared_ptr<Expr>>& ret, bool ignore_tmp_objs) {
-    for (auto const& array_iter : array) {
-        std::shared_ptr<ArrayType> array_iter_type = std::static_pointer_cast<ArrayType>(array_iter->get_type());
-        if (array_iter_type->get_base_type()->is_int_type()) {
-            if (ignore_tmp_objs && array_iter_type->get_kind() == ArrayType::Kind::STD_VEC &&
-                array_iter_type->get_base_type()->get_int_type_id() == IntegerType::IntegerTypeID::BOOL)
-                continue;
-
-            for (unsigned int i = 0; i < array_iter->get_elements_count(); ++i)
-                ret.emplace_back(std::make_shared<VarUseExpr>(array_iter->get_element(i)));
-        }
-    }
+void SymbolTable::add_var_use_exprs_to_index (InpExprIndex& index) {
+    index.add_segment(var_use_exprs);
+    index.add_segment(var_use_exprs_in_arrays);
 }
 
-SymbolTable::ExprVector SymbolTable::get_var_use_exprs_from_vars () {
-    std::vector<std::shared_ptr<Expr>> ret;
-    for (auto const& i : variable)
-        ret.emplace_back(std::make_shared<VarUseExpr>(i));
-    return ret;
+void SymbolTable::add_visible_locals_to_index (InpExprIndex& index) {
+    for (SymbolTable* scope = this; scope != nullptr; scope = scope->outer_scope.get()) {
+        scope->add_var_use_exprs_to_index(index);
+        index.add_segment(scope->pointers.deref_expr);
+    }
 }
 
-SymbolTable::ExprVector SymbolTable::get_var_use_exprs_in_arrays () {
-    std::vector<std::shared_ptr<Expr>> ret;
-    var_use_exprs_from_vars_in_arrays(ret);
+std::vector<SymbolTable::PtrTypeID> SymbolTable::get_visible_ptr_keys () {
+    std::vector<PtrTypeID> ret;
+    for (SymbolTable* scope = this; scope != nullptr; scope = scope->outer_scope.get())
+        ret.insert(ret.end(), scope->all_ptr_map_keys.begin(), scope->all_ptr_map_keys.end());
+    std::sort(ret.begin(), ret.end(), [] (PtrTypeID a, PtrTypeID b) -> bool {
+        return PointerType::get_interned_name(a) < PointerType::get_interned_name(b);
+    });
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
     return ret;
 }
 
-SymbolTable::ExprVector SymbolTable::get_all_var_use_exprs(bool ignore_tmp_objs) {
-    std::vector<std::shared_ptr<Expr>> ret = get_var_use_exprs_from_vars();
-    var_use_exprs_from_vars_in_arrays(ret, ignore_tmp_objs);
-    return ret;
+void SymbolTable::get_visible_exprs_with_ptr_type (PtrTypeID key, ExprVector& ret) {
+    for (SymbolTable* scope = this; scope != nullptr; scope = scope->outer_scope.get()) {
+        const ExprVector& scope_exprs = find_in_ptr_map(scope->all_expr_with_ptr_type, key);
+        ret.insert(ret.end(), scope_exprs.begin(), scope_exprs.end());
+    }
 }
 
 void SymbolTable::emit_variable_extern_decl (std::ostream& stream, std::string offset) {
@@ -171,9 +254,9 @@ void SymbolTable::emit_variable_extern_decl (std::ostream& stream, std::string o
 
 void SymbolTable::emit_variable_def (std::ostream& stream, std::string offset) {
     for (const auto &i : variable) {
-        std::shared_ptr<ConstExpr> const_init = std::make_shared<ConstExpr>(i->get_init_value());
+        std::shared_ptr<ConstExpr> const_init = ir_make_shared<ConstExpr>(i->get_init_value());
 
-        std::shared_ptr<DeclStmt> decl = std::make_shared<DeclStmt>(i, const_init);
+        std::shared_ptr<DeclStmt> decl = ir_make_shared<DeclStmt>(i, const_init);
         stream << offset;
         decl->emit(stream);
         stream << "\n";
@@ -182,7 +265,7 @@ void SymbolTable::emit_variable_def (std::ostream& stream, std::string offset) {
 
 void SymbolTable::emit_variable_check (std::ostream& stream, std::string offset) {
     for (const auto &i : variable) {
-        stream << offset + "hash(&seed, " + i->get_name() + ");\n";
+        stream << offset + "hash(&seed, " << i->get_name_id() << ");\n";
     }
 }
 
@@ -224,65 +307,57 @@ void SymbolTable::emit_struct_extern_decl (std::ostream& stream, std::string off
 
 void SymbolTable::emit_struct_init (std::ostream& stream, std::string offset) {
     for (const auto &i : structs)
-        emit_single_struct_init(nullptr, i, stream, offset);
+        emit_single_struct_init(i, stream, offset);
 }
 
-void SymbolTable::emit_single_struct_init (std::shared_ptr<MemberExpr> parent_memb_expr,
-                                           std::shared_ptr<Struct> struct_var,
-                                           std::ostream& stream, std::string offset) {
-    for (uint64_t j = 0; j < struct_var->get_member_count(); ++j) {
-        std::shared_ptr<MemberExpr> member_expr;
-        if  (parent_memb_expr != nullptr)
-            member_expr = std::make_shared<MemberExpr>(parent_memb_expr, j);
-        else
-            member_expr = std::make_shared<MemberExpr>(struct_var, j);
-
+void SymbolTable::emit_single_struct_init (std::shared_ptr<Struct> struct_var, std::ostream& stream, std::string offset) {
+    const auto& layout = std::static_pointer_cast<StructType>(struct_var->get_type())->get_flat_layout();
+    const auto& flat_members = struct_var->get_flat_members();
+    for (uint32_t i = 0; i < layout.size(); ) {
+        const StructType::FlatMember& cur_member = layout.at(i);
         // Static members of struct should be initialized only once
-        if (struct_var->get_member(j)->get_type()->get_is_static())
+        if (cur_member.member->get_type()->get_is_static()) {
+            i = cur_member.subtree_end;
             continue;
-
-        if (struct_var->get_member(j)->get_type()->is_struct_type()) {
-            emit_single_struct_init(member_expr, std::static_pointer_cast<Struct>(struct_var->get_member(j)),
-                                    stream, offset);
         }
-        else {
-            std::shared_ptr<ConstExpr> const_init = std::make_shared<ConstExpr>(std::static_pointer_cast<ScalarVariable>(struct_var->get_member(j))->get_init_value());
-            AssignExpr assign (member_expr, const_init, false);
-            stream << offset;
-            assign.emit(stream);
+
+        if (!cur_member.member->get_type()->is_struct_type()) {
+            std::shared_ptr<ScalarVariable> member_var = std::static_pointer_cast<ScalarVariable>(flat_members.at(i));
+            std::shared_ptr<ConstExpr> const_init = ir_make_shared<ConstExpr>(member_var->get_init_value());
+            TypeCastExpr init_cast (const_init, member_var->get_type(), true);
+            stream << offset << struct_var->get_name_id() << cur_member.access_path << " = ";
+            init_cast.emit(stream);
             stream << ";\n";
         }
+        ++i;
     }
 }
 
 void SymbolTable::emit_struct_check (std::ostream& stream, std::string offset) {
     for (const auto &i : structs)
-        emit_single_struct_check(nullptr, i, stream, offset);
+        emit_single_struct_check(i, stream, offset);
 }
 
-void SymbolTable::emit_single_struct_check (std::shared_ptr<MemberExpr> parent_memb_expr,
-                                            std::shared_ptr<Struct> struct_var,
-                                            std::ostream& stream,
-                                            std::string offset) {
-    for (uint64_t j = 0; j < struct_var->get_member_count(); ++j) {
-        std::shared_ptr<MemberExpr> member_expr;
-        if  (parent_memb_expr != nullptr)
-            member_expr = std::make_shared<MemberExpr>(parent_memb_expr, j);
-        else
-            member_expr = std::make_shared<MemberExpr>(struct_var, j);
+void SymbolTable::emit_single_struct_check (std::shared_ptr<Struct> struct_var, std::ostream& stream, std::string offset) {
+    std::shared_ptr<StructType> struct_type = std::static_pointer_cast<StructType>(struct_var->get_type());
+    emit_struct_member_checks(struct_var->get_name_id().str(), struct_type, stream, offset);
+}
 
+// Emits check of all non-static members of structure, which is accessed with the given expression
+void SymbolTable::emit_struct_member_checks (const std::string& struct_access, std::shared_ptr<StructType> struct_type,
+                                             std::ostream& stream, std::string offset) {
+    const auto& layout = struct_type->get_flat_layout();
+    for (uint32_t i = 0; i < layout.size(); ) {
+        const StructType::FlatMember& cur_member = layout.at(i);
         // Static members are checked separately
-        if (member_expr->get_value()->get_type()->get_is_static())
+        if (cur_member.member->get_type()->get_is_static()) {
+            i = cur_member.subtree_end;
             continue;
-
-        if (struct_var->get_member(j)->get_type()->is_struct_type())
-            emit_single_struct_check(member_expr, std::static_pointer_cast<Struct>(struct_var->get_member(j)),
-                                     stream, offset);
-        else {
-            stream << offset + "hash(&seed, ";
-            member_expr->emit(stream);
-            stream << ");\n";
         }
+
+        if (!cur_member.member->get_type()->is_struct_type())
+            stream << offset + "hash(&seed, " << struct_access << cur_member.access_path << ");\n";
+        ++i;
     }
 }
 
@@ -299,16 +374,16 @@ void SymbolTable::emit_array_def (std::ostream& stream, std::string offset) {
     for (const auto &i : array) {
         std::shared_ptr<StubExpr> stub_init = nullptr;
         std::shared_ptr<ArrayType> array_type = std::static_pointer_cast<ArrayType>(i->get_type());
-        if (options->is_cxx() && options->standard_id <= Options::CXX03 &&
+        if (options->is_cxx() && options->standard_id <= Options::CXX03 && !i->is_init_by_loop() &&
            (array_type->get_kind() == ArrayType::STD_VEC || array_type->get_kind() == ArrayType::VAL_ARR)) {
-            std::shared_ptr<ArrayType> c_array_type = std::make_shared<ArrayType>(array_type->get_base_type(),
+            std::shared_ptr<ArrayType> c_array_type = ir_make_shared<ArrayType>(array_type->get_base_type(),
                                                                                   array_type->get_size(),
                                                                                   ArrayType::C_ARR);
             std::string name = "tmp_" + i->get_name();
-            std::shared_ptr<Array> tmp_array = std::make_shared<Array>(name, c_array_type);
-            tmp_array->set_elements(i->get_elements());
+            std::shared_ptr<Array> tmp_array = ir_make_shared<Array>(name, c_array_type);
+            tmp_array->share_elements(i);
 
-            std::shared_ptr<DeclStmt> tmp_decl = std::make_shared<DeclStmt>(tmp_array, nullptr);
+            std::shared_ptr<DeclStmt> tmp_decl = ir_make_shared<DeclStmt>(tmp_array, nullptr);
             stream << offset;
             tmp_decl->emit(stream);
             stream << "\n";
@@ -323,25 +398,65 @@ void SymbolTable::emit_array_def (std::ostream& stream, std::string offset) {
             }
             else
                 ERROR("bad array kind");
-            stub_init = std::make_shared<StubExpr>(stub_str_stream.str());
+            stub_init = ir_make_shared<StubExpr>(stub_str_stream.str());
         }
-        std::shared_ptr<DeclStmt> decl = std::make_shared<DeclStmt>(i, stub_init);
+        std::shared_ptr<DeclStmt> decl = ir_make_shared<DeclStmt>(i, stub_init);
         stream << offset;
         decl->emit(stream);
         stream << "\n";
     }
 }
 
+void SymbolTable::emit_array_init (std::ostream& stream, std::string offset) {
+    for (const auto &i : array) {
+        if (!i->is_init_by_loop())
+            continue;
+        // Only the first elements are initialized explicitly, the rest repeat them
+        for (uint64_t j = 0; j < Array::INIT_PATTERN_SIZE; ++j) {
+            std::shared_ptr<Data> array_elem = i->get_element(j);
+            if (array_elem->get_class_id() == Data::VAR) {
+                stream << offset << array_elem->get_name_id() << " = ";
+                ConstExpr::emit_value(stream, i->get_element_init_value(j));
+                stream << ";\n";
+            }
+            else
+                emit_single_struct_init(std::static_pointer_cast<Struct>(array_elem), stream, offset);
+        }
+        stream << offset << "for (unsigned long long int i = " << Array::INIT_PATTERN_SIZE << "; i < " <<
+                  i->get_elements_count() << "; ++i)\n";
+        stream << offset << "    " << i->get_name_id() << " [i] = " << i->get_name_id() << " [i % " <<
+                  Array::INIT_PATTERN_SIZE << "];\n";
+    }
+}
+
 void SymbolTable::emit_array_check (std::ostream& stream, std::string offset) {
-    for (const auto &i : array)
-        for (unsigned int j = 0; j < i->get_elements_count(); ++j) {
+    for (const auto &i : array) {
+        if (i->is_init_by_loop()) {
+            std::shared_ptr<Type> base_type = std::static_pointer_cast<ArrayType>(i->get_type())->get_base_type();
+            stream << offset << "for (unsigned long long int i = 0; i < " << i->get_elements_count() << "; ++i)";
+            if (base_type->is_int_type())
+                stream << "\n" << offset << "    hash(&seed, " << i->get_name_id() << " [i]);\n";
+            else {
+                stream << " {\n";
+                emit_struct_member_checks(i->get_name_id().str() + " [i]",
+                                          std::static_pointer_cast<StructType>(base_type), stream, offset + "    ");
+                stream << offset << "}\n";
+            }
+            continue;
+        }
+        for (uint64_t j = 0; j < i->get_elements_count(); ++j) {
+            // Elements of integer arrays aren't created only to emit their names
+            if (std::static_pointer_cast<ArrayType>(i->get_type())->get_base_type()->is_int_type()) {
+                stream << offset + "hash(&seed, " + i->get_element_name(j) + ");\n";
+                continue;
+            }
             std::shared_ptr<Data> array_elem = i->get_element(j);
             switch (array_elem->get_class_id()) {
                 case Data::VAR:
-                    stream << offset + "hash(&seed, " + array_elem->get_name() + ");\n";
+                    stream << offset + "hash(&seed, " << array_elem->get_name_id() << ");\n";
                     break;
                 case Data::STRUCT:
-                    emit_single_struct_check(nullptr, std::static_pointer_cast<Struct>(array_elem), stream, offset);
+                    emit_single_struct_check(std::static_pointer_cast<Struct>(array_elem), stream, offset);
                     break;
                 case Data::POINTER:
                 case Data::ARRAY:
@@ -349,6 +464,7 @@ void SymbolTable::emit_array_check (std::ostream& stream, std::string offset) {
                     ERROR("inappropriate Data class for array");
             }
         }
+    }
 }
 
 void SymbolTable::emit_ptr_extern_decl (std::ostream& stream, std::string offset) {
@@ -378,9 +494,9 @@ void SymbolTable::emit_ptr_check (std::ostream& stream, std::string offset) {
 }
 
 Context::Context (GenPolicy _gen_policy, std::shared_ptr<Context> _parent_ctx, Node::NodeID _self_stmt_id, bool _taken) {
-    gen_policy = std::make_shared<GenPolicy>(_gen_policy);
+    gen_policy = ir_make_shared<GenPolicy>(_gen_policy);
     parent_ctx = _parent_ctx;
-    local_sym_table = std::make_shared<SymbolTable>();
+    local_sym_table = ir_make_shared<SymbolTable>();
     depth = 0;
     if_depth = 0;
     self_stmt_id = _self_stmt_id;
@@ -393,6 +509,8 @@ Context::Context (GenPolicy _gen_policy, std::shared_ptr<Context> _parent_ctx, N
         depth = parent_ctx->get_depth() + 1;
         if_depth = parent_ctx->get_if_depth();
         taken &= parent_ctx->get_taken();
+        // New scope sees all local symbols of enclosing ones
+        local_sym_table->set_outer_scope(parent_ctx->get_local_sym_table());
         //TODO: It should be parent of scope statement
         if (parent_ctx->get_self_stmt_id() == Node::NodeID::IF)
             if_depth++;
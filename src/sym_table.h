@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
 
 #include "gen_policy.h"
 #include "variable.h"
@@ -10,6 +11,107 @@
 
 namespace oorgen {
 
+// Uses of elements of integer arrays (one array after another). Elements are stored densely inside of Array,
+// so VarUseExpr for an element (and the element itself) is created only when it is requested for the first time.
+// After that the same object is returned.
+class ArrayElemUseExprs {
+    public:
+        void add_array (std::shared_ptr<Array> array);
+        size_t size () const { return array_ends.empty() ? 0 : array_ends.back(); }
+        bool empty () const { return size() == 0; }
+        std::shared_ptr<Expr> at (size_t idx) const;
+
+        // Elements of i-th array occupy positions [get_array_begin(i), get_array_end(i))
+        const std::vector<std::shared_ptr<Array>>& get_arrays () const { return arrays; }
+        size_t get_array_begin (size_t i) const { return i == 0 ? 0 : array_ends.at(i - 1); }
+        size_t get_array_end (size_t i) const { return array_ends.at(i); }
+
+    private:
+        std::vector<std::shared_ptr<Array>> arrays;
+        // Position after the last element of each array
+        std::vector<size_t> array_ends;
+        mutable std::unordered_map<size_t, std::shared_ptr<Expr>> created_uses;
+};
+
+// Index of expressions, which are available as inputs (leaves) of generated expressions in some scope.
+// It doesn't own most of expressions: it refers to vectors, which are stored in symbol tables, as segments.
+// Expressions, which appear during generation of the scope, are kept in its own vector after all segments.
+// So the index is built without creation or copying of expressions and access by position costs
+// a binary search over a few segments.
+class InpExprIndex {
+    public:
+        using ExprVector = std::vector<std::shared_ptr<Expr>>;
+
+        InpExprIndex () {}
+        InpExprIndex (ExprVector exprs) : own(std::move(exprs)) {}
+
+        // vec should outlive the index and shouldn't change while the index is in use
+        template<typename T>
+        void add_segment (const std::vector<std::shared_ptr<T>>& vec) {
+            if (vec.empty())
+                return;
+            segments.push_back({&vec, 0, &get_segment_elem<T>});
+            segment_ends.push_back(get_segments_size() + vec.size());
+        }
+        // Adds elements [begin, end) of uses
+        void add_segment (const ArrayElemUseExprs& uses, size_t begin, size_t end);
+        void add_segment (const ArrayElemUseExprs& uses) { add_segment(uses, 0, uses.size()); }
+        void push_back (std::shared_ptr<Expr> expr) { own.push_back(expr); }
+
+        size_t size () const { return get_segments_size() + own.size(); }
+        bool empty () const { return size() == 0; }
+        std::shared_ptr<Expr> at (size_t idx) const;
+        std::shared_ptr<Expr> front () const { return at(0); }
+
+    private:
+        struct Segment {
+            const void* vec;
+            // Position of the first element of segment in vec
+            size_t begin;
+            std::shared_ptr<Expr> (*get_elem) (const void* vec, size_t idx);
+        };
+
+        template<typename T>
+        static std::shared_ptr<Expr> get_segment_elem (const void* vec, size_t idx) {
+            return (*static_cast<const std::vector<std::shared_ptr<T>>*>(vec))[idx];
+        }
+        static std::shared_ptr<Expr> get_array_elem_use (const void* uses, size_t idx) {
+            return static_cast<const ArrayElemUseExprs*>(uses)->at(idx);
+        }
+        size_t get_segments_size () const { return segment_ends.empty() ? 0 : segment_ends.back(); }
+
+        std::vector<Segment> segments;
+        // Position after the last element of each segment
+        std::vector<size_t> segment_ends;
+        ExprVector own;
+};
+
+// Pool of expressions, each of which can be taken only once (e.g. targets of assignment to output data).
+// Taken slot is replaced with the last one, so it costs O(1), but the order of remaining slots changes.
+// Only positions of free slots are stored, expressions are taken from the source (see InpExprIndex),
+// which should outlive the pool and shouldn't change.
+class ExprSlotPool {
+    public:
+        template<typename C>
+        void fill (const C& exprs) {
+            source = InpExprIndex();
+            source.add_segment(exprs);
+            slots.resize(source.size());
+            for (size_t i = 0; i < slots.size(); ++i)
+                slots[i] = i;
+        }
+        size_t size () const { return slots.size(); }
+        bool empty () const { return slots.empty(); }
+        std::shared_ptr<Expr> take (size_t idx);
+        // Keeps the order of remaining slots, so it costs O(n). It is used only with legacy random engine.
+        std::shared_ptr<Expr> take_in_order (size_t idx);
+        std::shared_ptr<Expr> at (size_t idx) const { return source.at(slots.at(idx)); }
+
+    private:
+        InpExprIndex source;
+        std::vector<size_t> slots;
+};
+
 class SymbolTable {
     //TODO: we definitely need to refactor this class, because it is all messed up and strange
     //      e.g. sometimes we return from similar functions references, sometimes - objects
@@ -40,25 +142,49 @@ class SymbolTable {
         void add_array (std::shared_ptr<Array> _array);
         void add_pointer(std::shared_ptr<Pointer> ptr, std::shared_ptr<Expr> init_expr);
 
-        ExprVector get_var_use_exprs_in_arrays();
-        ExprVector get_var_use_exprs_from_vars();
+        // VarUseExpr objects are created once for every variable, when it is added, and for every element of
+        // integer array, when it is requested. They don't have any state, so the same objects are returned on every call.
+        const ArrayElemUseExprs& get_var_use_exprs_in_arrays() { return var_use_exprs_in_arrays; }
+        const ExprVector& get_var_use_exprs_from_vars() { return var_use_exprs; }
         // ignore_tmp_objs allows to exclude from output temporary objects
         // (e.g. std::_Bit_reference from std::vector<bool> [0])
-        ExprVector get_all_var_use_exprs(bool ignore_tmp_objs = false);
+        InpExprIndex get_all_var_use_exprs(bool ignore_tmp_objs = false);
 
         ExprStarVector& get_deref_exprs() { return pointers.deref_expr; }
 
         auto& get_members_in_structs() { return std::get<ALL>(members_in_structs); }
         auto& get_const_members_in_structs() { return std::get<CONST>(members_in_structs); }
-        void del_member_in_structs(size_t idx);
 
         auto& get_members_in_arrays() { return std::get<ALL>(members_in_arrays); }
         auto& get_const_members_in_arrays() { return std::get<CONST>(members_in_arrays); }
-        void del_member_in_arrays(size_t idx);
 
-        std::vector<std::string> get_lval_ptr_map_keys() { return lval_ptr_map_keys; }
-        std::map<std::string, ExprVector>& get_lval_expr_with_ptr_type() { return lval_expr_with_ptr_type; }
-        std::map<std::string, ExprVector>& get_all_expr_with_ptr_type() { return all_expr_with_ptr_type; }
+        // Every output variable, member or element should be assigned only once, so assignment targets of
+        // output symbol table are kept in pools (one per GenPolicy::OutDataTypeID) and are taken from them.
+        // New variables (VAR) are created for every assignment and pointers (POINTER) are only retargeted,
+        // so their pools stay empty.
+        void form_out_slot_pools ();
+        ExprSlotPool& get_out_slots (GenPolicy::OutDataTypeID out_data_type) { return out_slots[out_data_type]; }
+
+        // Expressions with pointer type are grouped by interned ID of their type (see PointerType)
+        using PtrTypeID = PointerType::InternedID;
+        const std::vector<PtrTypeID>& get_lval_ptr_map_keys() { return lval_ptr_map_keys; }
+        const ExprVector& get_lval_expr_with_ptr_type(PtrTypeID key) { return find_in_ptr_map(lval_expr_with_ptr_type, key); }
+        const ExprVector& get_all_expr_with_ptr_type(PtrTypeID key) { return find_in_ptr_map(all_expr_with_ptr_type, key); }
+
+        // Local symbol tables form a chain of nested scopes: every table is linked to the table of enclosing scope.
+        // Entering a scope only creates new empty table, symbols of enclosing scopes are visible through the chain
+        // and are never copied.
+        void set_outer_scope (std::shared_ptr<SymbolTable> _outer_scope) { outer_scope = _outer_scope; }
+        std::shared_ptr<SymbolTable> get_outer_scope () { return outer_scope; }
+        // Adds variables and elements of arrays (in the same order as get_all_var_use_exprs) to the index
+        void add_var_use_exprs_to_index (InpExprIndex& index);
+        // Adds variables, array elements and dereferences from this table and all enclosing ones
+        // to the index (inner scopes go first)
+        void add_visible_locals_to_index (InpExprIndex& index);
+        // Returns keys of pointer maps of this table and all enclosing ones, sorted by spelling of the type
+        std::vector<PtrTypeID> get_visible_ptr_keys ();
+        // Appends expressions with pointer type from this table and all enclosing ones (inner scopes go first)
+        void get_visible_exprs_with_ptr_type (PtrTypeID key, ExprVector& ret);
 
         void emit_variable_extern_decl (std::ostream& stream, std::string offset = "");
         void emit_variable_def (std::ostream& stream, std::string offset = "");
@@ -73,6 +199,7 @@ class SymbolTable {
         void emit_struct_check (std::ostream& stream, std::string offset = "");
         void emit_array_extern_decl (std::ostream& stream, std::string offset = "");
         void emit_array_def (std::ostream& stream, std::string offset = "");
+        void emit_array_init (std::ostream& stream, std::string offset = "");
         void emit_array_check (std::ostream& stream, std::string offset = "");
         void emit_ptr_extern_decl (std::ostream& stream, std::string offset = "");
         void emit_ptr_def (std::ostream& stream, std::string offset = "");
@@ -80,22 +207,25 @@ class SymbolTable {
         void emit_ptr_check (std::ostream& stream, std::string offset = "");
 
     private:
-        void form_struct_member_expr (std::tuple<MemberVector, MemberVector>& ret,
-                                      std::shared_ptr<MemberExpr> parent_memb_expr,
-                                      std::shared_ptr<Struct> struct_var,
-                                      bool ignore_const = false);
-        void emit_single_struct_init (std::shared_ptr<MemberExpr> parent_memb_expr, std::shared_ptr<Struct> struct_var,
-                                      std::ostream& stream, std::string offset = "");
-        void emit_single_struct_check (std::shared_ptr<MemberExpr> parent_memb_expr, std::shared_ptr<Struct> struct_var,
-                                       std::ostream& stream, std::string offset = "");
-        void var_use_exprs_from_vars_in_arrays(std::vector<std::shared_ptr<Expr>>& ret, bool ignore_tmp_objs = false);
+        void form_struct_member_expr (std::tuple<MemberVector, MemberVector>& ret, std::shared_ptr<Struct> struct_var);
+        void emit_single_struct_init (std::shared_ptr<Struct> struct_var, std::ostream& stream, std::string offset = "");
+        void emit_single_struct_check (std::shared_ptr<Struct> struct_var, std::ostream& stream, std::string offset = "");
+        static void emit_struct_member_checks (const std::string& struct_access, std::shared_ptr<StructType> struct_type,
+                                               std::ostream& stream, std::string offset);
         // This function unrolls nested pointers and creates ExprStar at each level
         std::shared_ptr<ExprStar> deep_deref_expr_from_nest_ptr(std::shared_ptr<ExprStar> expr);
-        // This function adds missing key to ptr_map_key
-        void add_to_lval_map(std::string& key, std::shared_ptr<Expr> expr);
-        void add_to_all_map(std::string& key, std::shared_ptr<Expr> expr);
+        // These functions also add missing key to the list of keys
+        void add_to_lval_map(PtrTypeID key, std::shared_ptr<Expr> expr);
+        void add_to_all_map(PtrTypeID key, std::shared_ptr<Expr> expr);
+        static void add_to_ptr_map(std::vector<ExprVector>& map, std::vector<PtrTypeID>& keys,
+                                   PtrTypeID key, std::shared_ptr<Expr> expr);
+        static const ExprVector& find_in_ptr_map(const std::vector<ExprVector>& map, PtrTypeID key);
 
         std::vector<std::shared_ptr<ScalarVariable>> variable;
+        // VarUseExpr for every variable and every element of integer arrays.
+        // They are created once and are shared by all users (including indexes of available inputs).
+        ExprVector var_use_exprs;
+        ArrayElemUseExprs var_use_exprs_in_arrays;
 
         std::vector<std::shared_ptr<StructType>> struct_type;
         std::vector<std::shared_ptr<Struct>> structs;
@@ -109,13 +239,18 @@ class SymbolTable {
 
         // This maps hold all expressions which can be assigned to pointer
         // They are designed to speed up pointers assignment
-        //TODO: nowadays we distinguish pointers by string and it is not the best idea
+        // Interned IDs of pointer types are small, so the maps are flat vectors indexed by them
         // This one stores only expressions which can be on left side of assignment ("lvalue")
-        std::map<std::string, ExprVector> lval_expr_with_ptr_type;
+        std::vector<ExprVector> lval_expr_with_ptr_type;
         // And this one store all expressions with pointer type
-        std::map<std::string, ExprVector> all_expr_with_ptr_type;
-        // Also we duplicate lval_ptr_expr map's keys in order to speed up random decisions
-        std::vector<std::string> lval_ptr_map_keys;
+        std::vector<ExprVector> all_expr_with_ptr_type;
+        // Also we duplicate maps' keys (in order of appearance) in order to speed up random decisions
+        std::vector<PtrTypeID> lval_ptr_map_keys;
+        std::vector<PtrTypeID> all_ptr_map_keys;
+
+        std::shared_ptr<SymbolTable> outer_scope;
+
+        ExprSlotPool out_slots [GenPolicy::OutDataTypeID::MAX_OUT_DATA_TYPE_ID];
 };
 
 class Context {
@@ -2,8 +2,12 @@
 
 #include <iostream>
 #include <climits>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
+#include "arena.h"
 #include "options.h"
 
 namespace oorgen {
@@ -13,6 +17,42 @@ class Data;
 class ScalarVariable;
 class Struct;
 
+// Name of generated entity (variable, member of structure, etc.).
+// Most of names are built from a counter, so they are stored as (kind, scope, counter) and are spelled
+// only during emission. Scope is the index of test function (or NO_SCOPE if names don't have a prefix),
+// for members of structures it is the number of structure type. Other names are interned.
+class Name {
+    public:
+        enum Kind : uint8_t {
+            EMPTY, SCALAR_VAR, STRUCT_VAR, ARRAY_VAR, PTR_VAR, MEMBER, TEXT
+        };
+        static const uint32_t NO_SCOPE = UINT32_MAX;
+
+        Name () : kind(EMPTY), scope(NO_SCOPE), counter(0) {}
+        Name (Kind _kind, uint32_t _scope, uint32_t _counter) : kind(_kind), scope(_scope), counter(_counter) {}
+        // Arbitrary spelling, which is interned
+        Name (const std::string& text);
+        Name (const char* text) : Name(std::string(text)) {}
+
+        Kind get_kind () const { return kind; }
+        bool empty () const { return kind == EMPTY; }
+        std::string str () const;
+        friend std::ostream& operator<< (std::ostream& stream, const Name& name);
+
+    private:
+        void emit_prefix (std::ostream& stream) const;
+
+        Kind kind;
+        uint32_t scope;
+        // Counter or interned ID for TEXT names
+        uint32_t counter;
+
+        static std::unordered_map<std::string, uint32_t> interned_ids;
+        static std::vector<std::string> interned_texts;
+};
+
+std::ostream& operator<< (std::ostream& stream, const Name& name);
+
 // 抽象类，作为所有types的ancestor
 class Type {
     public:
@@ -57,9 +97,11 @@ class Type {
         };
 
         // Type构造函数
-        Type (TypeID _id) : cv_qual(CV_Qual::NTHG), is_static(false), align(0), id (_id) {}
+        Type (TypeID _id) : cv_qual(CV_Qual::NTHG), is_static(false), align(0), id (_id),
+                            simple_name_id(NO_SIMPLE_NAME_ID) {}
         Type (TypeID _id, CV_Qual _cv_qual, bool _is_static, uint32_t _align) :
-              cv_qual (_cv_qual), is_static (_is_static), align (_align), id (_id) {}
+              cv_qual (_cv_qual), is_static (_is_static), align (_align), id (_id),
+              simple_name_id(NO_SIMPLE_NAME_ID) {}
         
         // Getters和Setters
         Type::TypeID get_type_id () { return id; }
@@ -82,6 +124,9 @@ class Type {
         std::string get_name ();
         std::string get_simple_name () { return name; }
         virtual std::string get_type_suffix() { return ""; }
+        // Types with the same simple name share one ID. Name is interned only on the first request
+        // and the ID is cached, so it is cheap to use it as a key (see PointerType).
+        uint32_t get_simple_name_id ();
 
         // 帮助快速确定Type种类的函数
         virtual bool is_builtin_type() { return false; }
@@ -104,6 +149,10 @@ class Type {
 
     private:
         TypeID id;
+
+        static const uint32_t NO_SIMPLE_NAME_ID = UINT32_MAX;
+        uint32_t simple_name_id;
+        static std::unordered_map<std::string, uint32_t> simple_name_ids;
 };
 
 // 结构体类
@@ -114,9 +163,10 @@ class StructType : public Type {
         struct StructMember {
             public:
                 // StructMember构造函数
-                StructMember (std::shared_ptr<Type> _type, std::string _name);
+                StructMember (std::shared_ptr<Type> _type, Name _name);
                 // 获得名字
-                std::string get_name () { return name; }
+                std::string get_name () { return name.str(); }
+                const Name& get_name_id () { return name; }
                 // 获得类型指针
                 std::shared_ptr<Type> get_type() { return type; }
                 // 获得数据指针
@@ -126,7 +176,7 @@ class StructType : public Type {
 
             private:
                 std::shared_ptr<Type> type;
-                std::string name;
+                Name name;
 
                 std::shared_ptr<Data> data; 
                 //TODO: 静态成员
@@ -143,10 +193,14 @@ class StructType : public Type {
         // Getters and setters
         //TODO: 应该加入对嵌套深度的更改
         // 添加成员变量
-        void add_member (std::shared_ptr<StructMember> new_mem) { members.push_back(new_mem); shadow_members.push_back(new_mem); }
-        void add_member (std::shared_ptr<Type> _type, std::string _name);
+        void add_member (std::shared_ptr<StructMember> new_mem) {
+            members.push_back(new_mem);
+            shadow_members.push_back(new_mem);
+            flat_layout.clear();
+        }
+        void add_member (std::shared_ptr<Type> _type, Name _name);
         // 添加shadow member
-        void add_shadow_member (std::shared_ptr<Type> _type) { shadow_members.push_back(std::make_shared<StructMember>(_type, "")); }
+        void add_shadow_member (std::shared_ptr<Type> _type) { shadow_members.push_back(ir_make_shared<StructMember>(_type, "")); }
         // 获取member的个数
         uint32_t get_member_count () { return members.size(); }
         // 获取shadow member的个数
@@ -156,6 +210,23 @@ class StructType : public Type {
         // 获取成员
         std::shared_ptr<StructMember> get_member (unsigned int num);
 
+        // Member of flattened layout, which includes members of nested structures.
+        // Members are listed in pre-order, so all members of a nested structure follow it and form a contiguous range.
+        struct FlatMember {
+            std::shared_ptr<StructMember> member;
+            // Index of the member in its immediate parent and nesting level (0 for own members of the structure)
+            uint32_t idx_in_parent;
+            uint32_t depth;
+            // Position after the last member of nested structure (or just the next position for scalar members)
+            uint32_t subtree_end;
+            // Access path from the outermost structure, e.g. ".memb_1.memb_4"
+            std::string access_path;
+            // The member itself or one of its enclosing members is static
+            bool in_static;
+        };
+        // Flattened layout is computed once per structure type and is shared by all instances
+        const std::vector<FlatMember>& get_flat_layout ();
+
 
         // 获取定义程序代码
         std::string get_definition (std::string offset = "");
@@ -180,6 +251,7 @@ class StructType : public Type {
         std::vector<std::shared_ptr<StructMember>> members;
         // 嵌套深度
         uint32_t nest_depth;
+        std::vector<FlatMember> flat_layout;
 };
 
 // 所有已处理未定义行为的ID
@@ -313,7 +385,8 @@ class IntegerType : public BuiltinType {
         BuiltinType::ScalarTypedVal get_min () { return min; }
         BuiltinType::ScalarTypedVal get_max () { return max; }
 
-        // This utility functions take IntegerTypeID and return shared pointer to corresponding type
+        // This utility functions take IntegerTypeID and return shared pointer to corresponding type.
+        // Types are interned, so equal requests return the same canonical instance, which must not be modified.
         static std::shared_ptr<IntegerType> init (BuiltinType::IntegerTypeID _type_id);
         static std::shared_ptr<IntegerType> init (BuiltinType::IntegerTypeID _type_id, CV_Qual _cv_qual, bool _is_static, uint32_t _align);
 
@@ -326,6 +399,14 @@ class IntegerType : public BuiltinType {
         static std::shared_ptr<IntegerType> generate (std::shared_ptr<Context> ctx);
 
     protected:
+        // Key of the canonical type: (IntegerTypeID, cv-qualifier, static, alignment, bit-field width).
+        // Zero-width bit-fields are allowed, so bit-fields are also marked by a flag.
+        static uint64_t get_canonical_key (IntegerTypeID it_id, CV_Qual _cv_qual, bool _is_static, uint32_t _align,
+                                           bool is_bit_field, uint32_t bit_field_width);
+        // Canonical types live until the end of the program, so they are allocated on the ordinary heap
+        // even if IR is placed in an arena.
+        static std::unordered_map<uint64_t, std::shared_ptr<IntegerType>> canonical_types;
+
         bool is_signed;
         // Minimum and maximum value, which can fit in type
         BuiltinType::ScalarTypedVal min;
@@ -345,6 +426,9 @@ class BitField : public IntegerType {
         bool get_is_bit_field() { return true; }
         uint32_t get_bit_field_width() { return bit_field_width; }
 
+        // Returns canonical bit-field type (see IntegerType::init)
+        static std::shared_ptr<BitField> init (IntegerTypeID it_id, uint32_t _bit_size, CV_Qual _cv_qual);
+
         // If all values of the bit-field can fit in signed/unsigned int
         static bool can_fit_in_int (BuiltinType::ScalarTypedVal val, bool is_unsigned);
 
@@ -359,8 +443,8 @@ class BitField : public IntegerType {
         uint32_t bit_field_width;
 };
 
-// Following classes represents standard integer types and bool
-// TODO: maybe all this classes should be singletons?
+// Following classes represents standard integer types and bool.
+// Use IntegerType::init to get canonical instances of them.
 class TypeBOOL : public IntegerType {
     public:
         TypeBOOL () : IntegerType(BuiltinType::IntegerTypeID::BOOL) { init_type (); }
@@ -620,11 +704,27 @@ class PointerType : public Type {
         uint32_t get_depth() { return depth; }
         void dbg_dump();
 
+        // All pointer types with the same spelling share one small ID, which is assigned in order of appearance.
+        // It is cheap to compare and can be used as an index, so it replaces spelling as a key (e.g. in SymbolTable).
+        // Pointer has the same spelling as another one iff their pointee types have the same spelling,
+        // so the ID is derived from the ID of pointee type and the spelling is built only for new IDs.
+        using InternedID = uint32_t;
+        InternedID get_interned_id () { return interned_id; }
+        static const std::string& get_interned_name (InternedID id) { return interned_names.at(id); }
+
     private:
         void init();
 
         std::shared_ptr<Type> pointee_type;
         uint32_t depth;
+        InternedID interned_id;
+
+        static const InternedID NO_INTERNED_ID = UINT32_MAX;
+        // Interned IDs of pointers to pointer types (indexed by their interned IDs)
+        // and to other types (indexed by their simple name IDs)
+        static std::vector<InternedID> ptr_to_ptr_ids;
+        static std::vector<InternedID> ptr_to_type_ids;
+        static std::vector<std::string> interned_names;
 };
 
 // This function checks if we can assign one pointer type to another
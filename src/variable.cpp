@@ -5,37 +5,45 @@
 
 using namespace oorgen;
 
+// All members (including members of nested structures) are allocated in one pass over flattened layout
 void Struct::allocate_members() {
     std::shared_ptr<StructType> struct_type = std::static_pointer_cast<StructType>(type);
-    // TODO: struct member can be not only integer
-    for (uint32_t i = 0; i < struct_type->get_member_count(); ++i) {
-        std::shared_ptr<StructType::StructMember> cur_member = struct_type->get_member(i);
-        if (cur_member->get_type()->is_int_type()) {
-            if (struct_type->get_member(i)->get_type()->get_is_static()) {
-//                std::cout << struct_type->get_member(i)->get_definition() << std::endl;
-//                std::cout << struct_type->get_member(i)->get_data().get() << std::endl;
-                members.push_back(struct_type->get_member(i)->get_data());
-            }
-            else {
-                std::shared_ptr<IntegerType> int_mem_type = std::static_pointer_cast<IntegerType> (struct_type->get_member(i)->get_type());
-                ScalarVariable new_mem (struct_type->get_member(i)->get_name(), int_mem_type);
-                members.push_back(std::make_shared<ScalarVariable>(new_mem));
+    const std::vector<StructType::FlatMember>& layout = struct_type->get_flat_layout();
+    flat_members.resize(layout.size());
+    // Structures, which members are currently allocated, for each nesting level
+    std::vector<Struct*> parents (1, this);
+    for (uint32_t i = 0; i < layout.size(); ) {
+        const StructType::FlatMember& cur_member = layout.at(i);
+        std::shared_ptr<Type> member_type = cur_member.member->get_type();
+        std::shared_ptr<Data> new_member;
+        if (member_type->get_is_static()) {
+            // Static members are shared, so are their nested members
+            new_member = cur_member.member->get_data();
+            if (member_type->is_struct_type()) {
+                const auto& static_flat_members = std::static_pointer_cast<Struct>(new_member)->get_flat_members();
+                std::copy(static_flat_members.begin(), static_flat_members.end(), flat_members.begin() + i + 1);
             }
+            parents.at(cur_member.depth)->members.push_back(new_member);
+            flat_members.at(i) = new_member;
+            i = cur_member.subtree_end;
+            continue;
         }
-        else if (cur_member->get_type()->is_struct_type()) {
-            if (struct_type->get_member(i)->get_type()->get_is_static()) {
-//                std::cout << struct_type->get_member(i)->get_definition() << std::endl;
-//                std::cout << struct_type->get_member(i)->get_data().get() << std::endl;
-                members.push_back(struct_type->get_member(i)->get_data());
-            }
-            else {
-                Struct new_struct (cur_member->get_name(), std::static_pointer_cast<StructType>(cur_member->get_type()));
-                members.push_back(std::make_shared<Struct>(new_struct));
-            }
+        // TODO: struct member can be not only integer
+        if (member_type->is_int_type())
+            new_member = ir_make_shared<ScalarVariable>(cur_member.member->get_name_id(),
+                                                         std::static_pointer_cast<IntegerType>(member_type));
+        else if (member_type->is_struct_type()) {
+            std::shared_ptr<Struct> new_struct (new Struct(cur_member.member->get_name_id(),
+                                                           std::static_pointer_cast<StructType>(member_type), {}));
+            parents.resize(cur_member.depth + 2);
+            parents.at(cur_member.depth + 1) = new_struct.get();
+            new_member = new_struct;
         }
-        else {
+        else
             ERROR("unsupported type of struct member (Struct)");
-        }
+        parents.at(cur_member.depth)->members.push_back(new_member);
+        flat_members.at(i) = new_member;
+        ++i;
     }
 }
 
@@ -60,27 +68,26 @@ void Struct::dbg_dump () {
 std::shared_ptr<Struct> Struct::generate (std::shared_ptr<Context> ctx) {
     //TODO: what about nested structs? StructType::generate need it. Should it take it itself from context?
     NameHandler& name_handler = NameHandler::get_instance();
-    std::shared_ptr<Struct> ret = std::make_shared<Struct>(name_handler.get_struct_var_name(), StructType::generate(ctx));
+    std::shared_ptr<Struct> ret = ir_make_shared<Struct>(name_handler.get_struct_var_name(), StructType::generate(ctx));
     ret->generate_members_init(ctx);
     return ret;
 }
 
 std::shared_ptr<Struct> Struct::generate (std::shared_ptr<Context> ctx, std::shared_ptr<StructType> struct_type) {
     NameHandler& name_handler = NameHandler::get_instance();
-    std::shared_ptr<Struct> ret = std::make_shared<Struct>(name_handler.get_struct_var_name(), struct_type);
+    std::shared_ptr<Struct> ret = ir_make_shared<Struct>(name_handler.get_struct_var_name(), struct_type);
     ret->generate_members_init(ctx);
     return ret;
 }
 
 void Struct::generate_members_init(std::shared_ptr<Context> ctx) {
-    for (uint32_t i = 0; i < get_member_count(); ++i) {
-        if (get_member(i)->get_type()->is_struct_type()) {
-            std::static_pointer_cast<Struct>(get_member(i))->generate_members_init(ctx);
-        }
-        else if (get_member(i)->get_type()->is_int_type()) {
-            std::shared_ptr<IntegerType> member_type = std::static_pointer_cast<IntegerType>(get_member(i)->get_type());
+    for (const auto& member : flat_members) {
+        if (member->get_type()->is_struct_type())
+            continue;
+        else if (member->get_type()->is_int_type()) {
+            std::shared_ptr<IntegerType> member_type = std::static_pointer_cast<IntegerType>(member->get_type());
             BuiltinType::ScalarTypedVal init_val = BuiltinType::ScalarTypedVal::generate(ctx, member_type->get_min(), member_type->get_max());
-            std::static_pointer_cast<ScalarVariable>(get_member(i))->set_init_value(init_val);
+            std::static_pointer_cast<ScalarVariable>(member)->set_init_value(init_val);
         }
         else {
             ERROR("unsupported type of struct member (Struct)");
@@ -88,7 +95,17 @@ void Struct::generate_members_init(std::shared_ptr<Context> ctx) {
     }
 }
 
-ScalarVariable::ScalarVariable (std::string _name, std::shared_ptr<IntegerType> _type) : Data (_name, _type, Data::VarClassID::VAR),
+void Struct::copy_init_values (std::shared_ptr<Struct> src) {
+    if (src->get_type() != type)
+        ERROR("can copy init values only from structure of the same type (Struct)");
+    for (uint32_t i = 0; i < flat_members.size(); ++i)
+        if (flat_members.at(i)->get_class_id() == Data::VarClassID::VAR) {
+            std::shared_ptr<ScalarVariable> member = std::static_pointer_cast<ScalarVariable>(flat_members.at(i));
+            member->set_init_value(std::static_pointer_cast<ScalarVariable>(src->flat_members.at(i))->get_init_value());
+        }
+}
+
+ScalarVariable::ScalarVariable (Name _name, std::shared_ptr<IntegerType> _type) : Data (_name, _type, Data::VarClassID::VAR),
                     min(_type->get_int_type_id()), max(_type->get_int_type_id()),
                     init_val(_type->get_int_type_id()), cur_val(_type->get_int_type_id()) {
     min = _type->get_min();
@@ -112,7 +129,7 @@ void ScalarVariable::dbg_dump () {
 
 std::shared_ptr<ScalarVariable> ScalarVariable::generate(std::shared_ptr<Context> ctx) {
     NameHandler& name_handler = NameHandler::get_instance();
-    std::shared_ptr<ScalarVariable> ret = std::make_shared<ScalarVariable> (name_handler.get_scalar_var_name(),
+    std::shared_ptr<ScalarVariable> ret = ir_make_shared<ScalarVariable> (name_handler.get_scalar_var_name(),
                                                                             IntegerType::generate(ctx));
     std::shared_ptr<IntegerType> int_type = IntegerType::generate(ctx);
     return ScalarVariable::generate(ctx, int_type);
@@ -121,13 +138,16 @@ std::shared_ptr<ScalarVariable> ScalarVariable::generate(std::shared_ptr<Context
 std::shared_ptr<ScalarVariable> ScalarVariable::generate(std::shared_ptr<Context> ctx,
                                                          std::shared_ptr<IntegerType> int_type) {
     NameHandler& name_handler = NameHandler::get_instance();
-    std::shared_ptr<ScalarVariable> ret = std::make_shared<ScalarVariable> (name_handler.get_scalar_var_name(),
+    std::shared_ptr<ScalarVariable> ret = ir_make_shared<ScalarVariable> (name_handler.get_scalar_var_name(),
                                                                             int_type);
     ret->set_init_value(BuiltinType::ScalarTypedVal::generate(ctx, ret->get_type()->get_int_type_id()));
     return ret;
 }
 
-Array::Array (std::string _name, std::shared_ptr<ArrayType> _type, std::shared_ptr<Context> ctx) :
+const uint64_t Array::MAX_LIST_INIT_SIZE;
+const uint64_t Array::INIT_PATTERN_SIZE;
+
+Array::Array (Name _name, std::shared_ptr<ArrayType> _type, std::shared_ptr<Context> ctx) :
               Data(_name, _type, Data::ARRAY) {
     if (!type->is_array_type())
         ERROR("can't create array without ArrayType");
@@ -135,55 +155,91 @@ Array::Array (std::string _name, std::shared_ptr<ArrayType> _type, std::shared_p
 }
 
 void Array::init_elements (std::shared_ptr<Context> ctx) {
+    RAND_CALL_SITE("Array::init_elements");
     std::shared_ptr<ArrayType> array_type = std::static_pointer_cast<ArrayType>(type);
     std::shared_ptr<Type> base_type = array_type->get_base_type();
     ArrayType::Kind kind = array_type->get_kind();
-    std::shared_ptr<Data> new_element;
-
-    auto pick_name = [this, &ctx, &kind] (int32_t idx) -> std::string {
-        if (ctx != nullptr && ctx.use_count() != 0) {
-            ArrayType::ElementSubscript subs_type = rand_val_gen->get_rand_id(ctx->get_gen_policy()->
-                                                                                   get_array_elem_subs_prob());
-            if ((kind == ArrayType::STD_VEC || kind == ArrayType::STD_ARR) && subs_type == ArrayType::At)
-                return name + ".at(" + std::to_string(idx) + ")";
-        }
-        return name + " [" + std::to_string(idx) + "]";
-    };
+    bool has_ctx = ctx != nullptr && ctx.use_count() != 0;
+    elements = ir_make_shared<ElementStorage>();
+    elements->count = array_type->get_size();
 
-    auto var_init = [&new_element, &base_type, &ctx, &pick_name] (int32_t idx) {
-        std::shared_ptr<IntegerType> base_int_type = std::static_pointer_cast<IntegerType>(base_type);
-        if (ctx == nullptr || ctx.use_count() == 0)
-            new_element = std::make_shared<ScalarVariable>(pick_name(idx), base_int_type);
-        else {
-            new_element = ScalarVariable::generate(ctx, base_int_type);
-            new_element->set_name(pick_name(idx));
-        }
+    auto pick_subs = [this, &ctx, &kind, &has_ctx] () -> bool {
+        if (!has_ctx)
+            return false;
+        ArrayType::ElementSubscript subs_type = rand_val_gen->get_rand_id(ctx->get_gen_policy()->
+                                                                               get_array_elem_subs_prob());
+        return (kind == ArrayType::STD_VEC || kind == ArrayType::STD_ARR) && subs_type == ArrayType::At;
     };
 
-    auto struct_init = [&new_element, &base_type, &ctx, &pick_name] (int32_t idx) {
+    if (base_type->is_int_type()) {
+        elements->int_type = std::static_pointer_cast<IntegerType>(base_type);
+        IntegerType::IntegerTypeID int_type_id = elements->int_type->get_int_type_id();
+        elements->init_vals.reserve(elements->count);
+        elements->use_at_subs.reserve(elements->count);
+        NameHandler& name_handler = NameHandler::get_instance();
+        for (uint64_t i = 0; i < elements->count; ++i) {
+            BuiltinType::ScalarTypedVal init_val = elements->int_type->get_min();
+            if (has_ctx) {
+                // Every element used to be a separate variable, so it still consumes a name
+                name_handler.skip_scalar_var_names(1);
+                if (is_init_by_loop() && i >= INIT_PATTERN_SIZE)
+                    init_val.val.ullint_val = elements->init_vals[i % INIT_PATTERN_SIZE];
+                else
+                    init_val = BuiltinType::ScalarTypedVal::generate(ctx, int_type_id);
+            }
+            elements->init_vals.push_back(init_val.val.ullint_val);
+            elements->use_at_subs.push_back(pick_subs());
+        }
+    }
+    else if (base_type->is_struct_type()) {
         std::shared_ptr<StructType> base_struct_type = std::static_pointer_cast<StructType>(base_type);
-        if (ctx == nullptr || ctx.use_count() == 0)
-            new_element = std::make_shared<Struct>(pick_name(idx), base_struct_type);
-        else {
-            new_element = Struct::generate(ctx, base_struct_type);
-            new_element->set_name(pick_name(idx));
+        elements->structs.reserve(elements->count);
+        for (uint64_t i = 0; i < elements->count; ++i) {
+            std::shared_ptr<Struct> new_element;
+            if (!has_ctx)
+                new_element = ir_make_shared<Struct>("", base_struct_type);
+            else if (is_init_by_loop() && i >= INIT_PATTERN_SIZE) {
+                new_element = ir_make_shared<Struct>("", base_struct_type);
+                new_element->copy_init_values(elements->structs[i % INIT_PATTERN_SIZE]);
+            }
+            else
+                new_element = Struct::generate(ctx, base_struct_type);
+            elements->use_at_subs.push_back(pick_subs());
+            new_element->set_name(get_element_name(i));
+            elements->structs.push_back(new_element);
         }
-    };
+    }
+    else
+        ERROR("bad base TypeID");
+}
 
-    for (unsigned int i = 0; i < array_type->get_size(); ++i) {
-        if (base_type->is_int_type())
-            var_init(i);
-        else if (base_type->is_struct_type())
-            struct_init(i);
-        else
-            ERROR("bad base TypeID");
+std::string Array::get_element_name (uint64_t idx) {
+    if (idx >= elements->count)
+        ERROR("index is out of range (Array)");
+    if (elements->use_at_subs[idx])
+        return name.str() + ".at(" + std::to_string(idx) + ")";
+    return name.str() + " [" + std::to_string(idx) + "]";
+}
 
-        elements.push_back(new_element);
-    }
+BuiltinType::ScalarTypedVal Array::get_element_init_value (uint64_t idx) {
+    if (elements->int_type == nullptr || idx >= elements->count)
+        ERROR("can't get init value of element (Array)");
+    BuiltinType::ScalarTypedVal ret (elements->int_type->get_int_type_id());
+    ret.val.ullint_val = elements->init_vals[idx];
+    return ret;
 }
 
 std::shared_ptr<Data> Array::get_element (uint64_t idx) {
-    return (idx >= elements.size()) ? nullptr : elements.at(idx);
+    if (idx >= elements->count)
+        return nullptr;
+    if (elements->int_type == nullptr)
+        return elements->structs[idx];
+    std::shared_ptr<ScalarVariable>& ret = elements->created_vars[idx];
+    if (ret == nullptr) {
+        ret = ir_make_shared<ScalarVariable>(get_element_name(idx), elements->int_type);
+        ret->set_init_value(get_element_init_value(idx));
+    }
+    return ret;
 }
 
 void Array::dbg_dump () {
@@ -191,8 +247,8 @@ void Array::dbg_dump () {
     std::cout << "array type: " << std::endl;
     type->dbg_dump();
     std::cout << "elements: " << std::endl;
-    for (auto const& i : elements)
-        i->dbg_dump();
+    for (uint64_t i = 0; i < elements->count; ++i)
+        get_element(i)->dbg_dump();
 }
 
 std::shared_ptr<Array> Array::generate(std::shared_ptr<Context> ctx) {
@@ -202,16 +258,16 @@ std::shared_ptr<Array> Array::generate(std::shared_ptr<Context> ctx) {
 
 std::shared_ptr<Array> Array::generate(std::shared_ptr<Context> ctx, std::shared_ptr<ArrayType> array_type) {
     NameHandler& name_handler = NameHandler::get_instance();
-    std::shared_ptr<Array> ret = std::make_shared<Array>(name_handler.get_array_var_name(), array_type, ctx);
+    std::shared_ptr<Array> ret = ir_make_shared<Array>(name_handler.get_array_var_name(), array_type, ctx);
     return ret;
 }
 
-Pointer::Pointer(std::string _name, std::shared_ptr<Data> _pointee) :
+Pointer::Pointer(Name _name, std::shared_ptr<Data> _pointee) :
                  Data (_name, nullptr, Data::VarClassID::POINTER), pointee(_pointee) {
-    type = std::make_shared<PointerType>(pointee->get_type());
+    type = ir_make_shared<PointerType>(pointee->get_type());
 }
 
-Pointer::Pointer(std::string _name, std::shared_ptr<PointerType> _type) :
+Pointer::Pointer(Name _name, std::shared_ptr<PointerType> _type) :
                  Data (_name, _type, Data::VarClassID::POINTER), pointee(nullptr) {
 }
 
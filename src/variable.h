@@ -13,12 +13,14 @@ class Data {
         };
 
         // Data构造函数
-        Data (std::string _name, std::shared_ptr<Type> _type, VarClassID _class_id) :
+        Data (Name _name, std::shared_ptr<Type> _type, VarClassID _class_id) :
               type(_type), name(_name), class_id(_class_id) {}
         // getters and setters
         VarClassID get_class_id () { return class_id; }
-        std::string get_name () { return name; }
-        void set_name (std::string _name) { name = _name; }
+        // Spelling of the name is created on every call, so it should be used only for emission
+        std::string get_name () { return name.str(); }
+        const Name& get_name_id () { return name; }
+        void set_name (Name _name) { name = _name; }
         std::shared_ptr<Type> get_type () { return type; }
         virtual void dbg_dump () = 0;
 
@@ -26,7 +28,7 @@ class Data {
 
     protected:
         std::shared_ptr<Type> type;
-        std::string name;
+        Name name;
 
     private:
         VarClassID class_id;
@@ -36,25 +38,35 @@ class Data {
 class Struct : public Data {
     public:
         // Struct构造函数
-        Struct (std::string _name, std::shared_ptr<StructType> _type) :
+        Struct (Name _name, std::shared_ptr<StructType> _type) :
                 Data(_name, _type, Data::VarClassID::STRUCT) { allocate_members(); }
         uint64_t get_member_count () { return members.size(); }
         std::shared_ptr<Data> get_member (unsigned int num);
+        // Data of members (including members of nested structures) in order of StructType::get_flat_layout().
+        // Only the outermost structure keeps it, nested ones have empty vector.
+        const std::vector<std::shared_ptr<Data>>& get_flat_members () { return flat_members; }
+        // Sets init values of all members to the ones of other structure of the same type
+        void copy_init_values (std::shared_ptr<Struct> src);
         void dbg_dump ();
         //TODO: stub for cv-qualifiers, cause now they are inside type.
         static std::shared_ptr<Struct> generate (std::shared_ptr<Context> ctx);
         static std::shared_ptr<Struct> generate (std::shared_ptr<Context> ctx, std::shared_ptr<StructType> struct_type);
 
     private:
+        // Nested structure, which members are allocated by the outermost structure
+        Struct (Name _name, std::shared_ptr<StructType> _type, std::vector<std::shared_ptr<Data>> _members) :
+                Data(_name, _type, Data::VarClassID::STRUCT), members(_members) {}
+
         void allocate_members();
         void generate_members_init(std::shared_ptr<Context> ctx);
         std::vector<std::shared_ptr<Data>> members;
+        std::vector<std::shared_ptr<Data>> flat_members;
 };
 
 // 标量变量类
 class ScalarVariable : public Data {
     public:
-        ScalarVariable (std::string _name, std::shared_ptr<IntegerType> _type);
+        ScalarVariable (Name _name, std::shared_ptr<IntegerType> _type);
         //TODO: add check for type id in Type and Value
         void set_init_value (BuiltinType::ScalarTypedVal _init_val) {init_val = cur_val = _init_val; was_changed = false; }
         void set_cur_value (BuiltinType::ScalarTypedVal _val) { cur_val = _val; was_changed = true; }
@@ -77,29 +89,55 @@ class ScalarVariable : public Data {
 };
 
 // Array变量
+// Elements of integer arrays are stored densely: the type of elements is kept once and only raw init value
+// and kind of subscript are kept for every element. ScalarVariable for an element is created on first request
+// (and is kept after that), so large arrays don't cost an object and a name per element.
+// Elements of arrays of structures are ordinary Struct objects.
 class Array : public Data {
     public:
-        Array (std::string _name, std::shared_ptr<ArrayType> _type, std::shared_ptr<Context> ctx = nullptr);
-        uint64_t get_elements_count () { return elements.size(); }
+        Array (Name _name, std::shared_ptr<ArrayType> _type, std::shared_ptr<Context> ctx = nullptr);
+        uint64_t get_elements_count () { return elements->count; }
+        // Arrays with more elements are initialized and checked by loops in generated test instead of
+        // element by element. Their init values repeat the values of the first INIT_PATTERN_SIZE elements.
+        static const uint64_t MAX_LIST_INIT_SIZE = 256;
+        static const uint64_t INIT_PATTERN_SIZE = 16;
+        bool is_init_by_loop () { return elements->count > MAX_LIST_INIT_SIZE; }
         std::shared_ptr<Data> get_element (uint64_t idx);
-        std::vector<std::shared_ptr<Data>>& get_elements () { return elements; }
-        void set_elements (std::vector<std::shared_ptr<Data>> &_elements) { elements = _elements; }
+        // These functions don't create element of integer array
+        std::string get_element_name (uint64_t idx);
+        BuiltinType::ScalarTypedVal get_element_init_value (uint64_t idx);
+        // Arrays share elements (e.g. temporary C array, which is used for initialization of this one)
+        void share_elements (std::shared_ptr<Array> src) { elements = src->elements; }
 
         void dbg_dump ();
         static std::shared_ptr<Array> generate(std::shared_ptr<Context> ctx);
         static std::shared_ptr<Array> generate(std::shared_ptr<Context> ctx, std::shared_ptr<ArrayType> array_type);
 
     private:
+        struct ElementStorage {
+            uint64_t count = 0;
+            // Type of elements for integer arrays, nullptr otherwise
+            std::shared_ptr<IntegerType> int_type;
+            // Raw init values (ScalarTypedVal::val) of elements of integer array
+            std::vector<uint64_t> init_vals;
+            // If element is accessed with ".at(idx)" instead of "[idx]"
+            std::vector<bool> use_at_subs;
+            // Elements of integer array, which were already requested
+            std::unordered_map<uint64_t, std::shared_ptr<ScalarVariable>> created_vars;
+            // Elements of array of structures
+            std::vector<std::shared_ptr<Struct>> structs;
+        };
+
         void init_elements (std::shared_ptr<Context> ctx = nullptr);
 
-        std::vector<std::shared_ptr<Data>> elements;
+        std::shared_ptr<ElementStorage> elements;
 };
 
 // 指针变量
 class Pointer : public Data {
     public:
-        Pointer (std::string _name, std::shared_ptr<Data> _pointee);
-        Pointer (std::string _name, std::shared_ptr<PointerType> _type);
+        Pointer (Name _name, std::shared_ptr<Data> _pointee);
+        Pointer (Name _name, std::shared_ptr<PointerType> _type);
         void set_pointee (std::shared_ptr<Data> _pointee);
         std::shared_ptr<Data> get_pointee () { return pointee; }
         void dbg_dump ();
@@ -0,0 +1,34 @@
+#!/bin/bash
+# Checks that complexity of generated tests (see --run-record) doesn't exceed max_test_complexity.
+#
+# usage: tests/complexity_budget.sh <path-to-oorgen>
+
+if [ $# -ne 1 ]; then
+    echo "usage: $0 <path-to-oorgen>"
+    exit 1
+fi
+
+oorgen=$(realpath "$1")
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+status=0
+for budget in 500 2000 20000; do
+    for preset in balanced stress; do
+        printf "preset = %s\nmax_test_complexity = %s\n" "$preset" "$budget" > "$work_dir"/budget.prof
+        for seed in 1 6 00_pcg64_6 00_xoshiro256ss_42 00_xoshiro256ssx4_1; do
+            rm -rf "$work_dir"/out "$work_dir"/record && mkdir "$work_dir"/out
+            if ! "$oorgen" -q -s "$seed" --profile="$work_dir"/budget.prof --run-record="$work_dir"/record \
+                           -d "$work_dir"/out > /dev/null; then
+                echo "oorgen failed for seed $seed, preset $preset, budget $budget"
+                exit 1
+            fi
+            complexity=$(grep -o " complexity=[0-9]*" "$work_dir"/record | cut -d= -f2)
+            if [ -z "$complexity" ] || [ "$complexity" -gt "$budget" ]; then
+                echo "complexity $complexity exceeds budget $budget for seed $seed, preset $preset"
+                status=1
+            fi
+        done
+    done
+done
+exit $status
@@ -0,0 +1,80 @@
+#!/bin/bash
+# Checks that deep arithmetic expressions are generated without overflow of the stack: expressions are chains
+# of unary operators and type casts, which reach max_arith_depth. Also checks that the default node limit
+# keeps trees of unlimited depth finite and that such trees don't exceed max_test_complexity.
+#
+# usage: tests/deep_expr.sh <path-to-oorgen>
+
+if [ $# -ne 1 ]; then
+    echo "usage: $0 <path-to-oorgen>"
+    exit 1
+fi
+
+oorgen=$(realpath "$1")
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+depth=300000
+cat > "$work_dir"/chain.prof << EOF
+test_func_count = 1
+max_arith_depth = $depth
+max_arith_node_count = 1000000
+min_scope_stmt_count = 1
+max_scope_stmt_count = 2
+max_if_depth = 0
+arith_data_weight = 0
+arith_binary_weight = 0
+arith_conditional_weight = 0
+arith_cse_weight = 0
+EOF
+
+cat > "$work_dir"/unlimited.prof << EOF
+max_arith_depth = 4000000000
+max_total_stmt_count = 200
+EOF
+
+budget=10000
+cat > "$work_dir"/budget.prof << EOF
+max_arith_depth = 4000000000
+max_test_complexity = $budget
+arith_data_weight = 0
+arith_binary_weight = 0
+arith_conditional_weight = 0
+arith_cse_weight = 0
+EOF
+
+status=0
+for seed in 00_pcg64_1 00_xoshiro256ss_42; do
+    rm -rf "$work_dir"/out && mkdir "$work_dir"/out
+    if ! "$oorgen" -q -s "$seed" --profile="$work_dir"/chain.prof -d "$work_dir"/out > /dev/null; then
+        echo "oorgen failed for seed $seed with deep chains"
+        exit 1
+    fi
+    nesting=$(awk '{ for (i = 1; i <= length($0); ++i) { c = substr($0, i, 1);
+                                                         if (c == "(" && ++n > max) max = n;
+                                                         else if (c == ")") --n } }
+                   END { print max + 0 }' "$work_dir"/out/func.*)
+    if [ "$nesting" -lt "$depth" ]; then
+        echo "expression depth $nesting is less than $depth for seed $seed"
+        status=1
+    fi
+
+    rm -rf "$work_dir"/out && mkdir "$work_dir"/out
+    if ! timeout 60 "$oorgen" -q -s "$seed" --profile="$work_dir"/unlimited.prof -d "$work_dir"/out > /dev/null; then
+        echo "oorgen failed for seed $seed with unlimited depth"
+        status=1
+    fi
+
+    rm -rf "$work_dir"/out "$work_dir"/record && mkdir "$work_dir"/out
+    if ! "$oorgen" -q -s "$seed" --profile="$work_dir"/budget.prof --run-record="$work_dir"/record \
+                   -d "$work_dir"/out > /dev/null; then
+        echo "oorgen failed for seed $seed with unlimited depth and complexity budget"
+        exit 1
+    fi
+    complexity=$(grep -o " complexity=[0-9]*" "$work_dir"/record | cut -d= -f2)
+    if [ -z "$complexity" ] || [ "$complexity" -gt "$budget" ]; then
+        echo "complexity $complexity exceeds budget $budget for seed $seed with unlimited depth"
+        status=1
+    fi
+done
+exit $status
@@ -0,0 +1,26 @@
+#!/bin/bash
+# Checks that seeds of legacy mt19937 engine (SSS and VV_SSS forms) still generate the same tests.
+# Checksums in legacy_seeds.sha256 were taken from oorgen before alternative engines were added.
+# Legacy engine relies on std distributions, so they are valid for libstdc++.
+#
+# usage: tests/legacy_seeds.sh <path-to-oorgen>
+
+if [ $# -ne 1 ]; then
+    echo "usage: $0 <path-to-oorgen>"
+    exit 1
+fi
+
+oorgen=$(realpath "$1")
+test_dir=$(dirname "$(realpath "$0")")
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+for seed in 42 7; do
+    mkdir "$work_dir/$seed"
+    if ! "$oorgen" -q -s "$seed" -d "$work_dir/$seed" > /dev/null; then
+        echo "oorgen failed for seed $seed"
+        exit 1
+    fi
+done
+
+cd "$work_dir" && sha256sum --quiet -c "$test_dir/legacy_seeds.sha256"
@@ -0,0 +1,47 @@
+#!/bin/bash
+# Checks that every test function, which is generated alone (--test-func=<N>), is the same as in the full test.
+#
+# usage: tests/test_func.sh <path-to-oorgen>
+
+if [ $# -ne 1 ]; then
+    echo "usage: $0 <path-to-oorgen>"
+    exit 1
+fi
+
+oorgen=$(realpath "$1")
+work_dir=$(mktemp -d)
+trap 'rm -rf "$work_dir"' EXIT
+
+# Prints definition of tf_<N>_foo from func.* file in directory
+extract_func () {
+    awk -v func_head="void tf_${2}_foo ()" '/^void tf_/ { found = ($0 == func_head) } found' "$1"/func.*
+}
+
+# Complexity predictions are shared by test functions, so the budget is checked too
+echo "max_test_complexity = 20000" > "$work_dir"/budget.prof
+
+status=0
+for seed in 00_xoshiro256ssx4_1 00_pcg64_7 00_xoshiro256ss_42; do
+    for opts in "" "--profile=stress" "-m 32 --std=c99" "--profile=$work_dir/budget.prof"; do
+        rm -rf "$work_dir"/full && mkdir "$work_dir"/full
+        if ! "$oorgen" -q -s "$seed" $opts -d "$work_dir"/full > /dev/null; then
+            echo "oorgen failed for seed $seed $opts"
+            exit 1
+        fi
+        func_count=$(grep -c "^void tf_" "$work_dir"/full/func.*)
+
+        for ((func = 0; func < func_count; ++func)); do
+            rm -rf "$work_dir"/single && mkdir "$work_dir"/single
+            if ! "$oorgen" -q -s "$seed" $opts --test-func=$func -d "$work_dir"/single > /dev/null; then
+                echo "oorgen failed for seed $seed $opts --test-func=$func"
+                exit 1
+            fi
+            full_func=$(extract_func "$work_dir"/full $func)
+            if [ -z "$full_func" ] || [ "$full_func" != "$(extract_func "$work_dir"/single $func)" ]; then
+                echo "tf_$func differs for seed $seed $opts"
+                status=1
+            fi
+        done
+    done
+done
+exit $status